@@ -92,6 +92,16 @@ struct mmo_map_server {
 	unsigned short maps;
 } server[MAX_MAP_SERVERS];
 
+// Dynamic map ownership: a map loaded by several map-servers is hosted by one of them (the owner),
+// the others keep it on standby. map_users holds the last count reported by the owner (0x2b28).
+short map_owner[MAX_MAPINDEX]; // server index, -1 if no map-server has the map
+unsigned short map_users[MAX_MAPINDEX];
+
+int map_balance_interval = 0; // seconds between two rebalancing runs, 0 never moves maps
+int map_balance_threshold = 50; // min. difference in users between two map-servers before a populated map is moved
+bool map_balance_empty = true; // also spread the maps nobody is on over the map-servers that have them loaded
+#define MAP_BALANCE_EMPTY_MAX 20 // max. empty maps moved per run
+
 int char_fd=-1;
 char userid[24];
 char passwd[24];
@@ -2633,6 +2643,13 @@ int char_send_fame_list(int fd) {
 	return 0;
 }
 
+/// Deferred task: rebuilds the fame ranking lists and sends them to all map-servers.
+int char_fame_list_rebuild(int tid, int64 tick, int id, intptr_t data) {
+	char_read_fame_list();
+	char_send_fame_list(-1);
+	return 0;
+}
+
 void char_update_fame_list(int type, int index, int fame) {
 	unsigned char buf[8];
 	WBUFW(buf,0) = 0x2b22;
@@ -2686,6 +2703,160 @@ void mapif_server_destroy(int id)
 }
 
 
+/// Returns true if the map-server has loaded the map, whether it owns it or keeps it on standby.
+bool mapif_server_hasmap(int id, unsigned short map)
+{
+	int i;
+	ARR_FIND(0, server[id].maps, i, server[id].map[i] == map);
+	return( i < server[id].maps );
+}
+
+
+/// Tells the map-servers that server 'id' hosts the given maps (0x2b29).
+/// The old owner sends the players on them over, standby copies elsewhere stay standby.
+void mapif_send_mapowner(int id, unsigned short *maps, int count)
+{
+	unsigned char buf[16384];
+	int i;
+
+	while( count > 0 ) {
+		int n = min(count, (int)(sizeof(buf) - 10) / 4);
+
+		WBUFW(buf,0) = 0x2b29;
+		WBUFW(buf,2) = 10 + n * 4;
+		WBUFL(buf,4) = htonl(server[id].ip);
+		WBUFW(buf,8) = htons(server[id].port);
+		for( i = 0; i < n; i++ ) {
+			WBUFW(buf,10+i*4) = maps[i];
+			WBUFW(buf,12+i*4) = 0;
+		}
+		mapif_sendall(buf, WBUFW(buf,2));
+		maps += n;
+		count -= n;
+	}
+}
+
+
+/// Moves the map to map-server 'id', which must have it loaded.
+void mapif_map_move(unsigned short map, int id)
+{
+	if( map_owner[map] == id )
+		return;
+	ShowInfo("Moving map '%s' (%d users) from map-server %d to map-server %d.\n", mapindex_id2name(map), map_users[map], map_owner[map], id);
+	map_owner[map] = id;
+	mapif_send_mapowner(id, &map, 1);
+}
+
+
+/// Hands the maps hosted by a map-server that went away to the map-servers that have them on standby.
+void mapif_server_release_maps(int id)
+{
+	unsigned short *moved;
+	int i, j, x, count;
+
+	if( server[id].maps == 0 )
+		return;
+
+	CREATE(moved, unsigned short, server[id].maps);
+	for( x = 0; x < ARRAYLENGTH(server); x++ ) {
+		if( x == id || server[x].fd <= 0 )
+			continue;
+		count = 0;
+		for( i = 0; i < server[id].maps; i++ ) {
+			unsigned short map = server[id].map[i];
+			if( map_owner[map] == id && mapif_server_hasmap(x, map) ) {
+				map_owner[map] = x;
+				moved[count++] = map;
+			}
+		}
+		if( count > 0 ) {
+			ShowStatus("Map-server %d takes over %d maps of map-server %d.\n", x, count, id);
+			mapif_send_mapowner(x, moved, count);
+		}
+	}
+	aFree(moved);
+
+	for( j = 0; j < server[id].maps; j++ ) {// nobody else has these
+		if( map_owner[server[id].map[j]] == id ) {
+			map_owner[server[id].map[j]] = -1;
+			map_users[server[id].map[j]] = 0;
+		}
+	}
+}
+
+
+/// Periodically moves maps between the map-servers [timer function]
+/// - a populated map goes from the busiest to the least busy map-server that has it loaded,
+///   when they differ by map_balance_threshold users and the move narrows the gap
+/// - empty maps are spread so every map-server hosts about as many of them as the others
+int mapif_map_balance(int tid, int64 tick, int id, intptr_t data)
+{
+	int load[MAX_MAP_SERVERS], empty[MAX_MAP_SERVERS];
+	int i, x, src = -1, dst = -1, moves;
+
+	memset(load, 0, sizeof(load));
+	memset(empty, 0, sizeof(empty));
+	for( i = 1; i < MAX_MAPINDEX; i++ ) {
+		if( map_owner[i] >= 0 ) {
+			load[map_owner[i]] += map_users[i];
+			if( map_users[i] == 0 )
+				empty[map_owner[i]]++;
+		}
+	}
+
+	for( x = 0; x < ARRAYLENGTH(server); x++ ) {
+		if( server[x].fd <= 0 )
+			continue;
+		if( src == -1 || load[x] > load[src] )
+			src = x;
+		if( dst == -1 || load[x] < load[dst] )
+			dst = x;
+	}
+	if( src == -1 || src == dst )
+		return 0;
+
+	if( load[src] - load[dst] >= map_balance_threshold ) {
+		int diff = load[src] - load[dst], best = -1;
+		// the map whose users come closest to half the difference, moving more than the difference would only turn it around
+		for( i = 0; i < server[src].maps; i++ ) {
+			unsigned short map = server[src].map[i];
+			if( map_owner[map] != src || map_users[map] == 0 || map_users[map] >= diff || !mapif_server_hasmap(dst, map) )
+				continue;
+			if( best == -1 || abs(diff - 2 * map_users[map]) < abs(diff - 2 * map_users[best]) )
+				best = map;
+		}
+		if( best != -1 )
+			mapif_map_move(best, dst);
+	}
+
+	if( !map_balance_empty )
+		return 0;
+
+	for( moves = 0, x = 0; x < ARRAYLENGTH(server) && moves < MAP_BALANCE_EMPTY_MAX; x++ ) {
+		if( server[x].fd <= 0 )
+			continue;
+		for( i = 0; i < server[x].maps && moves < MAP_BALANCE_EMPTY_MAX; i++ ) {
+			unsigned short map = server[x].map[i];
+			int y, to = -1;
+			if( map_owner[map] != x || map_users[map] != 0 )
+				continue;
+			for( y = 0; y < ARRAYLENGTH(server); y++ ) {
+				if( y != x && server[y].fd > 0 && empty[y] + 1 < empty[x] && (to == -1 || empty[y] < empty[to]) && mapif_server_hasmap(y, map) )
+					to = y;
+			}
+			if( to == -1 )
+				continue;
+			mapif_map_move(map, to);
+			empty[x]--;
+			empty[to]++;
+			moves++;
+		}
+	}
+
+	return 0;
+}
+
+
 /// Resets all the data related to a server.
 void mapif_server_reset(int id)
 {
@@ -2704,6 +2875,7 @@ void mapif_server_reset(int id)
 		WBUFW(buf,2) = j * 4 + 10;
 		mapif_sendallwos(fd, buf, WBUFW(buf,2));
 	}
+	mapif_server_release_maps(id);
 	if( SQL_ERROR == SQL->Query(sql_handle, "DELETE FROM `%s` WHERE `index`='%d'", ragsrvinfo_db, server[id].fd) )
 		Sql_ShowDebug(sql_handle);
 	online_char_db->foreach(online_char_db,char_db_setoffline,id); //Tag relevant chars as 'in disconnected' server.
@@ -2788,6 +2960,20 @@ int parse_frommap(int fd)
 
 				ShowStatus("Map-Server %d connected: %d maps, from IP %d.%d.%d.%d port %d.\n",
 							id, j, CONVIP(server[id].ip), server[id].port);
+
+				// It hosts the maps nobody hosts yet, the others are on standby until moved to it
+				for(i = 0, j = 0; i < server[id].maps; i++) {
+					unsigned short map = server[id].map[i];
+					if( map >= MAX_MAPINDEX )
+						continue;
+					if( map_owner[map] == -1 || map_owner[map] == id ) {
+						map_owner[map] = id;
+						map_users[map] = 0;
+						j++;
+					}
+				}
+				if( j < server[id].maps )
+					ShowStatus("Map-server %d hosts %d maps, %d are on standby.\n", id, j, server[id].maps - j);
 				ShowStatus("Map-server %d loading complete.\n", id);
 
 				// send name for wisp to player
@@ -2802,32 +2988,42 @@ int parse_frommap(int fd)
 				{
 				unsigned char buf[16384];
 				int x;
-				if (j == 0) {
+				if (server[id].maps == 0) {
 					ShowWarning("Map-server %d has NO maps.\n", id);
 				} else {
-					// Transmitting maps information to the other map-servers
+					// Transmitting the maps it hosts to the other map-servers
 					WBUFW(buf,0) = 0x2b04;
-					WBUFW(buf,2) = j * 4 + 10;
 					WBUFL(buf,4) = htonl(server[id].ip);
 					WBUFW(buf,8) = htons(server[id].port);
-					memcpy(WBUFP(buf,10), RFIFOP(fd,4), j * 4);
+					j = 0;
+					for(i = 0; i < server[id].maps; i++) {
+						if (map_owner[server[id].map[i]] == id) {
+							WBUFW(buf,10+j*4) = server[id].map[i];
+							WBUFW(buf,12+j*4) = 0;
+							j++;
+						}
+					}
+					WBUFW(buf,2) = j * 4 + 10;
 					mapif_sendallwos(fd, buf, WBUFW(buf,2));
 				}
-				// Transmitting the maps of the other map-servers to the new map-server
+				// Transmitting the maps the other map-servers host to the new map-server,
+				// the ones it has loaded too become standby there
 				for(x = 0; x < ARRAYLENGTH(server); x++) {
-					if (server[x].fd > 0 && x != id) {
-						WFIFOHEAD(fd,10 +4*ARRAYLENGTH(server[x].map));
+					if (server[x].fd > 0 && x != id && server[x].maps > 0) {
+						WFIFOHEAD(fd,10 + 4*server[x].maps);
 						WFIFOW(fd,0) = 0x2b04;
 						WFIFOL(fd,4) = htonl(server[x].ip);
 						WFIFOW(fd,8) = htons(server[x].port);
 						j = 0;
-						for(i = 0; i < ARRAYLENGTH(server[x].map); i++)
-							if (server[x].map[i])
-								WFIFOW(fd,10+(j++)*4) = server[x].map[i];
-						if (j > 0) {
-							WFIFOW(fd,2) = j * 4 + 10;
-							WFIFOSET(fd,WFIFOW(fd,2));
+						for(i = 0; i < server[x].maps; i++) {
+							if (map_owner[server[x].map[i]] == x) {
+								WFIFOW(fd,10+j*4) = server[x].map[i];
+								WFIFOW(fd,12+j*4) = 0;
+								j++;
+							}
 						}
+						WFIFOW(fd,2) = j * 4 + 10;
+						WFIFOSET(fd,WFIFOW(fd,2));
 					}
 				}
 				}
@@ -2894,6 +3090,20 @@ int parse_frommap(int fd)
 			}
 			break;
 
+			case 0x2b28: // users on each map the map-server hosts
+				if (RFIFOREST(fd) < 4 || RFIFOREST(fd) < RFIFOW(fd,2))
+					return 0;
+				for(i = 1; i < MAX_MAPINDEX; i++)
+					if (map_owner[i] == id)
+						map_users[i] = 0;
+				for(i = 4; i < RFIFOW(fd,2); i += 4) {
+					unsigned short map = RFIFOW(fd,i);
+					if (map < MAX_MAPINDEX && map_owner[map] == id)
+						map_users[map] = RFIFOW(fd,i+2);
+				}
+				RFIFOSKIP(fd,RFIFOW(fd,2));
+				break;
+
 			case 0x2afe: //set MAP user count
 				if (RFIFOREST(fd) < 4)
 					return 0;
@@ -3321,8 +3531,7 @@ int parse_frommap(int fd)
 			case 0x2b1a: // Build and send fame ranking lists [DracoRPG]
 				if (RFIFOREST(fd) < 2)
 					return 0;
-				char_read_fame_list();
-				char_send_fame_list(-1);
+				timer->defer(char_fame_list_rebuild, 0, 0); // requests coming in together share one rebuild
 				RFIFOSKIP(fd,2);
 			break;
 
@@ -3504,6 +3713,12 @@ void do_init_mapif(void)
 	int i;
 	for( i = 0; i < ARRAYLENGTH(server); ++i )
 		mapif_server_init(i);
+	memset(map_owner, -1, sizeof(map_owner));
+	memset(map_users, 0, sizeof(map_users));
+
+	timer->add_func_list(mapif_map_balance, "mapif_map_balance");
+	if( map_balance_interval > 0 )
+		timer->add_interval(timer->gettick() + map_balance_interval * 1000, mapif_map_balance, 0, 0, map_balance_interval * 1000);
 }
 
 void do_final_mapif(void)
@@ -3515,20 +3730,22 @@ void do_final_mapif(void)
 
 // Searches for the mapserver that has a given map (and optionally ip/port, if not -1).
 // If found, returns the server's index in the 'server' array (otherwise returns -1).
+// Without ip/port, the map-server hosting the map is preferred over the ones that have it on standby.
 int search_mapserver(unsigned short map, uint32 ip, uint16 port)
 {
-	int i, j;
+	int i;
+
+	if (ip == (uint32)-1 && port == (uint16)-1 && map < MAX_MAPINDEX
+	&& map_owner[map] >= 0 && server[map_owner[map]].fd > 0)
+		return map_owner[map];
 
 	for(i = 0; i < ARRAYLENGTH(server); i++)
 	{
 		if (server[i].fd > 0
 		&& (ip == (uint32)-1 || server[i].ip == ip)
-		&& (port == (uint16)-1 || server[i].port == port))
-		{
-			for (j = 0; server[i].map[j]; j++)
-				if (server[i].map[j] == map)
-					return i;
-		}
+		&& (port == (uint16)-1 || server[i].port == port)
+		&& mapif_server_hasmap(i, map))
+			return i;
 	}
 
 	return -1;
@@ -4477,6 +4694,28 @@ int mapif_sendallwos(int sfd, unsigned char *buf, unsigned int len)
 	return c;
 }
 
+/// Sends a packet made of a header and a payload kept elsewhere, usually the RFIFO of the packet
+/// being relayed, to all map-servers but sfd (-1 for all). Both parts are written straight into
+/// each WFIFO, so the packet is built once per map-server instead of once in a buffer and then copied.
+int mapif_sendallwos_hdr(int sfd, const unsigned char *hdr, unsigned int hdr_len, const void *data, unsigned int data_len)
+{
+	int i, c;
+
+	c = 0;
+	for(i = 0; i < ARRAYLENGTH(server); i++) {
+		int fd;
+		if ((fd = server[i].fd) > 0 && fd != sfd) {
+			WFIFOHEAD(fd,hdr_len + data_len);
+			memcpy(WFIFOP(fd,0), hdr, hdr_len);
+			memcpy(WFIFOP(fd,hdr_len), data, data_len);
+			WFIFOSET(fd,hdr_len + data_len);
+			c++;
+		}
+	}
+
+	return c;
+}
+
 int mapif_send(int fd, unsigned char *buf, unsigned int len)
 {
 	if (fd >= 0) {
@@ -4804,6 +5043,12 @@ int char_config_read(const char* cfgName)
 				ShowInfo("Console Silent Setting: %d\n", atoi(w2));
 		} else if(strcmpi(w1,"stdout_with_ansisequence")==0){
 			stdout_with_ansisequence = config_switch(w2);
+		} else if(strcmpi(w1,"console_msg_async")==0){
+			console_msg_async = config_switch(w2);
+		} else if(strcmpi(w1,"console_msg_rate")==0){
+			console_msg_rate = max(atoi(w2), 0);
+		} else if(strcmpi(w1,"console_msg_json")==0){
+			safestrncpy(console_msg_json, w2, sizeof(console_msg_json));
 		} else if (strcmpi(w1, "userid") == 0) {
 			safestrncpy(userid, w2, sizeof(userid));
 		} else if (strcmpi(w1, "passwd") == 0) {
@@ -4857,6 +5102,14 @@ int char_config_read(const char* cfgName)
 				autosave_interval = DEFAULT_AUTOSAVE_INTERVAL;
 		} else if (strcmpi(w1, "save_log") == 0) {
 			save_log = config_switch(w2);
+		} else if (strcmpi(w1, "map_balance_interval") == 0) {
+			map_balance_interval = atoi(w2);
+			if (map_balance_interval < 0)
+				map_balance_interval = 0;
+		} else if (strcmpi(w1, "map_balance_threshold") == 0) {
+			map_balance_threshold = max(atoi(w2), 1);
+		} else if (strcmpi(w1, "map_balance_empty") == 0) {
+			map_balance_empty = (bool)config_switch(w2);
 		} else if (strcmpi(w1, "start_point") == 0) {
 			char map[MAP_NAME_LENGTH_EXT];
 			int x, y;
@@ -4927,6 +5180,12 @@ int char_config_read(const char* cfgName)
 			}
 		} else if (strcmpi(w1, "guild_exp_rate") == 0) {
 			guild_exp_rate = atoi(w2);
+		} else if (strcmpi(w1, "map_balance_interval") == 0) {
+			map_balance_interval = max(0, atoi(w2));
+		} else if (strcmpi(w1, "map_balance_threshold") == 0) {
+			map_balance_threshold = max(1, atoi(w2));
+		} else if (strcmpi(w1, "map_balance_empty") == 0) {
+			map_balance_empty = (bool)config_switch(w2);
 		} else if (strcmpi(w1, "import") == 0) {
 			char_config_read(w2);
 		} else
@@ -5074,6 +5333,7 @@ int do_init(int argc, char **argv) {
 
 	// Online Data timers (checking if char still connected)
 	timer->add_func_list(online_data_cleanup, "online_data_cleanup");
+	timer->add_func_list(char_fame_list_rebuild, "char_fame_list_rebuild");
 	timer->add_interval(timer->gettick() + 1000, online_data_cleanup, 0, 0, 600 * 1000);
 
 	//Cleaning the tables for NULL entrys @ startup [Sirius]
@@ -60,6 +60,7 @@ int memitemdata_to_sql(const struct item items[], int max, int id, int tableswit
 
 int mapif_sendall(unsigned char *buf,unsigned int len);
 int mapif_sendallwos(int fd,unsigned char *buf,unsigned int len);
+int mapif_sendallwos_hdr(int sfd, const unsigned char *hdr, unsigned int hdr_len, const void *data, unsigned int data_len);
 int mapif_send(int fd,unsigned char *buf,unsigned int len);
 
 int char_married(int pl1,int pl2);
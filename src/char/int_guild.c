@@ -37,11 +37,17 @@ static DBMap *castle_db;
 
 static unsigned int guild_exp[100];
 
+// guild save statistics, reported once a minute with save_log
+static unsigned int guild_save_rows = 0; // rows written
+static unsigned int guild_save_queries = 0; // statements sent
+static int64 guild_save_report_tick = 0;
+
 int mapif_parse_GuildLeave(int fd,int guild_id,int account_id,int char_id,int flag,const char *mes);
 int mapif_guild_broken(int guild_id,int flag);
 static bool guild_check_empty(struct guild *g);
 int guild_calcinfo(struct guild *g);
 int mapif_guild_basicinfochanged(int guild_id,int type,const void *data,int len);
+static int mapif_guild_exp_changed(int tid, int64 tick, int guild_id, intptr_t data);
 int mapif_guild_info(int fd,struct guild *g);
 int guild_break_sub(int key,void *data,va_list ap);
 int inter_guild_tosql(struct guild *g,int flag);
@@ -83,6 +89,14 @@ static int guild_save_timer(int tid, int64 tick, int id, intptr_t data) {
 	if( state != 2 ) //Reached the end of the guild db without saving.
 		last_id = 0; //Reset guild saved, return to beginning.
 
+	if( DIFF_TICK(tick, guild_save_report_tick) >= 60000 )
+	{
+		if( save_log && guild_save_queries )
+			ShowInfo("Guild saves in the last minute: %u rows in %u queries.\n", guild_save_rows, guild_save_queries);
+		guild_save_rows = guild_save_queries = 0;
+		guild_save_report_tick = tick;
+	}
+
 	state = guild_db_->size(guild_db_);
 	if( state < 1 ) state = 1; //Calculate the time slot for the next save.
 	timer->add(tick + autosave_interval/state, guild_save_timer, 0, 0);
@@ -98,6 +112,17 @@ int inter_guild_removemember_tosql(int account_id, int char_id)
 	return 0;
 }
 
+/// Sends a batched REPLACE/UPDATE of `rows` rows built in buf, nothing if there are no rows.
+static void guild_save_query(StringBuf *buf, int rows)
+{
+	if( rows <= 0 )
+		return;
+	if( SQL_ERROR == SQL->QueryStr(sql_handle, StrBuf->Value(buf)) )
+		Sql_ShowDebug(sql_handle);
+	guild_save_rows += rows;
+	guild_save_queries++;
+}
+
 // Save guild into sql
 int inter_guild_tosql(struct guild *g,int flag)
 {
@@ -221,112 +246,147 @@ int inter_guild_tosql(struct guild *g,int flag)
 			StrBuf->Printf(&buf, "`guild_lv`=%d, `skill_point`=%d, `exp`=%"PRIu64", `next_exp`=%u, `max_member`=%d", g->guild_lv, g->skill_point, g->exp, g->next_exp, g->max_member);
 		}
 		StrBuf->Printf(&buf, " WHERE `guild_id`=%d", g->guild_id);
-		if( SQL_ERROR == SQL->Query(sql_handle, "%s", StrBuf->Value(&buf)) )
-			Sql_ShowDebug(sql_handle);
+		guild_save_query(&buf, 1);
 		StrBuf->Destroy(&buf);
 	}
 
-	if (flag&GS_MEMBER)
+	if (flag&(GS_MEMBER|GS_POSITION|GS_ALLIANCE|GS_EXPULSION|GS_SKILL))
 	{
-		struct guild_member *m;
-
-		strcat(t_info, " members");
-		// Update only needed players
-		for(i=0;i<g->max_member;i++){
-			m = &g->member[i];
-			if (!m->modified)
-				continue;
-			if(m->account_id) {
-				//Since nothing references guild member table as foreign keys, it's safe to use REPLACE INTO
+		StringBuf buf;
+		int count;
+
+		StrBuf->Init(&buf);
+
+		if (flag&GS_MEMBER)
+		{
+			int new_count = 0;
+
+			strcat(t_info, " members");
+			// Update only needed players, all of them in one statement
+			//Since nothing references guild member table as foreign keys, it's safe to use REPLACE INTO
+			StrBuf->Printf(&buf, "REPLACE INTO `%s` (`guild_id`,`account_id`,`char_id`,`hair`,`hair_color`,`gender`,`class`,`lv`,`exp`,`exp_payper`,`online`,`position`,`name`) VALUES ", guild_member_db);
+			for( i = 0, count = 0; i < g->max_member; i++ ){
+				struct guild_member *m = &g->member[i];
+				if (!m->modified || !m->account_id)
+					continue;
+				if( count )
+					StrBuf->AppendStr(&buf, ",");
 				SQL->EscapeStringLen(sql_handle, esc_name, m->name, strnlen(m->name, NAME_LENGTH));
-				if( SQL_ERROR == SQL->Query(sql_handle, "REPLACE INTO `%s` (`guild_id`,`account_id`,`char_id`,`hair`,`hair_color`,`gender`,`class`,`lv`,`exp`,`exp_payper`,`online`,`position`,`name`) "
-					"VALUES ('%d','%d','%d','%d','%d','%d','%d','%d','%"PRIu64"','%d','%d','%d','%s')",
-					guild_member_db, g->guild_id, m->account_id, m->char_id,
+				StrBuf->Printf(&buf, "('%d','%d','%d','%d','%d','%d','%d','%d','%"PRIu64"','%d','%d','%d','%s')",
+					g->guild_id, m->account_id, m->char_id,
 					m->hair, m->hair_color, m->gender,
-					m->class_, m->lv, m->exp, m->exp_payper, m->online, m->position, esc_name) )
-					Sql_ShowDebug(sql_handle);
+					m->class_, m->lv, m->exp, m->exp_payper, m->online, m->position, esc_name);
 				if (m->modified&GS_MEMBER_NEW || new_guild == 1)
-				{
-					if( SQL_ERROR == SQL->Query(sql_handle, "UPDATE `%s` SET `guild_id` = '%d' WHERE `char_id` = '%d'",
-						char_db, g->guild_id, m->char_id) )
-						Sql_ShowDebug(sql_handle);
+					new_count++;
+				count++;
+			}
+			guild_save_query(&buf, count);
+
+			if( new_count )
+			{// new members get their char's guild_id set, in one statement as well
+				StrBuf->Clear(&buf);
+				StrBuf->Printf(&buf, "UPDATE `%s` SET `guild_id` = '%d' WHERE `char_id` IN (", char_db, g->guild_id);
+				for( i = 0, count = 0; i < g->max_member; i++ ){
+					struct guild_member *m = &g->member[i];
+					if (!m->modified || !m->account_id || !(m->modified&GS_MEMBER_NEW || new_guild == 1))
+						continue;
+					StrBuf->Printf(&buf, count ? ",'%d'" : "'%d'", m->char_id);
+					count++;
 				}
-				m->modified = GS_MEMBER_UNMODIFIED;
+				StrBuf->AppendStr(&buf, ")");
+				guild_save_query(&buf, count);
 			}
-		}
-	}
 
-	if (flag&GS_POSITION){
-		strcat(t_info, " positions");
-		//printf("- Insert guild %d to guild_position\n",g->guild_id);
-		for(i=0;i<MAX_GUILDPOSITION;i++){
-			struct guild_position *p = &g->position[i];
-			if (!p->modified)
-				continue;
-			SQL->EscapeStringLen(sql_handle, esc_name, p->name, strnlen(p->name, NAME_LENGTH));
-			if( SQL_ERROR == SQL->Query(sql_handle, "REPLACE INTO `%s` (`guild_id`,`position`,`name`,`mode`,`exp_mode`) VALUES ('%d','%d','%s','%d','%d')",
-				guild_position_db, g->guild_id, i, esc_name, p->mode, p->exp_mode) )
-				Sql_ShowDebug(sql_handle);
-			p->modified = GS_POSITION_UNMODIFIED;
+			for( i = 0; i < g->max_member; i++ )
+				if( g->member[i].account_id )
+					g->member[i].modified = GS_MEMBER_UNMODIFIED;
 		}
-	}
 
-	if (flag&GS_ALLIANCE)
-	{
-		// Delete current alliances
-		// NOTE: no need to do it on both sides since both guilds in memory had
-		// their info changed, not to mention this would also mess up oppositions!
-		// [Skotlex]
-		//if( SQL_ERROR == SQL->Query(sql_handle, "DELETE FROM `%s` WHERE `guild_id`='%d' OR `alliance_id`='%d'", guild_alliance_db, g->guild_id, g->guild_id) )
-		if( SQL_ERROR == SQL->Query(sql_handle, "DELETE FROM `%s` WHERE `guild_id`='%d'", guild_alliance_db, g->guild_id) )
-		{
-			Sql_ShowDebug(sql_handle);
+		if (flag&GS_POSITION){
+			strcat(t_info, " positions");
+			StrBuf->Clear(&buf);
+			StrBuf->Printf(&buf, "REPLACE INTO `%s` (`guild_id`,`position`,`name`,`mode`,`exp_mode`) VALUES ", guild_position_db);
+			for( i = 0, count = 0; i < MAX_GUILDPOSITION; i++ ){
+				struct guild_position *p = &g->position[i];
+				if (!p->modified)
+					continue;
+				if( count )
+					StrBuf->AppendStr(&buf, ",");
+				SQL->EscapeStringLen(sql_handle, esc_name, p->name, strnlen(p->name, NAME_LENGTH));
+				StrBuf->Printf(&buf, "('%d','%d','%s','%d','%d')", g->guild_id, i, esc_name, p->mode, p->exp_mode);
+				p->modified = GS_POSITION_UNMODIFIED;
+				count++;
+			}
+			guild_save_query(&buf, count);
 		}
-		else
+
+		if (flag&GS_ALLIANCE)
 		{
-			//printf("- Insert guild %d to guild_alliance\n",g->guild_id);
-			for(i=0;i<MAX_GUILDALLIANCE;i++)
+			// Delete current alliances
+			// NOTE: no need to do it on both sides since both guilds in memory had
+			// their info changed, not to mention this would also mess up oppositions!
+			// [Skotlex]
+			//if( SQL_ERROR == SQL->Query(sql_handle, "DELETE FROM `%s` WHERE `guild_id`='%d' OR `alliance_id`='%d'", guild_alliance_db, g->guild_id, g->guild_id) )
+			guild_save_queries++;
+			if( SQL_ERROR == SQL->Query(sql_handle, "DELETE FROM `%s` WHERE `guild_id`='%d'", guild_alliance_db, g->guild_id) )
+			{
+				Sql_ShowDebug(sql_handle);
+			}
+			else
 			{
-				struct guild_alliance *a=&g->alliance[i];
-				if(a->guild_id>0)
+				StrBuf->Clear(&buf);
+				StrBuf->Printf(&buf, "REPLACE INTO `%s` (`guild_id`,`opposition`,`alliance_id`,`name`) VALUES ", guild_alliance_db);
+				for( i = 0, count = 0; i < MAX_GUILDALLIANCE; i++ )
 				{
+					struct guild_alliance *a=&g->alliance[i];
+					if(a->guild_id<=0)
+						continue;
+					if( count )
+						StrBuf->AppendStr(&buf, ",");
 					SQL->EscapeStringLen(sql_handle, esc_name, a->name, strnlen(a->name, NAME_LENGTH));
-					if( SQL_ERROR == SQL->Query(sql_handle, "REPLACE INTO `%s` (`guild_id`,`opposition`,`alliance_id`,`name`) "
-						"VALUES ('%d','%d','%d','%s')",
-						guild_alliance_db, g->guild_id, a->opposition, a->guild_id, esc_name) )
-						Sql_ShowDebug(sql_handle);
+					StrBuf->Printf(&buf, "('%d','%d','%d','%s')", g->guild_id, a->opposition, a->guild_id, esc_name);
+					count++;
 				}
+				guild_save_query(&buf, count);
 			}
 		}
-	}
 
-	if (flag&GS_EXPULSION){
-		strcat(t_info, " expulsions");
-		//printf("- Insert guild %d to guild_expulsion\n",g->guild_id);
-		for(i=0;i<MAX_GUILDEXPULSION;i++){
-			struct guild_expulsion *e=&g->expulsion[i];
-			if(e->account_id>0){
+		if (flag&GS_EXPULSION){
+			strcat(t_info, " expulsions");
+			StrBuf->Clear(&buf);
+			StrBuf->Printf(&buf, "REPLACE INTO `%s` (`guild_id`,`account_id`,`name`,`mes`) VALUES ", guild_expulsion_db);
+			for( i = 0, count = 0; i < MAX_GUILDEXPULSION; i++ ){
+				struct guild_expulsion *e=&g->expulsion[i];
 				char esc_mes[sizeof(e->mes)*2+1];
 
+				if(e->account_id<=0)
+					continue;
+				if( count )
+					StrBuf->AppendStr(&buf, ",");
 				SQL->EscapeStringLen(sql_handle, esc_name, e->name, strnlen(e->name, NAME_LENGTH));
 				SQL->EscapeStringLen(sql_handle, esc_mes, e->mes, strnlen(e->mes, sizeof(e->mes)));
-				if( SQL_ERROR == SQL->Query(sql_handle, "REPLACE INTO `%s` (`guild_id`,`account_id`,`name`,`mes`) "
-					"VALUES ('%d','%d','%s','%s')", guild_expulsion_db, g->guild_id, e->account_id, esc_name, esc_mes) )
-					Sql_ShowDebug(sql_handle);
+				StrBuf->Printf(&buf, "('%d','%d','%s','%s')", g->guild_id, e->account_id, esc_name, esc_mes);
+				count++;
 			}
+			guild_save_query(&buf, count);
 		}
-	}
 
-	if (flag&GS_SKILL){
-		strcat(t_info, " skills");
-		//printf("- Insert guild %d to guild_skill\n",g->guild_id);
-		for(i=0;i<MAX_GUILDSKILL;i++){
-			if (g->skill[i].id>0 && g->skill[i].lv>0){
-				if( SQL_ERROR == SQL->Query(sql_handle, "REPLACE INTO `%s` (`guild_id`,`id`,`lv`) VALUES ('%d','%d','%d')",
-					guild_skill_db, g->guild_id, g->skill[i].id, g->skill[i].lv) )
-					Sql_ShowDebug(sql_handle);
+		if (flag&GS_SKILL){
+			strcat(t_info, " skills");
+			StrBuf->Clear(&buf);
+			StrBuf->Printf(&buf, "REPLACE INTO `%s` (`guild_id`,`id`,`lv`) VALUES ", guild_skill_db);
+			for( i = 0, count = 0; i < MAX_GUILDSKILL; i++ ){
+				if (g->skill[i].id<=0 || g->skill[i].lv<=0)
+					continue;
+				if( count )
+					StrBuf->AppendStr(&buf, ",");
+				StrBuf->Printf(&buf, "('%d','%d','%d')", g->guild_id, g->skill[i].id, g->skill[i].lv);
+				count++;
 			}
+			guild_save_query(&buf, count);
 		}
+
+		StrBuf->Destroy(&buf);
 	}
 
 	if (save_log)
@@ -729,6 +789,7 @@ int inter_guild_sql_init(void)
 	sv->readdb("db", DBPATH"exp_guild.txt", ',', 1, 1, 100, exp_guild_parse_row);
 
 	timer->add_func_list(guild_save_timer, "guild_save_timer");
+	timer->add_func_list(mapif_guild_exp_changed, "mapif_guild_exp_changed");
 	timer->add(timer->gettick() + 10000, guild_save_timer, 0, 0);
 	return 0;
 }
@@ -986,37 +1047,45 @@ int mapif_guild_broken(int guild_id,int flag)
 // Send guild message
 int mapif_guild_message(int guild_id,int account_id,char *mes,int len, int sfd)
 {
-	unsigned char buf[512];
+	unsigned char buf[12];
 	if (len > 500)
 		len = 500;
 	WBUFW(buf,0)=0x3837;
 	WBUFW(buf,2)=len+12;
 	WBUFL(buf,4)=guild_id;
 	WBUFL(buf,8)=account_id;
-	memcpy(WBUFP(buf,12),mes,len);
-	mapif_sendallwos(sfd, buf,len+12);
+	mapif_sendallwos_hdr(sfd, buf, 12, mes, len); // the message is copied from the RFIFO
 	return 0;
 }
 
 // Send basic info
 int mapif_guild_basicinfochanged(int guild_id,int type,const void *data,int len)
 {
-	unsigned char buf[2048];
+	unsigned char buf[10];
 	if (len > 2038)
 		len = 2038;
 	WBUFW(buf, 0)=0x3839;
 	WBUFW(buf, 2)=len+10;
 	WBUFL(buf, 4)=guild_id;
 	WBUFW(buf, 8)=type;
-	memcpy(WBUFP(buf,10),data,len);
-	mapif_sendall(buf,len+10);
+	mapif_sendallwos_hdr(-1, buf, 10, data, len);
+	return 0;
+}
+
+// Sends the guild exp once per guild and main loop, however many members paid exp in it [deferred task]
+static int mapif_guild_exp_changed(int tid, int64 tick, int guild_id, intptr_t data)
+{
+	struct guild *g = (struct guild*)idb_get(guild_db_, guild_id);
+	if( g == NULL ) // unloaded or broken meanwhile
+		return 0;
+	mapif_guild_basicinfochanged(guild_id, GBI_EXP, &g->exp, sizeof(g->exp));
 	return 0;
 }
 
 // Send member info
 int mapif_guild_memberinfochanged(int guild_id,int account_id,int char_id, int type,const void *data,int len)
 {
-	unsigned char buf[2048];
+	unsigned char buf[18];
 	if (len > 2030)
 		len = 2030;
 	WBUFW(buf, 0)=0x383a;
@@ -1025,8 +1094,7 @@ int mapif_guild_memberinfochanged(int guild_id,int account_id,int char_id, int t
 	WBUFL(buf, 8)=account_id;
 	WBUFL(buf,12)=char_id;
 	WBUFW(buf,16)=type;
-	memcpy(WBUFP(buf,18),data,len);
-	mapif_sendall(buf,len+18);
+	mapif_sendallwos_hdr(-1, buf, 18, data, len);
 	return 0;
 }
 
@@ -1508,7 +1576,7 @@ int mapif_parse_GuildMemberInfoChange(int fd,int guild_id,int account_id,int cha
 					g->exp+=exp;
 
 				guild_calcinfo(g);
-				mapif_guild_basicinfochanged(guild_id,GBI_EXP,&g->exp,sizeof(g->exp));
+				timer->defer(mapif_guild_exp_changed, guild_id, 0); // already pending: it sends the latest exp
 				g->save_flag |= GS_LEVEL;
 			}
 			mapif_guild_memberinfochanged(guild_id,account_id,char_id,type,data,len);
@@ -871,7 +871,7 @@ int inter_mapif_init(int fd)
 // broadcast sending
 int mapif_broadcast(unsigned char *mes, int len, unsigned long fontColor, short fontType, short fontSize, short fontAlign, short fontY, int sfd)
 {
-	unsigned char *buf = (unsigned char*)aMalloc((len)*sizeof(unsigned char));
+	unsigned char buf[16];
 
 	WBUFW(buf,0) = 0x3800;
 	WBUFW(buf,2) = len;
@@ -880,18 +880,14 @@ int mapif_broadcast(unsigned char *mes, int len, unsigned long fontColor, short
 	WBUFW(buf,10) = fontSize;
 	WBUFW(buf,12) = fontAlign;
 	WBUFW(buf,14) = fontY;
-	memcpy(WBUFP(buf,16), mes, len - 16);
-	mapif_sendallwos(sfd, buf, len);
-
-	if (buf)
-		aFree(buf);
+	mapif_sendallwos_hdr(sfd, buf, 16, mes, len - 16);
 	return 0;
 }
 
 // Wis sending
 int mapif_wis_message(struct WisData *wd)
 {
-	unsigned char buf[2048];
+	unsigned char buf[56];
 	if (wd->len > 2047-56) wd->len = 2047-56; //Force it to fit to avoid crashes. [Skotlex]
 
 	WBUFW(buf, 0) = 0x3801;
@@ -899,8 +895,7 @@ int mapif_wis_message(struct WisData *wd)
 	WBUFL(buf, 4) = wd->id;
 	memcpy(WBUFP(buf, 8), wd->src, NAME_LENGTH);
 	memcpy(WBUFP(buf,32), wd->dst, NAME_LENGTH);
-	memcpy(WBUFP(buf,56), wd->msg, wd->len);
-	wd->count = mapif_sendall(buf,WBUFW(buf,2));
+	wd->count = mapif_sendallwos_hdr(-1, buf, 56, wd->msg, wd->len);
 
 	return 0;
 }
@@ -1113,11 +1108,10 @@ int mapif_parse_WisReply(int fd)
 // Received wisp message from map-server for ALL gm (just copy the message and resends it to ALL map-servers)
 int mapif_parse_WisToGM(int fd)
 {
-	unsigned char buf[2048]; // 0x3003/0x3803 <packet_len>.w <wispname>.24B <min_gm_level>.w <message>.?B
+	unsigned char buf[2]; // 0x3003/0x3803 <packet_len>.w <wispname>.24B <min_gm_level>.w <message>.?B
 
-	memcpy(WBUFP(buf,0), RFIFOP(fd,0), RFIFOW(fd,2));
 	WBUFW(buf, 0) = 0x3803;
-	mapif_sendall(buf, RFIFOW(fd,2));
+	mapif_sendallwos_hdr(-1, buf, 2, RFIFOP(fd,2), RFIFOW(fd,2) - 2);
 
 	return 0;
 }
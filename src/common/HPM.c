@@ -13,6 +13,7 @@
 #include "../common/console.h"
 #include "../common/strlib.h"
 #include "../common/sql.h"
+#include "../common/random.h"
 #include "HPM.h"
 
 #include <stdio.h>
@@ -521,6 +522,8 @@ void hplugins_share_defaults(void) {
 	HPM->share(SQL,"SQL");
 	/* timer */
 	HPM->share(timer,"timer");
+	/* random */
+	HPM->share(rnd_seed,"rnd_seed");
 	
 }
 
@@ -80,6 +80,23 @@ forceinline volatile int64 InterlockedExchange64(volatile int64 *target, int64 v
 
 #endif //endif 32bit windows
 
+// x86 and x64 keep loads and stores in program order (except a store followed by a load),
+// so acquire/release only have to stop the compiler from reordering.
+// Other targets would need real fences (MemoryBarrier) here.
+#if !defined(_M_IX86) && !defined(_M_X64)
+#error InterlockedLoadAcquire/InterlockedStoreRelease are only implemented for x86 and x64
+#endif
+forceinline int32 InterlockedLoadAcquire(volatile int32 *src){
+	int32 val = *src;
+	_ReadWriteBarrier();
+	return val;
+}
+
+forceinline void InterlockedStoreRelease(volatile int32 *dest, int32 val){
+	_ReadWriteBarrier();
+	*dest = val;
+}
+
 #elif defined(__GNUC__)
 
 #if !defined(__x86_64__) && !defined(__i386__)
@@ -136,6 +153,33 @@ static forceinline int32 InterlockedExchange(volatile int32 *target, int32 val){
 }//end: InterlockedExchange()
 
 
+#if defined(__ATOMIC_ACQUIRE) // gcc 4.7+, clang
+static forceinline int32 InterlockedLoadAcquire(volatile int32 *src){
+	return __atomic_load_n(src, __ATOMIC_ACQUIRE);
+}//end: InterlockedLoadAcquire()
+
+
+static forceinline void InterlockedStoreRelease(volatile int32 *dest, int32 val){
+	__atomic_store_n(dest, val, __ATOMIC_RELEASE);
+}//end: InterlockedStoreRelease()
+#else
+// x86 and x64 keep loads and stores in program order (except a store followed by a load),
+// so acquire/release only have to stop the compiler from reordering (older compilers only
+// build for x86 and x64, see above).
+static forceinline int32 InterlockedLoadAcquire(volatile int32 *src){
+	int32 val = *src;
+	__asm__ __volatile__("" ::: "memory");
+	return val;
+}//end: InterlockedLoadAcquire()
+
+
+static forceinline void InterlockedStoreRelease(volatile int32 *dest, int32 val){
+	__asm__ __volatile__("" ::: "memory");
+	*dest = val;
+}//end: InterlockedStoreRelease()
+#endif
+
+
 #endif //endif compiler decission
 
 
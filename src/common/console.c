@@ -11,6 +11,7 @@
 #ifndef MINICORE
 	#include "../common/ers.h"
 	#include "../common/malloc.h"
+	#include "../common/mempool.h"
 	#include "../common/atomic.h"
 	#include "../common/spinlock.h"
 	#include "../common/thread.h"
@@ -91,6 +92,15 @@ CPCMD(ers_report) {
 CPCMD(mem_report) {
 	memmgr_report(line?atoi(line):0);
 }
+/* Memory manager usage by call site, followed by the ERS caches, the mempools and the process totals */
+CPCMD(memory) {
+	size_t rss = iMalloc->rss();
+	memmgr_report(line?atoi(line):0);
+	ers_report();
+	mempool_report();
+	if( rss )
+		ShowInfo("memory: resident %.2f MB, %.2f MB through the memory manager\n",(double)rss/1024/1024,(double)iMalloc->usage()/1024);
+}
 CPCMD(help) {
 	unsigned int i = 0;
 	for ( i = 0; i < console->cmd_list_count; i++ ) {
@@ -130,6 +140,7 @@ void console_load_defaults(void) {
 		CP_DEF_S(ers_report,server),
 		CP_DEF_S(mem_report,server),
 		CP_DEF_S(malloc_usage,server),
+		CP_DEF_S(memory,server),
 		CP_DEF_S(exit,server),
 		CP_DEF_C(sql),
 		CP_DEF_C2(update,sql),
@@ -13,6 +13,7 @@
 	#include "../common/db.h"
 	#include "../common/socket.h"
 	#include "../common/timer.h"
+	#include "../common/profiler.h"
 	#include "../common/thread.h"
 	#include "../common/mempool.h"
 	#include "../common/sql.h"
@@ -284,6 +285,7 @@ void core_defaults(void) {
 #ifndef MINICORE
 	sql_defaults();
 	timer_defaults();
+	profiler_defaults();
 	db_defaults();
 #endif
 }
@@ -328,6 +330,7 @@ int main (int argc, char **argv) {
 	timer->init();
 
 	console->init();
+	profiler->init();
 	
 	HCache->init();
 	
@@ -338,11 +341,18 @@ int main (int argc, char **argv) {
 	socket_init();
 
 	do_init(argc,argv);
+	showmsg_init();
+	if( iMalloc->rss() )
+		ShowInfo("Memory: "CL_WHITE"%.2f MB"CL_RESET" resident after startup, %.2f MB through the memory manager.\n", (double)iMalloc->rss()/1024/1024, (double)iMalloc->usage()/1024);
 	{// Main runtime cycle
-		int next;
+		int next, busy = 0;
 		while (runflag != CORE_ST_STOP) {
+			profiler->frame_begin();
 			next = timer->do_timer(timer->gettick_nocache());
-			do_sockets(next);
+			// deferred work only gets the slack of loops that have nothing left over
+			next = timer->do_deferred(timer->gettick_nocache(), busy ? 0 : next);
+			busy = do_sockets(next);
+			profiler->frame_end();
 		}
 	}
 
@@ -352,10 +362,12 @@ int main (int argc, char **argv) {
 #ifndef MINICORE
 	HPM->final();
 #endif
+	profiler->final();
 	timer->final();
 	socket_final();
 	DB->final();
 	mempool_final();
+	showmsg_final();
 	rathread_final();
 #endif
 
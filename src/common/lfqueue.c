@@ -0,0 +1,306 @@
+//
+// Bounded Lock-Free Queues
+//
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include "../common/winapi.h"
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#endif
+
+#include "../common/cbasetypes.h"
+#include "../common/atomic.h"
+#include "../common/malloc.h"
+#include "../common/showmsg.h"
+#include "../common/lfqueue.h"
+
+// keeps the producer and consumer counters on different cache lines
+#define LFQ_CACHELINE 64
+
+
+struct spsc_queue{
+	volatile int32 head; // next slot to read, written by the consumer
+	int32 tail_cache; // consumer's last view of tail
+	char pad1[LFQ_CACHELINE - 2*sizeof(int32)];
+
+	volatile int32 tail; // next slot to write, written by the producer
+	int32 head_cache; // producer's last view of head
+	char pad2[LFQ_CACHELINE - 2*sizeof(int32)];
+
+	uint32 mask;
+	void **items;
+};
+
+
+// Each cell's sequence tells who owns it:
+// seq == pos: free for the producer claiming pos
+// seq == pos+1: filled, ready for the consumer
+struct mpsc_cell{
+	volatile int32 seq;
+	void *item;
+};
+
+struct mpsc_queue{
+	volatile int32 tail; // next position to claim, shared by the producers
+	char pad1[LFQ_CACHELINE - sizeof(int32)];
+
+	int32 head; // next position to read, consumer only
+	char pad2[LFQ_CACHELINE - sizeof(int32)];
+
+	uint32 mask;
+	struct mpsc_cell *cells;
+};
+
+
+struct lfq_wakeup{
+	int rfd, wfd; // same descriptor with eventfd
+	volatile int32 pending;
+};
+
+
+static uint32 lfq_capacity(uint32 capacity){
+	uint32 n = 2;
+
+	while( n < capacity && n < 0x40000000 )
+		n <<= 1;
+
+	return n;
+}//end: lfq_capacity()
+
+
+/*======================================
+ *	SPSC
+ *--------------------------------------*/
+spsc_queue spsc_queue_create(uint32 capacity){
+	spsc_queue q;
+
+	CREATE(q, struct spsc_queue, 1);
+	q->mask = lfq_capacity(capacity) - 1;
+	CREATE(q->items, void *, q->mask + 1);
+
+	return q;
+}//end: spsc_queue_create()
+
+
+void spsc_queue_destroy(spsc_queue q){
+	aFree(q->items);
+	aFree(q);
+}//end: spsc_queue_destroy()
+
+
+bool spsc_queue_push(spsc_queue q, void *item){
+	int32 tail = q->tail;
+
+	if( (uint32)(tail - q->head_cache) > q->mask ){
+		q->head_cache = InterlockedLoadAcquire(&q->head);
+		if( (uint32)(tail - q->head_cache) > q->mask )
+			return false; // full
+	}
+
+	q->items[tail & q->mask] = item;
+	InterlockedStoreRelease(&q->tail, tail + 1);
+
+	return true;
+}//end: spsc_queue_push()
+
+
+void *spsc_queue_pop(spsc_queue q){
+	int32 head = q->head;
+	void *item;
+
+	if( head == q->tail_cache ){
+		q->tail_cache = InterlockedLoadAcquire(&q->tail);
+		if( head == q->tail_cache )
+			return NULL; // empty
+	}
+
+	item = q->items[head & q->mask];
+	InterlockedStoreRelease(&q->head, head + 1);
+
+	return item;
+}//end: spsc_queue_pop()
+
+
+uint32 spsc_queue_count(spsc_queue q){
+	return (uint32)(InterlockedLoadAcquire(&q->tail) - InterlockedLoadAcquire(&q->head));
+}//end: spsc_queue_count()
+
+
+/*======================================
+ *	MPSC
+ *--------------------------------------*/
+mpsc_queue mpsc_queue_create(uint32 capacity){
+	mpsc_queue q;
+	uint32 i;
+
+	CREATE(q, struct mpsc_queue, 1);
+	q->mask = lfq_capacity(capacity) - 1;
+	CREATE(q->cells, struct mpsc_cell, q->mask + 1);
+	for( i = 0; i <= q->mask; i++ )
+		q->cells[i].seq = (int32)i;
+
+	return q;
+}//end: mpsc_queue_create()
+
+
+void mpsc_queue_destroy(mpsc_queue q){
+	aFree(q->cells);
+	aFree(q);
+}//end: mpsc_queue_destroy()
+
+
+bool mpsc_queue_push(mpsc_queue q, void *item){
+	int32 pos = InterlockedLoadAcquire(&q->tail);
+	struct mpsc_cell *cell;
+
+	for(;;){
+		int32 diff;
+
+		cell = &q->cells[pos & q->mask];
+		diff = InterlockedLoadAcquire(&cell->seq) - pos;
+
+		if( diff == 0 ){
+			int32 prev = InterlockedCompareExchange(&q->tail, pos + 1, pos);
+			if( prev == pos )
+				break; // claimed
+			pos = prev;
+		}else if( diff < 0 ){
+			return false; // full: the cell still holds the item from one lap ago
+		}else{
+			pos = InterlockedLoadAcquire(&q->tail); // another producer claimed it
+		}
+	}
+
+	cell->item = item;
+	InterlockedStoreRelease(&cell->seq, pos + 1);
+
+	return true;
+}//end: mpsc_queue_push()
+
+
+void *mpsc_queue_pop(mpsc_queue q){
+	struct mpsc_cell *cell = &q->cells[q->head & q->mask];
+	void *item;
+
+	if( InterlockedLoadAcquire(&cell->seq) != q->head + 1 )
+		return NULL; // empty, or the producer claiming it hasn't written it yet
+
+	item = cell->item;
+	InterlockedStoreRelease(&cell->seq, q->head + (int32)q->mask + 1);
+	q->head++;
+
+	return item;
+}//end: mpsc_queue_pop()
+
+
+uint32 mpsc_queue_count(mpsc_queue q){
+	return (uint32)(InterlockedLoadAcquire(&q->tail) - q->head);
+}//end: mpsc_queue_count()
+
+
+/*======================================
+ *	Wakeup
+ *--------------------------------------*/
+void (*lfq_wakeup_clear_hook)(lfq_wakeup w) = NULL;
+
+
+lfq_wakeup lfq_wakeup_create(void){
+#ifdef WIN32
+	return NULL;
+#else
+	lfq_wakeup w;
+	int fds[2];
+
+#if defined(__linux__)
+	fds[0] = fds[1] = eventfd(0, 0);
+	if( fds[0] < 0 ){
+		ShowError("lfq_wakeup_create: eventfd failed (%s).\n", strerror(errno));
+		return NULL;
+	}
+#else
+	if( pipe(fds) != 0 ){
+		ShowError("lfq_wakeup_create: pipe failed (%s).\n", strerror(errno));
+		return NULL;
+	}
+#endif
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	CREATE(w, struct lfq_wakeup, 1);
+	w->rfd = fds[0];
+	w->wfd = fds[1];
+	w->pending = 0;
+
+	return w;
+#endif
+}//end: lfq_wakeup_create()
+
+
+void lfq_wakeup_destroy(lfq_wakeup w){
+#ifndef WIN32
+	if( w == NULL )
+		return;
+
+	close(w->rfd);
+	if( w->wfd != w->rfd )
+		close(w->wfd);
+	aFree(w);
+#endif
+}//end: lfq_wakeup_destroy()
+
+
+int lfq_wakeup_fd(lfq_wakeup w){
+#ifndef WIN32
+	if( w != NULL )
+		return w->rfd;
+#endif
+	return -1;
+}//end: lfq_wakeup_fd()
+
+
+void lfq_wakeup_signal(lfq_wakeup w){
+#ifndef WIN32
+	uint64 one = 1;
+
+	if( w == NULL )
+		return;
+
+	if( InterlockedExchange(&w->pending, 1) == 0 ){
+		// a pipe takes one byte, an eventfd exactly 8
+		if( write(w->wfd, &one, w->wfd == w->rfd ? sizeof(one) : 1) < 0 && errno != EAGAIN )
+			ShowError("lfq_wakeup_signal: write failed (%s).\n", strerror(errno));
+	}
+#endif
+}//end: lfq_wakeup_signal()
+
+
+void lfq_wakeup_clear(lfq_wakeup w){
+#ifndef WIN32
+	char buf[64];
+
+	if( w == NULL )
+		return;
+
+	// empty the descriptor first: a signal between the two steps then finds pending set
+	// and writes nothing, but its item is still seen by the drain that follows the clear.
+	// Resetting first would let that signal's write be read here and leave pending set
+	// with nothing to wake the consumer up again.
+	while( read(w->rfd, buf, sizeof(buf)) > 0 )
+		;
+	if( lfq_wakeup_clear_hook != NULL )
+		lfq_wakeup_clear_hook(w);
+	InterlockedExchange(&w->pending, 0);
+#endif
+}//end: lfq_wakeup_clear()
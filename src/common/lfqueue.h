@@ -0,0 +1,138 @@
+#ifndef _rA_LFQUEUE_H_
+#define _rA_LFQUEUE_H_
+
+#include "../common/cbasetypes.h"
+
+//
+// Bounded lock-free queues for handing work between threads.
+//
+// The queues carry pointers; NULL can't be queued since it means "empty".
+// - spsc_queue: one producer thread, one consumer thread.
+// - mpsc_queue: any number of producer threads, one consumer thread.
+//
+// A consumer sleeping in the main loop is woken through an lfq_wakeup,
+// whose descriptor is watched by the socket loop (see socket_watch_fd).
+//
+
+typedef struct spsc_queue *spsc_queue;
+typedef struct mpsc_queue *mpsc_queue;
+typedef struct lfq_wakeup *lfq_wakeup;
+
+
+/**
+ * Creates a single producer / single consumer queue
+ *
+ * @param capacity - max. number of queued items, rounded up to a power of 2
+ *
+ * @return not NULL
+ */
+spsc_queue spsc_queue_create(uint32 capacity);
+
+
+/**
+ * Destroys the queue, items still queued are not freed.
+ */
+void spsc_queue_destroy(spsc_queue q);
+
+
+/**
+ * Queues an item (producer thread only)
+ *
+ * @return false if the queue is full
+ */
+bool spsc_queue_push(spsc_queue q, void *item);
+
+
+/**
+ * Dequeues the oldest item (consumer thread only)
+ *
+ * @return the item, NULL if the queue is empty
+ */
+void *spsc_queue_pop(spsc_queue q);
+
+
+/**
+ * Number of queued items, only exact when both sides are idle.
+ */
+uint32 spsc_queue_count(spsc_queue q);
+
+
+/**
+ * Creates a multiple producer / single consumer queue
+ *
+ * @param capacity - max. number of queued items, rounded up to a power of 2
+ *
+ * @return not NULL
+ */
+mpsc_queue mpsc_queue_create(uint32 capacity);
+
+
+/**
+ * Destroys the queue, items still queued are not freed.
+ */
+void mpsc_queue_destroy(mpsc_queue q);
+
+
+/**
+ * Queues an item (any thread)
+ *
+ * @return false if the queue is full
+ */
+bool mpsc_queue_push(mpsc_queue q, void *item);
+
+
+/**
+ * Dequeues the oldest item (consumer thread only)
+ *
+ * @return the item, NULL if the queue is empty
+ */
+void *mpsc_queue_pop(mpsc_queue q);
+
+
+/**
+ * Number of queued items, only exact when all sides are idle.
+ */
+uint32 mpsc_queue_count(mpsc_queue q);
+
+
+/**
+ * Creates a wakeup: an eventfd (a pipe where eventfd isn't available)
+ * that becomes readable when signalled.
+ *
+ * @return NULL if not supported (windows) - consumers then have to poll
+ */
+lfq_wakeup lfq_wakeup_create(void);
+
+
+/**
+ * Closes the wakeup's descriptor, unwatch it first.
+ */
+void lfq_wakeup_destroy(lfq_wakeup w);
+
+
+/**
+ * The descriptor to wait on (socket_watch_fd, select, epoll...)
+ */
+int lfq_wakeup_fd(lfq_wakeup w);
+
+
+/**
+ * Wakes the consumer (any thread), signals are coalesced until the next clear.
+ */
+void lfq_wakeup_signal(lfq_wakeup w);
+
+
+/**
+ * Acknowledges the signals (consumer thread), call it before draining the queues.
+ */
+void lfq_wakeup_clear(lfq_wakeup w);
+
+
+/**
+ * Called by lfq_wakeup_clear between emptying the descriptor and resetting the
+ * signal, so test_lfqueue can signal right there. NULL otherwise.
+ */
+extern void (*lfq_wakeup_clear_hook)(lfq_wakeup w);
+
+
+#endif
@@ -10,6 +10,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined(__linux__)
+#	include <unistd.h>
+#	include <sys/mman.h>
+#endif
 
 struct malloc_interface iMalloc_s;
 
@@ -192,17 +196,27 @@ static struct block* block_first, *block_last, block_head;
 /* Data for areas that do not use the memory be turned */
 struct unit_head_large {
 	size_t                  size;
+	size_t                  mapped;	/* Length of the huge page mapping, 0 when taken from malloc() */
 	struct unit_head_large* prev;
 	struct unit_head_large* next;
 	struct unit_head        unit_head;
 };
 
+/* Large areas of at least this size (the big static tables: map cells, item and
+ * mob databases...) get their own mapping, backed by transparent huge pages */
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+#define MEMMGR_HUGE_SIZE	( 2*1024*1024 )
+#endif
+
 static struct unit_head_large *unit_head_large_first = NULL;
 
 static struct block* block_malloc(unsigned short hash);
 static void          block_free(struct block* p);
 static size_t        memmgr_usage_bytes;
 static size_t        memmgr_usage_bytes_t;
+static size_t        memmgr_usage_bytes_huge;
+static uint64        memmgr_alloc_count;	/* Allocations since startup */
+static uint64        memmgr_free_count;	/* Frees since startup */
 
 
 #define block2unit(p, n) ((struct unit_head*)(&(p)->data[ p->unit_size * (n) ]))
@@ -229,6 +243,56 @@ static size_t hash2size( unsigned short hash )
 	}
 }
 
+/* Allocates the area of a large unit (header included).
+ * Areas of MEMMGR_HUGE_SIZE and over are mapped on their own and advised as
+ * huge pages, which saves TLB misses on the big tables scanned every tick. */
+static struct unit_head_large* memmgr_large_alloc(size_t len, const char *file, int line, const char *func)
+{
+	struct unit_head_large* p;
+#ifdef MEMMGR_HUGE_SIZE
+	if( len >= MEMMGR_HUGE_SIZE ) {
+		size_t mapped = (len + MEMMGR_HUGE_SIZE - 1) & ~(size_t)(MEMMGR_HUGE_SIZE - 1);
+		// map one huge page more and trim both ends, so the area starts on a huge page boundary
+		char *area = (char*)mmap(NULL, mapped + MEMMGR_HUGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if( area != (char*)MAP_FAILED ) {
+			char *aligned = (char*)(((uintptr_t)area + MEMMGR_HUGE_SIZE - 1) & ~(uintptr_t)(MEMMGR_HUGE_SIZE - 1));
+			if( aligned > area )
+				munmap(area, aligned - area);
+			if( area + MEMMGR_HUGE_SIZE > aligned )
+				munmap(aligned + mapped, area + MEMMGR_HUGE_SIZE - aligned);
+			madvise(aligned, mapped, MADV_HUGEPAGE); // only a hint, fine if THP is disabled
+			p = (struct unit_head_large*)aligned;
+			p->mapped = mapped;
+			memmgr_usage_bytes_t += mapped;
+			memmgr_usage_bytes_huge += mapped;
+			return p;
+		}
+		// fall back to malloc()
+	}
+#endif
+	p = (struct unit_head_large*)MALLOC(len,file,line,func);
+	if( p != NULL ) {
+		p->mapped = 0;
+		memmgr_usage_bytes_t += len;
+	}
+	return p;
+}
+
+/* Releases the area of a large unit */
+static void memmgr_large_free(struct unit_head_large* p, const char *file, int line, const char *func)
+{
+#ifdef MEMMGR_HUGE_SIZE
+	if( p->mapped ) {
+		memmgr_usage_bytes_t -= p->mapped;
+		memmgr_usage_bytes_huge -= p->mapped;
+		munmap(p, p->mapped);
+		return;
+	}
+#endif
+	memmgr_usage_bytes_t -= p->size + sizeof(struct unit_head_large);
+	FREE(p,file,line,func);
+}
+
 void* _mmalloc(size_t size, const char *file, int line, const char *func )
 {
 	struct block *block;
@@ -244,12 +308,12 @@ void* _mmalloc(size_t size, const char *file, int line, const char *func )
 		return NULL;
 	}
 	memmgr_usage_bytes += size;
+	memmgr_alloc_count++;
 
 	/* To ensure the area that exceeds the length of the block, using malloc () to */
 	/* At that time, the distinction by assigning NULL to unit_head.block */
 	if(hash2size(size_hash) > BLOCK_DATA_SIZE - sizeof(struct unit_head)) {
-		struct unit_head_large* p = (struct unit_head_large*)MALLOC(sizeof(struct unit_head_large)+size,file,line,func);
-		memmgr_usage_bytes_t += size+sizeof(struct unit_head_large);
+		struct unit_head_large* p = memmgr_large_alloc(sizeof(struct unit_head_large)+size,file,line,func);
 		if(p != NULL) {
 			p->size            = size;
 			p->unit_head.block = NULL;
@@ -406,12 +470,12 @@ void _mfree(void *ptr, const char *file, int line, const char *func )
 				head_large->next->prev = head_large->prev;
 			}
 			memmgr_usage_bytes -= head_large->size;
-			memmgr_usage_bytes_t -= head_large->size + sizeof(struct unit_head_large);
+			memmgr_free_count++;
 #ifdef DEBUG_MEMMGR
 			// set freed memory to 0xfd
 			memset(ptr, 0xfd, head_large->size);
 #endif
-			FREE(head_large,file,line,func);
+			memmgr_large_free(head_large,file,line,func);
 		}
 	} else {
 		/* Release unit */
@@ -424,6 +488,7 @@ void _mfree(void *ptr, const char *file, int line, const char *func )
 			ShowError("Memory manager: args of aFree 0x%p is overflowed pointer %s line %d\n", ptr, file, line);
 		} else {
 			memmgr_usage_bytes -= head->size;
+			memmgr_free_count++;
 			head->block         = NULL;
 #ifdef DEBUG_MEMMGR
 			memset(ptr, 0xfd, block->unit_size - sizeof(struct unit_head) + sizeof(long) );
@@ -645,7 +710,7 @@ static void memmgr_final (void)
 		memmgr_log (buf);
 #endif /* LOG_MEMMGR */
 		large2 = large->next;
-		FREE(large,file,line,func);
+		memmgr_large_free(large,ALC_MARK);
 		large = large2;
 	}
 #ifdef LOG_MEMMGR
@@ -729,6 +794,25 @@ void memmgr_report (int extra) {
 	}
 	ShowMessage("[malloc] : reporting %u instances | %.2f MB\n",count,(double)((size)/1024)/1024);
 	ShowMessage("[malloc] : internal usage %.2f MB | %.2f MB\n",(double)((memmgr_usage_bytes_t-memmgr_usage_bytes)/1024)/1024,(double)((memmgr_usage_bytes_t)/1024)/1024);
+#ifdef MEMMGR_HUGE_SIZE
+	ShowMessage("[malloc] : huge page areas %.2f MB\n",(double)((memmgr_usage_bytes_huge)/1024)/1024);
+#endif
+	{// allocation rate since the previous report
+		static time_t last_tick = 0;
+		static uint64 last_alloc = 0, last_free = 0;
+		time_t now = time(NULL);
+		double secs = last_tick ? (double)max(now - last_tick, 1) : 0.;
+		if( secs > 0. )
+			ShowMessage("[malloc] : %"PRIu64" allocations (%.0f/s), %"PRIu64" frees (%.0f/s) over the last %.0f seconds\n",
+				memmgr_alloc_count - last_alloc, (memmgr_alloc_count - last_alloc)/secs,
+				memmgr_free_count - last_free, (memmgr_free_count - last_free)/secs, secs);
+		else
+			ShowMessage("[malloc] : %"PRIu64" allocations, %"PRIu64" frees since startup (rates are shown from the next report on)\n",
+				memmgr_alloc_count, memmgr_free_count);
+		last_tick = now;
+		last_alloc = memmgr_alloc_count;
+		last_free = memmgr_free_count;
+	}
 	
 	if( extra ) {
 		ShowMessage("[malloc] : unit_head_large: %d bytes\n",sizeof(struct unit_head_large));
@@ -781,6 +865,22 @@ size_t malloc_usage (void) {
 #endif
 }
 
+/// Returns the resident set size of the process in bytes, 0 if unknown.
+size_t malloc_rss (void) {
+#if defined(__linux__)
+	unsigned long pages = 0, resident = 0;
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if( fp == NULL )
+		return 0;
+	if( fscanf(fp, "%lu %lu", &pages, &resident) != 2 )
+		resident = 0;
+	fclose(fp);
+	return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
 void malloc_final (void) {
 #ifdef USE_MEMMGR
 	memmgr_final ();
@@ -803,6 +903,8 @@ void malloc_init (void) {
 	GC_INIT();
 #endif
 #ifdef USE_MEMMGR
+	memmgr_usage_bytes_huge = 0;
+	memmgr_alloc_count = memmgr_free_count = 0;
 	memmgr_init ();
 #endif
 }
@@ -813,6 +915,7 @@ void malloc_defaults(void) {
 	iMalloc->final = malloc_final;
 	iMalloc->memory_check = malloc_memory_check;
 	iMalloc->usage = malloc_usage;
+	iMalloc->rss = malloc_rss;
 	iMalloc->verify_ptr = malloc_verify_ptr;
 
 // Athena's built-in Memory Manager
@@ -79,6 +79,7 @@ struct malloc_interface {
 	void	(*memory_check)(void);
 	bool	(*verify_ptr)(void* ptr);
 	size_t	(*usage) (void);
+	size_t	(*rss) (void);
 	/* */
 	void (*post_shutdown) (void);
 };
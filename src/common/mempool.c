@@ -566,3 +566,18 @@ mempool_stats mempool_get_stats(mempool pool){
 	return stats;
 }//end: mempool_get_stats()
 
+
+void mempool_report(void){
+	mempool p;
+
+	EnterSpinLock(&l_mempoolListLock);
+	for(p = l_mempoolList;  p != NULL;  p = p->next){
+		mempool_stats stats = mempool_get_stats(p);
+
+		ShowMessage("[mempool] : "CL_WHITE"%s"CL_RESET" %"PRId64"/%"PRId64" nodes used (peak %"PRId64"), %"PRId64" segments => %.2f MB\n",
+			p->name, stats.num_nodes_used, stats.num_nodes_total, stats.peak_nodes_used, stats.num_segments, (double)stats.num_bytes_total/1024/1024);
+	}
+	LeaveSpinLock(&l_mempoolListLock);
+}//end: mempool_report()
+
+
@@ -97,4 +97,10 @@ void mempool_node_put(mempool pool, void *node);
 mempool_stats mempool_get_stats(mempool pool);
 
 
+/**
+ * Prints the statistics of every pool (console 'server memory').
+ */
+void mempool_report(void);
+
+
 #endif
@@ -0,0 +1,296 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+#include "../common/cbasetypes.h"
+#include "../common/console.h"
+#include "../common/core.h"
+#include "../common/malloc.h"
+#include "../common/showmsg.h"
+#include "../common/strlib.h"
+#include "../common/timer.h"
+#include "../config/core.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct profiler_interface profiler_s;
+
+/// Zone totals of one (type, key) pair over the sample ring.
+struct profiler_stat {
+	unsigned char type;
+	uintptr_t key;
+	unsigned int calls;
+	uint64 total;
+	uint32 max;
+};
+
+static const char *profiler_zone_label[PROFILER_ZONE_MAX] = { "timer", "packet", "sql", "script", "idle" };
+
+/*==========================================
+ * Recording
+ *------------------------------------------*/
+/// Returns the start of a zone, to be passed to profiler->end; 0 when disabled.
+int64 profiler_begin(void) {
+	return profiler->enabled ? timer->microtick() : 0;
+}
+
+/// Closes a zone opened with profiler->begin.
+void profiler_end(enum profiler_zone type, uintptr_t key, int64 start) {
+	struct profiler_sample *s;
+	uint32 duration;
+
+	if( !start || !profiler->enabled || !profiler->current.start )
+		return;
+
+	duration = (uint32)(timer->microtick() - start);
+	profiler->current.zone[type] += duration;
+	if( type == PROFILER_IDLE )
+		return;
+
+	s = &profiler->samples[profiler->sample_head & (PROFILER_SAMPLES-1)];
+	s->start = start;
+	s->duration = duration;
+	s->frame = profiler->frame_num;
+	s->key = key;
+	s->type = (unsigned char)type;
+	profiler->sample_head++;
+}
+
+void profiler_frame_begin(void) {
+	if( !profiler->enabled )
+		return;
+	memset(&profiler->current, 0, sizeof(profiler->current));
+	profiler->current.start = timer->microtick();
+}
+
+void profiler_frame_end(void) {
+	if( !profiler->enabled || !profiler->current.start )
+		return;
+	profiler->current.total = (uint32)(timer->microtick() - profiler->current.start);
+	memcpy(&profiler->frames[profiler->frame_head & (PROFILER_FRAMES-1)], &profiler->current, sizeof(profiler->current));
+	profiler->frame_head++;
+	profiler->frame_num++;
+}
+
+/// Starts recording, dropping what was recorded before.
+void profiler_start(void) {
+	if( !profiler->frames ) {
+		CREATE(profiler->frames, struct profiler_frame, PROFILER_FRAMES);
+		CREATE(profiler->samples, struct profiler_sample, PROFILER_SAMPLES);
+	}
+	profiler->frame_head = profiler->sample_head = 0;
+	profiler->current.start = 0; // the running frame is not recorded
+	profiler->enabled = true;
+}
+
+/// Stops recording; the rings are kept for report/trace.
+void profiler_stop(void) {
+	profiler->enabled = false;
+}
+
+/*==========================================
+ * Output
+ *------------------------------------------*/
+void profiler_set_namer(enum profiler_zone type, ProfilerNameFunc func) {
+	profiler->namer[type] = func;
+}
+
+const char* profiler_zone_name(enum profiler_zone type, uintptr_t key, char *buf, size_t size) {
+	if( profiler->namer[type] )
+		return profiler->namer[type](key, buf, size);
+
+	switch( type ) {
+		case PROFILER_TIMER:  safestrncpy(buf, timer->func_name((TimerFunc)key), size); break;
+		case PROFILER_PACKET: snprintf(buf, size, "packet 0x%04x", (unsigned int)key); break;
+		case PROFILER_SQL:    safestrncpy(buf, key ? "SQL statement" : "SQL query", size); break;
+		default:              snprintf(buf, size, "%s %lu", profiler_zone_label[type], (unsigned long)key); break;
+	}
+	return buf;
+}
+
+static int profiler_cmp_uint32(const void *a, const void *b) {
+	uint32 x = *(const uint32*)a, y = *(const uint32*)b;
+	return x < y ? -1 : x > y;
+}
+
+static int profiler_cmp_sample(const void *a, const void *b) {
+	const struct profiler_sample *x = a, *y = b;
+	if( x->type != y->type )
+		return x->type - y->type;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int profiler_cmp_stat(const void *a, const void *b) {
+	const struct profiler_stat *x = a, *y = b;
+	return x->total < y->total ? 1 : x->total > y->total ? -1 : 0;
+}
+
+/// Prints frame time percentiles and the top zones over the recorded rings.
+void profiler_report(int top) {
+	uint32 nframes = min(profiler->frame_head, PROFILER_FRAMES);
+	uint32 nsamples = min(profiler->sample_head, PROFILER_SAMPLES);
+	uint64 zone[PROFILER_ZONE_MAX] = { 0 };
+	struct profiler_sample *samples;
+	struct profiler_stat *stats;
+	uint32 *busy, i;
+	int nstats = 0, k;
+	char name[128];
+
+	if( !nframes ) {
+		ShowInfo("profiler: nothing recorded%s.\n", profiler->enabled ? " yet" : ", use 'profiler start'");
+		return;
+	}
+
+	CREATE(busy, uint32, nframes);
+	for( i = 0; i < nframes; i++ ) {
+		const struct profiler_frame *f = &profiler->frames[i];
+		busy[i] = f->total - min(f->zone[PROFILER_IDLE], f->total);
+		for( k = 0; k < PROFILER_ZONE_MAX; k++ )
+			zone[k] += f->zone[k];
+	}
+	qsort(busy, nframes, sizeof(uint32), profiler_cmp_uint32);
+	ShowInfo("profiler: %u frames, busy time p50 %.2f ms | p99 %.2f ms | max %.2f ms\n", nframes,
+		busy[nframes*50/100]/1000., busy[nframes*99/100]/1000., busy[nframes-1]/1000.);
+	ShowInfo("profiler: average per frame:");
+	for( k = 0; k < PROFILER_ZONE_MAX; k++ )
+		ShowMessage(" %s %.3f ms%s", profiler_zone_label[k], zone[k]/1000./nframes, k < PROFILER_ZONE_MAX-1 ? "," : "\n");
+	aFree(busy);
+
+	if( !nsamples || top <= 0 )
+		return;
+
+	// group the samples by zone, then rank the zones by total time
+	CREATE(samples, struct profiler_sample, nsamples);
+	memcpy(samples, profiler->samples, nsamples * sizeof(struct profiler_sample));
+	qsort(samples, nsamples, sizeof(struct profiler_sample), profiler_cmp_sample);
+	CREATE(stats, struct profiler_stat, nsamples);
+	for( i = 0; i < nsamples; i++ ) {
+		struct profiler_stat *st;
+		if( !nstats || stats[nstats-1].type != samples[i].type || stats[nstats-1].key != samples[i].key ) {
+			stats[nstats].type = samples[i].type;
+			stats[nstats].key = samples[i].key;
+			nstats++;
+		}
+		st = &stats[nstats-1];
+		st->calls++;
+		st->total += samples[i].duration;
+		st->max = max(st->max, samples[i].duration);
+	}
+	qsort(stats, nstats, sizeof(struct profiler_stat), profiler_cmp_stat);
+
+	ShowInfo("profiler: top %d of %d zones over the last %u samples (inclusive times):\n", min(top, nstats), nstats, nsamples);
+	for( k = 0; k < top && k < nstats; k++ ) {
+		const struct profiler_stat *st = &stats[k];
+		ShowMessage("  %-7s %-40s %8u calls %10.2f ms total %8.3f ms avg %8.3f ms max\n", profiler_zone_label[st->type],
+			profiler->zone_name(st->type, st->key, name, sizeof(name)), st->calls, st->total/1000., st->total/1000./st->calls, st->max/1000.);
+	}
+	aFree(stats);
+	aFree(samples);
+}
+
+static void profiler_json_string(FILE *fp, const char *str) {
+	fputc('"', fp);
+	for( ; *str; str++ ) {
+		if( *str == '"' || *str == '\\' )
+			fprintf(fp, "\\%c", *str);
+		else if( (unsigned char)*str < 0x20 )
+			fprintf(fp, "\\u%04x", (unsigned char)*str);
+		else
+			fputc(*str, fp);
+	}
+	fputc('"', fp);
+}
+
+/// Writes the recorded frames and zones in the Chrome trace event format (chrome://tracing, Perfetto).
+bool profiler_trace(const char *filename) {
+	uint32 nframes = min(profiler->frame_head, PROFILER_FRAMES);
+	uint32 nsamples = min(profiler->sample_head, PROFILER_SAMPLES);
+	uint32 i;
+	char name[128];
+	FILE *fp;
+
+	if( (fp = fopen(filename, "w")) == NULL ) {
+		ShowError("profiler_trace: can't write '%s'.\n", filename);
+		return false;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for( i = 0; i < nframes; i++ ) {
+		const struct profiler_frame *f = &profiler->frames[i];
+		fprintf(fp, "{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%"PRId64",\"dur\":%u,\"pid\":1,\"tid\":1,\"args\":{\"idle_us\":%u}},\n",
+			f->start, f->total, f->zone[PROFILER_IDLE]);
+	}
+	for( i = 0; i < nsamples; i++ ) {
+		const struct profiler_sample *s = &profiler->samples[i];
+		fprintf(fp, "{\"name\":");
+		profiler_json_string(fp, profiler->zone_name(s->type, s->key, name, sizeof(name)));
+		fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%"PRId64",\"dur\":%u,\"pid\":1,\"tid\":1},\n",
+			profiler_zone_label[s->type], s->start, s->duration);
+	}
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}\n]}\n", SERVER_NAME ? SERVER_NAME : "server");
+	fclose(fp);
+
+	ShowInfo("profiler: %u frames and %u zones written to '%s'.\n", nframes, nsamples, filename);
+	return true;
+}
+
+#ifdef CONSOLE_INPUT
+CPCMD(profiler_start) {
+	profiler->start();
+	ShowInfo("profiler: recording.\n");
+}
+CPCMD(profiler_stop) {
+	profiler->stop();
+	ShowInfo("profiler: stopped.\n");
+}
+CPCMD(profiler_report) {
+	profiler->report(line ? atoi(line) : 20);
+}
+CPCMD(profiler_trace) {
+	profiler->trace(line ? line : "log/profiler_trace.json");
+}
+#endif
+
+void profiler_init(void) {
+	profiler->enabled = false;
+	profiler->frame_num = profiler->frame_head = profiler->sample_head = 0;
+	profiler->frames = NULL;
+	profiler->samples = NULL;
+#ifdef CONSOLE_INPUT
+	console->addCommand("profiler:start", CPCMD_A(profiler_start));
+	console->addCommand("profiler:stop", CPCMD_A(profiler_stop));
+	console->addCommand("profiler:report", CPCMD_A(profiler_report));
+	console->addCommand("profiler:trace", CPCMD_A(profiler_trace));
+#endif
+}
+
+void profiler_final(void) {
+	profiler->enabled = false;
+	if( profiler->frames )
+		aFree(profiler->frames);
+	if( profiler->samples )
+		aFree(profiler->samples);
+	profiler->frames = NULL;
+	profiler->samples = NULL;
+}
+
+void profiler_defaults(void) {
+	profiler = &profiler_s;
+
+	memset(profiler->namer, 0, sizeof(profiler->namer));
+
+	profiler->init = profiler_init;
+	profiler->final = profiler_final;
+	profiler->start = profiler_start;
+	profiler->stop = profiler_stop;
+	profiler->begin = profiler_begin;
+	profiler->end = profiler_end;
+	profiler->frame_begin = profiler_frame_begin;
+	profiler->frame_end = profiler_frame_end;
+	profiler->set_namer = profiler_set_namer;
+	profiler->zone_name = profiler_zone_name;
+	profiler->report = profiler_report;
+	profiler->trace = profiler_trace;
+}
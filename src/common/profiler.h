@@ -0,0 +1,77 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "../common/cbasetypes.h"
+
+/**
+ * Main loop frame profiler.
+ * Every iteration of the main loop is a frame; the time spent in timers,
+ * packet handlers, SQL queries and scripts is recorded as zone samples into
+ * fixed-size rings, overwriting the oldest entries.
+ * Zones nest (a timer running a query is charged for it too), so zone times
+ * are inclusive. Disabled by default, see the 'profiler' console commands.
+ **/
+
+#define PROFILER_FRAMES 4096 // frames kept, power of 2
+#define PROFILER_SAMPLES 65536 // zone samples kept, power of 2
+
+enum profiler_zone {
+	PROFILER_TIMER,  ///< key: TimerFunc
+	PROFILER_PACKET, ///< key: packet id
+	PROFILER_SQL,    ///< key: 0 = query, 1 = prepared statement
+	PROFILER_SCRIPT, ///< key: id of the object running the script
+	PROFILER_IDLE,   ///< waiting for the sockets, not part of the frame time
+	PROFILER_ZONE_MAX
+};
+
+/// Writes a readable name for a zone key into buf and returns buf.
+typedef const char* (*ProfilerNameFunc)(uintptr_t key, char *buf, size_t size);
+
+struct profiler_sample {
+	int64 start; ///< microseconds
+	uint32 duration; ///< microseconds
+	uint32 frame; ///< frame number
+	uintptr_t key;
+	unsigned char type; ///< enum profiler_zone
+};
+
+struct profiler_frame {
+	int64 start; ///< microseconds
+	uint32 total; ///< microseconds
+	uint32 zone[PROFILER_ZONE_MAX]; ///< microseconds per zone type
+};
+
+struct profiler_interface {
+	/* vars */
+	bool enabled;
+	uint32 frame_num;
+	struct profiler_frame current;
+	/* rings, written only by the main thread; readers use the heads as-is */
+	struct profiler_frame *frames;
+	struct profiler_sample *samples;
+	uint32 frame_head; ///< frames written so far
+	uint32 sample_head; ///< samples written so far
+	ProfilerNameFunc namer[PROFILER_ZONE_MAX];
+	/* funcs */
+	void (*init) (void);
+	void (*final) (void);
+	void (*start) (void);
+	void (*stop) (void);
+	int64 (*begin) (void);
+	void (*end) (enum profiler_zone type, uintptr_t key, int64 start);
+	void (*frame_begin) (void);
+	void (*frame_end) (void);
+	void (*set_namer) (enum profiler_zone type, ProfilerNameFunc func);
+	const char* (*zone_name) (enum profiler_zone type, uintptr_t key, char *buf, size_t size);
+	void (*report) (int top);
+	bool (*trace) (const char *filename);
+};
+
+struct profiler_interface *profiler;
+
+void profiler_defaults(void);
+
+#endif /* _PROFILER_H_ */
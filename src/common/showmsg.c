@@ -6,6 +6,10 @@
 #include "../common/strlib.h" // StringBuf
 #include "showmsg.h"
 #include "core.h" //[Ind] - For SERVER_TYPE
+#include "../common/atomic.h"
+#include "../common/lfqueue.h"
+#include "../common/spinlock.h"
+#include "../common/thread.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -31,6 +35,7 @@
 	#endif
 #else
 	#include <unistd.h>
+	#include <sys/select.h>
 
 	#ifdef DEBUGLOGMAP
 		#define DEBUGLOGPATH "log/map-server.log"
@@ -676,18 +681,177 @@ int	FPRINTF(FILE *file, const char *fmt, ...)
 
 char timestamp_format[20] = ""; //For displaying Timestamps
 
-int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
+int console_msg_async = 0; // Hand the messages to a writer thread instead of printing them on the caller's
+int console_msg_rate = 0; // Max. messages per second, the others are dropped (ShowMessage and fatal errors excepted), 0 = no limit
+char console_msg_json[256] = ""; // JSON-lines file every message is also written to, empty = none
+
+/// A formatted message, waiting for the writer thread.
+/// Allocated with the system's malloc, the memory manager isn't thread safe.
+struct showmsg_record {
+	enum msg_type flag;
+	time_t time;
+	int64 tick;
+	int len;
+	char *text; // follows the record
+};
+
+#define SHOWMSG_QUEUE_SIZE 8192 // messages, beyond that they are dropped
+#define SHOWMSG_REPEAT_FLUSH 5 // seconds after which repeats of the last message are reported
+#define SHOWMSG_WRITER_SLEEP 10 // ms the writer thread sleeps when the queue is empty, without a wakeup (windows)
+#define SHOWMSG_WRITER_WAIT 1000 // ms the writer thread waits for a wakeup at most, to report repeats
+
+static mpsc_queue showmsg_queue = NULL;
+static lfq_wakeup showmsg_wakeup = NULL; // signalled on every push, NULL on windows
+static SPIN_LOCK showmsg_output_lock; // held by the writer thread while it prints
+static rAthread showmsg_thread = NULL;
+static volatile int32 showmsg_running = 0;
+static volatile int32 showmsg_pending = 0; // queued or being written
+static volatile int32 showmsg_dropped = 0; // queue was full
+static volatile int32 showmsg_rate_count = 0;
+static volatile int32 showmsg_rate_dropped = 0;
+static time_t showmsg_rate_second = 0;
+
+// writer thread state
+static FILE *showmsg_json = NULL;
+static struct showmsg_record *showmsg_last = NULL;
+static int showmsg_repeats = 0;
+
+static const char *showmsg_level(enum msg_type flag)
 {
-	va_list apcopy;
+	switch( flag ) {
+		case MSG_STATUS: return "status";
+		case MSG_SQL: return "sql";
+		case MSG_INFORMATION: return "info";
+		case MSG_NOTICE: return "notice";
+		case MSG_WARNING: return "warning";
+		case MSG_DEBUG: return "debug";
+		case MSG_ERROR: return "error";
+		case MSG_FATALERROR: return "fatal";
+		default: return "none";
+	}
+}
+
+/// Monotonic milliseconds, for the JSON timestamps.
+static int64 showmsg_tick(void)
+{
+#ifdef WIN32
+	return (int64)GetTickCount();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/// localtime() shares its result, the writer thread can't use it
+static void showmsg_localtime(time_t t, struct tm *tm)
+{
+#ifdef WIN32
+	localtime_s(tm, &t);
+#else
+	localtime_r(&t, tm);
+#endif
+}
+
+static void showmsg_sleep(int ms)
+{
+#ifdef WIN32
+	Sleep(ms);
+#else
+	usleep(ms*1000);
+#endif
+}
+
+/// Writer thread: sleeps until a message is pushed (or a while has passed).
+static void showmsg_wait(void)
+{
+#ifndef WIN32
+	if( showmsg_wakeup ) {
+		int fd = lfq_wakeup_fd(showmsg_wakeup);
+		struct timeval timeout = { SHOWMSG_WRITER_WAIT / 1000, (SHOWMSG_WRITER_WAIT % 1000) * 1000 };
+		fd_set rfd;
+
+		FD_ZERO(&rfd);
+		FD_SET(fd, &rfd);
+		select(fd + 1, &rfd, NULL, NULL, &timeout);
+		return;
+	}
+#endif
+	showmsg_sleep(SHOWMSG_WRITER_SLEEP);
+}
+
+/// Writes the text in pieces that fit the static buffer of VFPRINTF,
+/// without cutting an escape sequence.
+static void showmsg_print(
+#ifdef _WIN32
+	HANDLE out,
+#else
+	FILE *out,
+#endif
+	const char *text, int len)
+{
+	while( len > 0 ) {
+		int n = min(len, SBUF_SIZE-1);
+
+		if( n < len ) {
+			int i;
+			for( i = n-1; i > n-16 && i > 0; i-- )
+				if( text[i] == '\033' ) {
+					n = i;
+					break;
+				}
+		}
+		FPRINTF(out, "%.*s", n, text);
+		text += n;
+		len -= n;
+	}
+}
+
+static void showmsg_write_json(const struct showmsg_record *rec)
+{
+	struct tm tm;
+	char timestring[32];
+	const char *p;
+
+	showmsg_localtime(rec->time, &tm);
+	strftime(timestring, sizeof(timestring), "%Y-%m-%dT%H:%M:%S", &tm);
+	fprintf(showmsg_json, "{\"ts\":%"PRId64",\"time\":\"%s\",\"server\":\"%s\",\"level\":\"%s\",\"msg\":\"",
+		rec->tick, timestring, SERVER_NAME ? SERVER_NAME : "", showmsg_level(rec->flag));
+	for( p = rec->text; *p; p++ ) {
+		if( *p == '\033' && p[1] == '[' ) {// drop the colors
+			const char *q = p + 2;
+			while( ISDIGIT(*q) || *q == ';' )
+				q++;
+			if( *q ) {
+				p = q;
+				continue;
+			}
+		}
+		if( *p == '\n' && p[1] == '\0' )
+			break;
+		if( *p == '"' || *p == '\\' )
+			fprintf(showmsg_json, "\\%c", *p);
+		else if( *p == '\n' )
+			fputs("\\n", showmsg_json);
+		else if( (unsigned char)*p < 0x20 )
+			fprintf(showmsg_json, "\\u%04x", (unsigned char)*p);
+		else
+			fputc(*p, showmsg_json);
+	}
+	fputs("\"}\n", showmsg_json);
+}
+
+/// Prints a formatted message: msg_log, console, JSON sink and debug log.
+/// Runs on the caller's thread, or on the writer thread with console_msg_async.
+static void showmsg_output(const struct showmsg_record *rec)
+{
+	enum msg_type flag = rec->flag;
 	char prefix[100];
+	struct tm tm;
 #if defined(DEBUGLOGMAP) || defined(DEBUGLOGCHAR) || defined(DEBUGLOGLOGIN)
 	FILE *fp;
 #endif
-	
-	if (!string || *string == '\0') {
-		ShowError("Empty string passed to _vShowMessage().\n");
-		return 1;
-	}
+
 	if(
 		( flag == MSG_WARNING && console_msg_log&1 ) ||
 		( ( flag == MSG_ERROR || flag == MSG_SQL ) && console_msg_log&2 ) ||
@@ -695,22 +859,23 @@ int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 		FILE *log = NULL;
 		if( (log = fopen(SERVER_TYPE == SERVER_TYPE_MAP ? "./log/map-msg_log.log" : "./log/unknown.log","a+")) ) {
 			char timestring[255];
-			time_t curtime;
-			time(&curtime);
-			strftime(timestring, 254, "%m/%d/%Y %H:%M:%S", localtime(&curtime));
-			fprintf(log,"(%s) [ %s ] : ",
+			showmsg_localtime(rec->time, &tm);
+			strftime(timestring, 254, "%m/%d/%Y %H:%M:%S", &tm);
+			fprintf(log,"(%s) [ %s ] : %s",
 				timestring,
 				flag == MSG_WARNING ? "Warning" :
 				flag == MSG_ERROR ? "Error" :
 				flag == MSG_SQL ? "SQL Error" :
 				flag == MSG_DEBUG ? "Debug" :
-				"Unknown");
-			va_copy(apcopy, ap);
-			vfprintf(log,string,apcopy);
-			va_end(apcopy);
+				"Unknown",
+				rec->text);
 			fclose(log);
 		}
 	}
+
+	if( showmsg_json && flag != MSG_NONE )
+		showmsg_write_json(rec);
+
 	if(
 	    (flag == MSG_INFORMATION && msg_silent&1) ||
 	    (flag == MSG_STATUS && msg_silent&2) ||
@@ -720,12 +885,12 @@ int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 	    (flag == MSG_SQL && msg_silent&16) ||
 	    (flag == MSG_DEBUG && msg_silent&32)
 	)
-		return 0; //Do not print it.
+		return; //Do not print it.
 
 	if (timestamp_format[0] && flag != MSG_NONE)
 	{	//Display time format. [Skotlex]
-		time_t t = time(NULL);
-		strftime(prefix, 80, timestamp_format, localtime(&t));
+		showmsg_localtime(rec->time, &tm);
+		strftime(prefix, 80, timestamp_format, &tm);
 	} else prefix[0]='\0';
 
 	switch (flag) {
@@ -756,23 +921,18 @@ int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 			strcat(prefix,CL_RED"[Fatal Error]"CL_RESET":");
 			break;
 		default:
-			ShowError("In function _vShowMessage() -> Invalid flag passed.\n");
-			return 1;
+			break;
 	}
 
 	if (flag == MSG_ERROR || flag == MSG_FATALERROR || flag == MSG_SQL)
 	{	//Send Errors to StdErr [Skotlex]
 		FPRINTF(STDERR, "%s ", prefix);
-		va_copy(apcopy, ap);
-		VFPRINTF(STDERR, string, apcopy);
-		va_end(apcopy);
+		showmsg_print(STDERR, rec->text, rec->len);
 		FFLUSH(STDERR);
 	} else {
 		if (flag != MSG_NONE)
 			FPRINTF(STDOUT, "%s ", prefix);
-		va_copy(apcopy, ap);
-		VFPRINTF(STDOUT, string, apcopy);
-		va_end(apcopy);
+		showmsg_print(STDOUT, rec->text, rec->len);
 		FFLUSH(STDOUT);
 	}
 
@@ -783,10 +943,7 @@ int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 			FPRINTF(STDERR, CL_RED"[ERROR]"CL_RESET": Could not open '"CL_WHITE"%s"CL_RESET"', access denied.\n", DEBUGLOGPATH);
 			FFLUSH(STDERR);
 		} else {
-			fprintf(fp,"%s ", prefix);
-			va_copy(apcopy, ap);
-			vfprintf(fp,string,apcopy);
-			va_end(apcopy);
+			fprintf(fp,"%s %s", prefix, rec->text);
 			fclose(fp);
 		}
 	} else {
@@ -794,6 +951,237 @@ int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
 		FFLUSH(STDERR);
 	}
 #endif
+}
+
+/// Writes a notice about what the writer thread skipped or dropped.
+static void showmsg_output_notice(enum msg_type flag, const char *fmt, ...)
+{
+	struct showmsg_record rec;
+	char text[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	rec.len = vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+	rec.flag = flag;
+	rec.time = time(NULL);
+	rec.tick = showmsg_tick();
+	rec.text = text;
+	showmsg_output(&rec);
+}
+
+static void showmsg_flush_repeats(void)
+{
+	if( showmsg_repeats > 0 )
+		showmsg_output_notice(showmsg_last->flag, "Last message repeated %d time%s.\n", showmsg_repeats, showmsg_repeats > 1 ? "s" : "");
+	showmsg_repeats = 0;
+	if( showmsg_last )
+		free(showmsg_last);
+	showmsg_last = NULL;
+}
+
+/// Writer thread: prints the queued messages, folding repeated warnings and errors.
+static void *showmsg_writer(void *param)
+{
+	for(;;) {
+		struct showmsg_record *rec;
+		int32 dropped;
+		bool running = InterlockedLoadAcquire(&showmsg_running) != 0;
+
+		lfq_wakeup_clear(showmsg_wakeup); // before draining, see lfq_wakeup_clear
+		while( (rec = mpsc_queue_pop(showmsg_queue)) != NULL ) {
+			EnterSpinLock(&showmsg_output_lock);
+			if( showmsg_last && (rec->flag >= MSG_WARNING || rec->flag == MSG_SQL) && rec->flag != MSG_FATALERROR
+			 && rec->flag == showmsg_last->flag && rec->len == showmsg_last->len && strcmp(rec->text, showmsg_last->text) == 0 ) {
+				showmsg_repeats++;
+				free(rec);
+			} else {
+				showmsg_flush_repeats();
+				showmsg_output(rec);
+				showmsg_last = rec;
+			}
+			LeaveSpinLock(&showmsg_output_lock);
+			InterlockedDecrement(&showmsg_pending);
+		}
+
+		EnterSpinLock(&showmsg_output_lock);
+		if( (dropped = InterlockedExchange(&showmsg_dropped, 0)) != 0 )
+			showmsg_output_notice(MSG_WARNING, "%d message%s dropped, the message queue was full.\n", dropped, dropped > 1 ? "s were" : " was");
+		if( showmsg_last && time(NULL) - showmsg_last->time >= SHOWMSG_REPEAT_FLUSH )
+			showmsg_flush_repeats();
+		if( showmsg_json )
+			fflush(showmsg_json);
+		LeaveSpinLock(&showmsg_output_lock);
+
+		if( !running && InterlockedLoadAcquire(&showmsg_pending) == 0 )
+			break;
+
+		if( InterlockedLoadAcquire(&showmsg_pending) == 0 || showmsg_wakeup )
+			showmsg_wait(); // a producer still writing its record signals once it's pushed
+		else
+			rathread_yield(); // a producer is still writing its record
+	}
+
+	EnterSpinLock(&showmsg_output_lock);
+	showmsg_flush_repeats();
+	LeaveSpinLock(&showmsg_output_lock);
+	return NULL;
+}
+
+/// Waits until the writer thread printed everything queued so far.
+static void showmsg_flush(void)
+{
+	int i;
+
+	if( !showmsg_thread )
+		return;
+
+	for( i = 0; i < 2000 && InterlockedLoadAcquire(&showmsg_pending) != 0; i++ ) // 2 seconds at most
+		showmsg_sleep(1);
+}
+
+/**
+ * Starts the writer thread when console_msg_async is set, and opens the JSON sink.
+ * Called once the server configuration is read.
+ */
+void showmsg_init(void)
+{
+	if( console_msg_json[0] && !showmsg_json ) {
+		if( (showmsg_json = fopen(console_msg_json, "a")) == NULL )
+			ShowError("showmsg_init: can't open '%s' for the JSON log.\n", console_msg_json);
+	}
+
+	if( !console_msg_async || showmsg_thread )
+		return;
+
+	showmsg_queue = mpsc_queue_create(SHOWMSG_QUEUE_SIZE);
+	showmsg_wakeup = lfq_wakeup_create();
+	InitializeSpinLock(&showmsg_output_lock);
+	InterlockedExchange(&showmsg_running, 1);
+	if( (showmsg_thread = rathread_createEx(showmsg_writer, NULL, 1024*512, RAT_PRIO_NORMAL)) == NULL ) {
+		InterlockedExchange(&showmsg_running, 0);
+		mpsc_queue_destroy(showmsg_queue);
+		showmsg_queue = NULL;
+		lfq_wakeup_destroy(showmsg_wakeup);
+		showmsg_wakeup = NULL;
+		FinalizeSpinLock(&showmsg_output_lock);
+		ShowError("showmsg_init: can't start the writer thread, messages are printed synchronously.\n");
+		return;
+	}
+	atexit(showmsg_final); // exit() without going through the core's shutdown
+	ShowInfo("Console messages are printed by a writer thread.\n");
+}
+
+/**
+ * Prints what's still queued and stops the writer thread.
+ */
+void showmsg_final(void)
+{
+	if( showmsg_thread ) {
+		InterlockedExchange(&showmsg_running, 0);
+		lfq_wakeup_signal(showmsg_wakeup);
+		rathread_wait(showmsg_thread, NULL);
+		showmsg_thread = NULL;
+		mpsc_queue_destroy(showmsg_queue);
+		showmsg_queue = NULL;
+		lfq_wakeup_destroy(showmsg_wakeup);
+		showmsg_wakeup = NULL;
+		FinalizeSpinLock(&showmsg_output_lock);
+	}
+	if( showmsg_json ) {
+		fclose(showmsg_json);
+		showmsg_json = NULL;
+	}
+}
+
+int _vShowMessage(enum msg_type flag, const char *string, va_list ap)
+{
+	va_list apcopy;
+	struct showmsg_record *rec, local;
+	char buf[SBUF_SIZE];
+	int len;
+
+	if (!string || *string == '\0') {
+		ShowError("Empty string passed to _vShowMessage().\n");
+		return 1;
+	}
+	if (flag < MSG_NONE || flag > MSG_FATALERROR) {
+		ShowError("In function _vShowMessage() -> Invalid flag passed.\n");
+		return 1;
+	}
+
+	if( console_msg_rate > 0 && flag != MSG_NONE && flag != MSG_FATALERROR ) {
+		time_t now = time(NULL);
+		if( now != showmsg_rate_second ) {
+			int32 dropped = InterlockedExchange(&showmsg_rate_dropped, 0);
+			showmsg_rate_second = now;
+			InterlockedExchange(&showmsg_rate_count, 0);
+			if( dropped )
+				ShowWarning("%d message%s dropped, more than console_msg_rate (%d) per second.\n", dropped, dropped > 1 ? "s were" : " was", console_msg_rate);
+		}
+		if( InterlockedIncrement(&showmsg_rate_count) > console_msg_rate ) {
+			InterlockedIncrement(&showmsg_rate_dropped);
+			return 0;
+		}
+	}
+
+	// format once, on the caller's stack unless it doesn't fit
+	va_copy(apcopy, ap);
+	len = vsnprintf(buf, sizeof(buf), string, apcopy);
+	va_end(apcopy);
+	if( len < 0 )
+		return 1;
+
+	if( showmsg_thread && flag != MSG_FATALERROR ) {
+		if( (rec = (struct showmsg_record *)malloc(sizeof(struct showmsg_record) + len + 1)) == NULL )
+			return 1;
+		rec->text = (char *)(rec + 1);
+		if( len < (int)sizeof(buf) )
+			memcpy(rec->text, buf, len + 1);
+		else {
+			va_copy(apcopy, ap);
+			vsnprintf(rec->text, len + 1, string, apcopy);
+			va_end(apcopy);
+		}
+		rec->flag = flag;
+		rec->time = time(NULL);
+		rec->tick = showmsg_json ? showmsg_tick() : 0;
+		rec->len = len;
+
+		InterlockedIncrement(&showmsg_pending);
+		if( !mpsc_queue_push(showmsg_queue, rec) ) {
+			InterlockedDecrement(&showmsg_pending);
+			InterlockedIncrement(&showmsg_dropped);
+			free(rec);
+		}
+		lfq_wakeup_signal(showmsg_wakeup);
+		return 0;
+	}
+
+	// synchronous: fatal errors get out right away, after what's already queued
+	if( flag == MSG_FATALERROR )
+		showmsg_flush();
+
+	local.flag = flag;
+	local.time = time(NULL);
+	local.tick = showmsg_json ? showmsg_tick() : 0;
+	local.len = len;
+	local.text = buf;
+	if( len >= (int)sizeof(buf) ) {
+		if( (local.text = (char *)malloc(len + 1)) == NULL )
+			return 1;
+		va_copy(apcopy, ap);
+		vsnprintf(local.text, len + 1, string, apcopy);
+		va_end(apcopy);
+	}
+	if( showmsg_thread ) { // not in the middle of something the writer thread is printing
+		EnterSpinLock(&showmsg_output_lock);
+		showmsg_output(&local);
+		LeaveSpinLock(&showmsg_output_lock);
+	} else
+		showmsg_output(&local);
+	if( local.text != buf )
+		free(local.text);
 
 	return 0;
 }
@@ -73,6 +73,9 @@ extern int stdout_with_ansisequence; //If the color ansi sequences are to be use
 extern int msg_silent; //Specifies how silent the console is. [Skotlex]
 extern int console_msg_log; //Specifies what error messages to log. [Ind]
 extern char timestamp_format[20]; //For displaying Timestamps [Skotlex]
+extern int console_msg_async; //Print the messages on a writer thread.
+extern int console_msg_rate; //Max. messages per second, 0 = no limit.
+extern char console_msg_json[256]; //JSON-lines file the messages are also written to.
 
 enum msg_type {
 	MSG_NONE,
@@ -87,6 +90,8 @@ enum msg_type {
 };
 
 extern void ClearScreen(void);
+extern void showmsg_init(void);
+extern void showmsg_final(void);
 #ifndef _HPMi_H_
 	extern void ShowMessage(const char *, ...);
 	extern void ShowStatus(const char *, ...);
@@ -5,6 +5,7 @@
 #include "../common/cbasetypes.h"
 #include "../common/mmo.h"
 #include "../common/timer.h"
+#include "../common/profiler.h"
 #include "../common/malloc.h"
 #include "../common/showmsg.h"
 #include "../common/strlib.h"
@@ -240,7 +241,20 @@ static time_t socket_data_last_tick = 0;
 // The connection is closed if it goes over the limit.
 #define WFIFO_MAX (1*1024*1024)
 
+// Frame budget (packet.conf)
+static int parse_budget = 0; // max. microseconds parsing client sessions per loop, 0 = no limit
+static int parse_resume = 0; // first client session left over by the last loop, 0 = none
+static unsigned int parse_overruns = 0;
+
 #ifdef SEND_SHORTLIST
+// Flush coalescing (packet.conf)
+static size_t send_defer_size = 0; // client sessions with less pending data are left for the next frame's first flush
+static int send_syscall_budget = 0; // max. sends to clients in the flush after receiving, 0 = no limit
+static int send_stats = 0; // seconds between send statistics reports, 0 = off
+static unsigned int send_stat_calls = 0, send_stat_frames = 0, send_stat_deferred = 0;
+static uint64 send_stat_bytes = 0;
+static time_t send_stat_last_tick = 0;
+
 int send_shortlist_array[FD_SETSIZE];// we only support FD_SETSIZE sockets, limit the array to that
 int send_shortlist_count = 0;// how many fd's are in the shortlist
 uint32 send_shortlist_set[(FD_SETSIZE+31)/32];// to know if specific fd's are already in the shortlist
@@ -386,6 +400,7 @@ int send_from_fifo(int fd)
 		return 0; // nothing to send
 
 	len = sSend(fd, (const char *) session[fd]->wdata, (int)session[fd]->wdata_size, MSG_NOSIGNAL);
+	send_stat_calls++;
 
 	if( len == SOCKET_ERROR )
 	{//An exception has occured
@@ -402,6 +417,7 @@ int send_from_fifo(int fd)
 
 	if( len > 0 )
 	{
+		send_stat_bytes += len;
 		// some data could not be transferred?
 		// shift unsent data to the beginning of the queue
 		if( (size_t)len < session[fd]->wdata_size )
@@ -623,6 +639,39 @@ static void delete_session(int fd)
 	}
 }
 
+/// Watches a descriptor that isn't a socket (eventfd, pipe) in the main loop.
+/// func_recv is called whenever it becomes readable and has to drain it.
+/// Not available on windows, where select() only takes sockets.
+int socket_watch_fd(int fd, RecvFunc func_recv)
+{
+#ifdef WIN32
+	return -1;
+#else
+	if( fd <= 0 || fd >= FD_SETSIZE || session[fd] ) {
+		ShowError("socket_watch_fd: can't watch descriptor #%d.\n", fd);
+		return -1;
+	}
+
+	if (fd_max <= fd) fd_max = fd + 1;
+	sFD_SET(fd,&readfds);
+
+	create_session(fd, func_recv, null_send, null_parse);
+	session[fd]->rdata_tick = 0; // never times out
+
+	return fd;
+#endif
+}
+
+/// Stops watching a descriptor added with socket_watch_fd, without closing it.
+void socket_unwatch_fd(int fd)
+{
+	if( fd <= 0 || fd >= FD_SETSIZE || !session[fd] )
+		return;
+
+	sFD_CLR(fd, &readfds);
+	delete_session(fd);
+}
+
 int realloc_fifo(int fd, unsigned int rfifo_size, unsigned int wfifo_size)
 {
 	if( !session_isValid(fd) )
@@ -769,7 +818,7 @@ int do_sockets(int next)
 	// PRESEND Timers are executed before do_sendrecv and can send packets and/or set sessions to eof.
 	// Send remaining data and process client-side disconnects here.
 #ifdef SEND_SHORTLIST
-	send_shortlist_do_sends();
+	send_shortlist_do_sends(false);
 #else
 	for (i = 1; i < fd_max; i++)
 	{
@@ -781,12 +830,22 @@ int do_sockets(int next)
 	}
 #endif
 
-	// can timeout until the next tick
+	// can timeout until the next tick, unless sessions were left unparsed
+	if( parse_resume )
+		next = 0;
 	timeout.tv_sec  = next/1000;
 	timeout.tv_usec = next%1000*1000;
 
 	memcpy(&rfd, &readfds, sizeof(rfd));
+#ifndef MINICORE
+	{
+		int64 zone = profiler->begin();
+		ret = sSelect(fd_max, &rfd, NULL, NULL, &timeout);
+		profiler->end(PROFILER_IDLE, 0, zone);
+	}
+#else
 	ret = sSelect(fd_max, &rfd, NULL, NULL, &timeout);
+#endif
 
 	if( ret == SOCKET_ERROR )
 	{
@@ -821,8 +880,9 @@ int do_sockets(int next)
 #endif
 
 	// POSTSEND Send remaining data and handle eof sessions.
+	// Small client flushes may be deferred to the next PRESEND, which runs after the timers.
 #ifdef SEND_SHORTLIST
-	send_shortlist_do_sends();
+	send_shortlist_do_sends(true);
 #else
 	for (i = 1; i < fd_max; i++)
 	{
@@ -840,32 +900,53 @@ int do_sockets(int next)
 #endif
 
 	// parse input data on each socket
-	for(i = 1; i < fd_max; i++)
+	// Once parse_budget is used up, the remaining client sessions are left for the next loop,
+	// which starts with them; server links are always parsed.
 	{
-		if(!session[i])
-			continue;
+		int64 start = parse_budget ? timer->microtick() : 0;
+		int first = ( parse_resume > 0 && parse_resume < fd_max ) ? parse_resume : 1;
+		int n, count = fd_max - 1, parsed = 0;
 
-		if (session[i]->rdata_tick && DIFF_TICK(last_tick, session[i]->rdata_tick) > stall_time) {
-			if( session[i]->flag.server ) {/* server is special */
-				if( session[i]->flag.ping != 2 )/* only update if necessary otherwise it'd resend the ping unnecessarily */
-					session[i]->flag.ping = 1;
-			} else {
-				ShowInfo("Session #%d timed out\n", i);
-				set_eof(i);
+		parse_resume = 0;
+		for( n = 0; n < count; n++ )
+		{
+			i = ( first - 1 + n ) % count + 1;
+			if(!session[i])
+				continue;
+
+			if( !session[i]->flag.server ) {
+				if( parse_resume )
+					continue;
+				if( start && parsed && timer->microtick() - start >= parse_budget ) {
+					parse_resume = i;
+					parse_overruns++;
+					continue;
+				}
+				parsed++;
 			}
-		}
 
-		session[i]->func_parse(i);
+			if (session[i]->rdata_tick && DIFF_TICK(last_tick, session[i]->rdata_tick) > stall_time) {
+				if( session[i]->flag.server ) {/* server is special */
+					if( session[i]->flag.ping != 2 )/* only update if necessary otherwise it'd resend the ping unnecessarily */
+						session[i]->flag.ping = 1;
+				} else {
+					ShowInfo("Session #%d timed out\n", i);
+					set_eof(i);
+				}
+			}
 
-		if(!session[i])
-			continue;
+			session[i]->func_parse(i);
 
-		// after parse, check client's RFIFO size to know if there is an invalid packet (too big and not parsed)
-		if (session[i]->rdata_size == session[i]->max_rdata) {
-			set_eof(i);
-			continue;
+			if(!session[i])
+				continue;
+
+			// after parse, check client's RFIFO size to know if there is an invalid packet (too big and not parsed)
+			if (session[i]->rdata_size == session[i]->max_rdata) {
+				set_eof(i);
+				continue;
+			}
+			RFIFOFLUSH(i);
 		}
-		RFIFOFLUSH(i);
 	}
 
 #ifdef SHOW_SERVER_STATS
@@ -885,7 +966,21 @@ int do_sockets(int next)
 	}
 #endif
 
-	return 0;
+	send_stat_frames++;
+	if( send_stats && last_tick - send_stat_last_tick >= send_stats ) {
+		if( send_stat_last_tick && send_stat_frames )
+			ShowInfo("Sends: '"CL_WHITE"%.1f"CL_RESET"' syscalls/frame, '"CL_WHITE"%.1f"CL_RESET"' bytes/syscall, '"CL_WHITE"%u"CL_RESET"' flushes deferred.\n",
+				(double)send_stat_calls/send_stat_frames, send_stat_calls ? (double)send_stat_bytes/send_stat_calls : 0., send_stat_deferred);
+		if( send_stat_last_tick )
+			ShowInfo("Frames: '"CL_WHITE"%u"CL_RESET"' timer overruns, '"CL_WHITE"%u"CL_RESET"' parse overruns, '"CL_WHITE"%u"CL_RESET"' deferred tasks run late.\n",
+				timer->overruns, parse_overruns, timer->deferred_late);
+		timer->overruns = timer->deferred_late = parse_overruns = 0;
+		send_stat_last_tick = last_tick;
+		send_stat_calls = send_stat_frames = send_stat_deferred = 0;
+		send_stat_bytes = 0;
+	}
+
+	return parse_resume != 0;
 }
 
 //////////////////////////////
@@ -1148,6 +1243,18 @@ int socket_config_read(const char* cfgName)
 			if( stall_time < 3 )
 				stall_time = 3;/* a minimum is required to refrain it from killing itself */
 		}
+		else if (!strcmpi(w1, "send_defer_size"))
+			send_defer_size = (size_t)max(atoi(w2), 0);
+		else if (!strcmpi(w1, "send_syscall_budget"))
+			send_syscall_budget = max(atoi(w2), 0);
+		else if (!strcmpi(w1, "send_stats"))
+			send_stats = max(atoi(w2), 0);
+		else if (!strcmpi(w1, "timer_budget"))
+			timer->budget = max(atoi(w2), 0) * 1000;
+		else if (!strcmpi(w1, "parse_budget"))
+			parse_budget = max(atoi(w2), 0) * 1000;
+		else if (!strcmpi(w1, "idle_budget"))
+			timer->idle_budget = max(atoi(w2), 0) * 1000;
 #ifndef MINICORE
 		else if (!strcmpi(w1, "enable_ip_rules")) {
 			ip_rules = config_switch(w2);
@@ -1546,9 +1653,11 @@ void send_shortlist_add_fd(int fd)
 }
 
 // Do pending network sends and eof handling from the shortlist.
-void send_shortlist_do_sends()
+// With defer set, client sessions with little pending data (send_defer_size)
+// or past send_syscall_budget stay in the shortlist for the next call.
+void send_shortlist_do_sends(bool defer)
 {
-	int i;
+	int i, sends = 0;
 
 	for( i = send_shortlist_count-1; i >= 0; --i )
 	{
@@ -1556,6 +1665,14 @@ void send_shortlist_do_sends()
 		int idx = fd/32;
 		int bit = fd%32;
 
+		if( defer && fd > 0 && fd < FD_SETSIZE && session[fd] && !session[fd]->flag.server && !session[fd]->flag.eof
+		&&  session[fd]->wdata_size && session[fd]->wdata_size < session[fd]->max_wdata/2 // don't let the buffer grow for it
+		&&  (session[fd]->wdata_size < send_defer_size || (send_syscall_budget && sends >= send_syscall_budget)) )
+		{
+			send_stat_deferred++;
+			continue;
+		}
+
 		// Remove fd from shortlist, move the last fd to the current position
 		--send_shortlist_count;
 		send_shortlist_array[i] = send_shortlist_array[send_shortlist_count];
@@ -1577,8 +1694,10 @@ void send_shortlist_do_sends()
 		if( session[fd] )
 		{
 			// Send data
-			if( session[fd]->wdata_size )
+			if( session[fd]->wdata_size ) {
 				session[fd]->func_send(fd);
+				sends++;
+			}
 
 			// If it's been marked as eof, call the parse func on it so that
 			// the socket will be immediately closed.
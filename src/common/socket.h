@@ -126,6 +126,8 @@ extern bool session_isActive(int fd);
 
 int make_listen_bind(uint32 ip, uint16 port);
 int make_connection(uint32 ip, uint16 port, struct hSockOpt *opt);
+int socket_watch_fd(int fd, RecvFunc func_recv);
+void socket_unwatch_fd(int fd);
 int realloc_fifo(int fd, unsigned int rfifo_size, unsigned int wfifo_size);
 int realloc_writefifo(int fd, size_t addition);
 int WFIFOSET(int fd, size_t len);
@@ -171,8 +173,9 @@ void socket_datasync(int fd, bool send);
 // Add a fd to the shortlist so that it'll be recognized as a fd that needs
 // sending done on it.
 void send_shortlist_add_fd(int fd);
-// Do pending network sends (and eof handling) from the shortlist.
-void send_shortlist_do_sends();
+// Do pending network sends (and eof handling) from the shortlist,
+// small client sends may be deferred to the next call when defer is set.
+void send_shortlist_do_sends(bool defer);
 #endif
 
 #endif /* _SOCKET_H_ */
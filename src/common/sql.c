@@ -7,6 +7,7 @@
 #include "../common/showmsg.h"
 #include "../common/strlib.h"
 #include "../common/timer.h"
+#include "../common/profiler.h"
 #include "sql.h"
 
 #ifdef WIN32
@@ -255,19 +256,26 @@ int Sql_Query(Sql* self, const char* query, ...)
 /// Executes a query.
 int Sql_QueryV(Sql* self, const char* query, va_list args)
 {
+	int64 zone;
+	int rc;
+
 	if( self == NULL )
 		return SQL_ERROR;
 
 	SQL->FreeResult(self);
 	StrBuf->Clear(&self->buf);
 	StrBuf->Vprintf(&self->buf, query, args);
-	if( mysql_real_query(&self->handle, StrBuf->Value(&self->buf), (unsigned long)StrBuf->Length(&self->buf)) )
+	zone = profiler->begin();
+	rc = mysql_real_query(&self->handle, StrBuf->Value(&self->buf), (unsigned long)StrBuf->Length(&self->buf));
+	if( !rc )
+		self->result = mysql_store_result(&self->handle);
+	profiler->end(PROFILER_SQL, 0, zone);
+	if( rc )
 	{
 		ShowSQL("DB error - %s\n", mysql_error(&self->handle));
 		hercules_mysql_error_handler(mysql_errno(&self->handle));
 		return SQL_ERROR;
 	}
-	self->result = mysql_store_result(&self->handle);
 	if( mysql_errno(&self->handle) != 0 )
 	{
 		ShowSQL("DB error - %s\n", mysql_error(&self->handle));
@@ -282,19 +290,26 @@ int Sql_QueryV(Sql* self, const char* query, va_list args)
 /// Executes a query.
 int Sql_QueryStr(Sql* self, const char* query)
 {
+	int64 zone;
+	int rc;
+
 	if( self == NULL )
 		return SQL_ERROR;
 
 	SQL->FreeResult(self);
 	StrBuf->Clear(&self->buf);
 	StrBuf->AppendStr(&self->buf, query);
-	if( mysql_real_query(&self->handle, StrBuf->Value(&self->buf), (unsigned long)StrBuf->Length(&self->buf)) )
+	zone = profiler->begin();
+	rc = mysql_real_query(&self->handle, StrBuf->Value(&self->buf), (unsigned long)StrBuf->Length(&self->buf));
+	if( !rc )
+		self->result = mysql_store_result(&self->handle);
+	profiler->end(PROFILER_SQL, 0, zone);
+	if( rc )
 	{
 		ShowSQL("DB error - %s\n", mysql_error(&self->handle));
 		hercules_mysql_error_handler(mysql_errno(&self->handle));
 		return SQL_ERROR;
 	}
-	self->result = mysql_store_result(&self->handle);
 	if( mysql_errno(&self->handle) != 0 )
 	{
 		ShowSQL("DB error - %s\n", mysql_error(&self->handle));
@@ -706,12 +721,18 @@ int SqlStmt_BindParam(SqlStmt* self, size_t idx, enum SqlDataType buffer_type, v
 /// Executes the prepared statement.
 int SqlStmt_Execute(SqlStmt* self)
 {
+	int64 zone;
+	int rc;
+
 	if( self == NULL )
 		return SQL_ERROR;
 
 	SQL->StmtFreeResult(self);
-	if( (self->bind_params && mysql_stmt_bind_param(self->stmt, self->params)) ||
-		mysql_stmt_execute(self->stmt) )
+	zone = profiler->begin();
+	rc = ( (self->bind_params && mysql_stmt_bind_param(self->stmt, self->params)) ||
+		mysql_stmt_execute(self->stmt) );
+	profiler->end(PROFILER_SQL, 1, zone);
+	if( rc )
 	{
 		ShowSQL("DB error - %s\n", mysql_stmt_error(self->stmt));
 		hercules_mysql_error_handler(mysql_stmt_errno(self->stmt));
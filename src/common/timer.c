@@ -7,6 +7,7 @@
 #include "../common/malloc.h"
 #include "../common/showmsg.h"
 #include "../common/utils.h"
+#include "../common/profiler.h"
 #include "timer.h"
 
 #include <stdio.h>
@@ -28,6 +29,9 @@ struct timer_interface timer_s;
 #define TIMER_MIN_INTERVAL 50
 #define TIMER_MAX_INTERVAL 1000
 
+// Deferred tasks that waited this long (ms) run even when there is no idle time.
+#define TIMER_DEFER_MAX_DELAY 5000
+
 // timers (array)
 static struct TimerData* timer_data = NULL;
 static int timer_data_max = 0;
@@ -50,6 +54,24 @@ static int free_timer_list_pos = 0;
 // timer heap (binary heap of tid's)
 static BHEAP_VAR(int, timer_heap);
 
+// deferred tasks (FIFO array, [deferred_head, deferred_num) are pending)
+struct timer_deferred {
+	TimerFunc func;
+	int id;
+	intptr_t data;
+	int64 tick; // when it was queued
+};
+static struct timer_deferred* deferred_list = NULL;
+static int deferred_max = 0;
+static int deferred_num = 0;
+static int deferred_head = 0;
+
+// pending deferred tasks by (func, id, data), for timer_defer's duplicate check
+// (open addressing, linear probing, func NULL = free slot)
+static struct timer_deferred* deferred_index = NULL;
+static int deferred_index_max = 0; // power of two
+static int deferred_index_num = 0;
+
 
 // server startup time
 time_t start_time;
@@ -197,6 +219,31 @@ static int64 tick(void) {
 #endif
 }
 
+/**
+ * Microseconds since an unspecified starting point, for measuring durations.
+ * Uses the same clock source as tick() where it has a better resolution.
+ **/
+int64 timer_microtick(void) {
+#if defined(WIN32)
+	static LARGE_INTEGER freq = { 0 };
+	LARGE_INTEGER count;
+	if( !freq.QuadPart )
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (int64)(count.QuadPart / freq.QuadPart * 1000000 + count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#elif defined(ENABLE_RDTSC)
+	return (int64)((_rdtsc() - RDTSC_BEGINTICK) / max(RDTSC_CLOCK / 1000, 1));
+#elif defined(HAVE_MONOTONIC_CLOCK)
+	struct timespec tval;
+	clock_gettime(CLOCK_MONOTONIC, &tval);
+	return (int64)tval.tv_sec * 1000000 + tval.tv_nsec / 1000;
+#else
+	struct timeval tval;
+	gettimeofday(&tval, NULL);
+	return (int64)tval.tv_sec * 1000000 + tval.tv_usec;
+#endif
+}
+
 //////////////////////////////////////////////////////////////////////////
 #if defined(TICK_CACHE) && TICK_CACHE > 1
 //////////////////////////////////////////////////////////////////////////
@@ -370,8 +417,11 @@ int64 timer_settick(int tid, int64 tick) {
 
 /// Executes all expired timers.
 /// Returns the value of the smallest non-expired timer (or 1 second if there aren't any).
+/// Stops early once timer->budget is used up, leaving the remaining expired
+/// timers in the heap for the next loop; returns 0 then, so the loop doesn't sleep.
 int do_timer(int64 tick) {
 	int64 diff = TIMER_MAX_INTERVAL; // return value
+	int64 start = timer->budget ? timer->microtick() : 0;
 
 	// process all timers one by one
 	while( BHEAP_LENGTH(timer_heap) ) {
@@ -386,11 +436,16 @@ int do_timer(int64 tick) {
 		timer_data[tid].type |= TIMER_REMOVE_HEAP;
 
 		if( timer_data[tid].func ) {
+			TimerFunc func = timer_data[tid].func;
+			int64 zone = profiler->begin();
+
 			if( diff < -1000 )
 				// timer was delayed for more than 1 second, use current tick instead
-				timer_data[tid].func(tid, tick, timer_data[tid].id, timer_data[tid].data);
+				func(tid, tick, timer_data[tid].id, timer_data[tid].data);
 			else
-				timer_data[tid].func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+				func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+
+			profiler->end(PROFILER_TIMER, (uintptr_t)func, zone);
 		}
 
 		// in the case the function didn't change anything...
@@ -417,11 +472,136 @@ int do_timer(int64 tick) {
 				break;
 			}
 		}
+
+		if( start && timer->microtick() - start >= timer->budget
+		 && BHEAP_LENGTH(timer_heap) && DIFF_TICK(timer_data[BHEAP_PEEK(timer_heap)].tick, tick) <= 0 ) {
+			timer->overruns++;
+			return 0;
+		}
 	}
 
 	return (int)cap_value(diff, TIMER_MIN_INTERVAL, TIMER_MAX_INTERVAL);
 }
 
+static int timer_deferred_hash(TimerFunc func, int id, intptr_t data) {
+	uint32 hash = (uint32)(uintptr_t)func * 2654435761U;
+	hash = (hash ^ (uint32)id) * 2654435761U;
+	hash = (hash ^ (uint32)data) * 2654435761U;
+	return (int)(hash >> 8) & (deferred_index_max - 1);
+}
+
+/// Returns the index slot of the task, or the free slot where it goes.
+static int timer_deferred_slot(TimerFunc func, int id, intptr_t data) {
+	int i = timer_deferred_hash(func, id, data);
+
+	while( deferred_index[i].func != NULL && (deferred_index[i].func != func || deferred_index[i].id != id || deferred_index[i].data != data) )
+		i = (i + 1) & (deferred_index_max - 1);
+	return i;
+}
+
+/// Rebuilds the index of the pending tasks with room for at least 'count' of them.
+static void timer_deferred_reindex(int count) {
+	int i;
+
+	while( deferred_index_max < count * 2 )
+		deferred_index_max = deferred_index_max ? deferred_index_max * 2 : 64;
+	if( deferred_index )
+		aFree(deferred_index);
+	CREATE(deferred_index, struct timer_deferred, deferred_index_max);
+	deferred_index_num = deferred_num - deferred_head;
+	for( i = deferred_head; i < deferred_num; i++ )
+		deferred_index[timer_deferred_slot(deferred_list[i].func, deferred_list[i].id, deferred_list[i].data)] = deferred_list[i];
+}
+
+/// Removes a task that is about to run from the index (backward shift, no tombstones).
+static void timer_deferred_unindex(TimerFunc func, int id, intptr_t data) {
+	int i = timer_deferred_slot(func, id, data), j = i;
+
+	if( deferred_index[i].func == NULL )
+		return;
+	deferred_index_num--;
+	for(;;) {
+		int home;
+
+		deferred_index[i].func = NULL;
+		do {
+			j = (j + 1) & (deferred_index_max - 1);
+			if( deferred_index[j].func == NULL )
+				return;
+			home = timer_deferred_hash(deferred_index[j].func, deferred_index[j].id, deferred_index[j].data);
+		} while( ((j - home) & (deferred_index_max - 1)) < ((j - i) & (deferred_index_max - 1)) ); // j may stay, it's between its home and i
+		deferred_index[i] = deferred_index[j];
+		i = j;
+	}
+}
+
+/// Queues a task to run when the loop has nothing else to do (see timer_do_deferred).
+/// The function is called with tid INVALID_TIMER.
+/// Returns false if the same task (func, id, data) is already pending.
+bool timer_defer(TimerFunc func, int id, intptr_t data) {
+	int i;
+
+	if( (deferred_index_num + 1) * 2 > deferred_index_max )
+		timer_deferred_reindex(deferred_index_num + 1);
+	i = timer_deferred_slot(func, id, data);
+	if( deferred_index[i].func != NULL )
+		return false; // coalesced
+
+	if( deferred_head > 0 && deferred_num == deferred_max ) {// reuse the room of the tasks already done
+		memmove(deferred_list, deferred_list + deferred_head, (deferred_num - deferred_head) * sizeof(struct timer_deferred));
+		deferred_num -= deferred_head;
+		deferred_head = 0;
+	}
+	if( deferred_num == deferred_max ) {
+		deferred_max += 64;
+		RECREATE(deferred_list, struct timer_deferred, deferred_max);
+	}
+
+	deferred_list[deferred_num].func = func;
+	deferred_list[deferred_num].id = id;
+	deferred_list[deferred_num].data = data;
+	deferred_list[deferred_num].tick = timer->gettick();
+	deferred_index[i] = deferred_list[deferred_num];
+	deferred_index_num++;
+	deferred_num++;
+	return true;
+}
+
+/// Runs deferred tasks, oldest first, in the time left until the next timer
+/// (next, in ms) but at most timer->idle_budget microseconds.
+/// Tasks pending for TIMER_DEFER_MAX_DELAY run regardless, so they are never starved.
+/// Returns next, less the time spent.
+int timer_do_deferred(int64 tick, int next) {
+	int64 start = timer->microtick(), now = start;
+	int64 slack = (int64)next * 1000;
+
+	if( timer->idle_budget && slack > timer->idle_budget )
+		slack = timer->idle_budget;
+
+	while( deferred_head < deferred_num ) {
+		struct timer_deferred task = deferred_list[deferred_head];
+		int64 zone;
+
+		if( DIFF_TICK(tick, task.tick) >= TIMER_DEFER_MAX_DELAY )
+			timer->deferred_late++;
+		else if( timer->idle_budget && now - start >= slack )
+			break; // no time left, wait for the next idle loop
+
+		deferred_head++; // the task may queue new ones
+		timer_deferred_unindex(task.func, task.id, task.data);
+		zone = profiler->begin();
+		task.func(INVALID_TIMER, tick, task.id, task.data);
+		profiler->end(PROFILER_TIMER, (uintptr_t)task.func, zone);
+		now = timer->microtick();
+	}
+
+	if( deferred_head == deferred_num )
+		deferred_head = deferred_num = 0;
+
+	next -= (int)((now - start) / 1000);
+	return max(next, 0);
+}
+
 unsigned long timer_get_uptime(void) {
 	return (unsigned long)difftime(time(NULL), start_time);
 }
@@ -448,6 +628,12 @@ void timer_final(void) {
 	if (timer_data) aFree(timer_data);
 	BHEAP_CLEAR(timer_heap);
 	if (free_timer_list) aFree(free_timer_list);
+	if (deferred_list) aFree(deferred_list);
+	deferred_list = NULL;
+	deferred_max = deferred_num = deferred_head = 0;
+	if (deferred_index) aFree(deferred_index);
+	deferred_index = NULL;
+	deferred_index_max = deferred_index_num = 0;
 }
 /*=====================================
 * Default Functions : timer.h 
@@ -457,18 +643,28 @@ void timer_final(void) {
 void timer_defaults(void) {
 	timer = &timer_s;
 
+	/* vars */
+	timer->budget = 0;
+	timer->idle_budget = 5000;
+	timer->overruns = 0;
+	timer->deferred_late = 0;
+
 	/* funcs */
 	timer->gettick = timer_gettick;
 	timer->gettick_nocache = timer_gettick_nocache;
 	timer->add = timer_add;
 	timer->add_interval = timer_add_interval;
 	timer->add_func_list = timer_add_func_list;
+	timer->func_name = search_timer_func_list;
 	timer->get = timer_get;
 	timer->delete = timer_do_delete;
 	timer->addtick = timer_addtick;
 	timer->settick = timer_settick;
 	timer->get_uptime = timer_get_uptime;
+	timer->microtick = timer_microtick;
 	timer->do_timer = do_timer;
+	timer->defer = timer_defer;
+	timer->do_deferred = timer_do_deferred;
 	timer->init = timer_init;
 	timer->final = timer_final;
 }
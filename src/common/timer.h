@@ -40,6 +40,12 @@ struct TimerData {
 *-------------------------------------*/
 struct timer_interface {
 
+	/* vars */
+	int budget; // max. microseconds spent on expired timers per loop, 0 = no limit
+	int idle_budget; // max. microseconds of deferred tasks per loop, 0 = run them all right away
+	unsigned int overruns; // loops that left expired timers for the next one
+	unsigned int deferred_late; // deferred tasks run without idle time because they waited too long
+
 	/* funcs */
 	int64 (*gettick) (void);
 	int64 (*gettick_nocache) (void);
@@ -53,10 +59,14 @@ struct timer_interface {
 	int64 (*settick) (int tid, int64 tick);
 
 	int (*add_func_list) (TimerFunc func, char* name);
+	char* (*func_name) (TimerFunc func);
 
 	unsigned long (*get_uptime) (void);
+	int64 (*microtick) (void);
 
 	int (*do_timer) (int64 tick);
+	bool (*defer) (TimerFunc func, int id, intptr_t data);
+	int (*do_deferred) (int64 tick, int next);
 	void (*init) (void);
 	void (*final) (void);
 };
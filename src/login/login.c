@@ -1595,6 +1595,12 @@ int login_config_read(const char* cfgName)
 			safestrncpy(timestamp_format, w2, 20);
 		else if(!strcmpi(w1,"stdout_with_ansisequence"))
 			stdout_with_ansisequence = config_switch(w2);
+		else if(!strcmpi(w1,"console_msg_async"))
+			console_msg_async = config_switch(w2);
+		else if(!strcmpi(w1,"console_msg_rate"))
+			console_msg_rate = max(atoi(w2), 0);
+		else if(!strcmpi(w1,"console_msg_json"))
+			safestrncpy(console_msg_json, w2, sizeof(console_msg_json));
 		else if(!strcmpi(w1,"console_silent")) {
 			msg_silent = atoi(w2);
 			if( msg_silent ) /* only bother if we actually have this enabled */
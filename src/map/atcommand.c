@@ -8444,6 +8444,29 @@ ACMD(unloadnpcfile) {
 	}
 	return true;
 }
+/*==========================================
+ * @reloadnpcfile [<file name>]
+ * Reloads the NPCs and monster spawns of a single file,
+ * or of every file modified since it was loaded.
+ *------------------------------------------*/
+ACMD(reloadnpcfile) {
+	int count;
+
+	if( message && *message ) {
+		if( !npc->src_file(message) ) {
+			clif->message(fd, msg_txt(1490)); // File is not a loaded NPC file. Usage: @reloadnpcfile [<file name>]
+			return false;
+		}
+		count = npc->reloadfile(message);
+	} else if( (count = npc->reload_changed()) == 0 ) {
+		clif->message(fd, msg_txt(1492)); // No NPC file has been modified.
+		return true;
+	}
+
+	sprintf(atcmd_output, msg_txt(1491), count); // Reloaded %d NPC file(s). Be aware that mapflags are not reset.
+	clif->message(fd, atcmd_output);
+	return true;
+}
 ACMD(cart) {
 #define MC_CART_MDFY(x,idx) \
 sd->status.skill[idx].id = x?MC_PUSHCART:0; \
@@ -9448,6 +9471,7 @@ void atcommand_basecommands(void) {
 		ACMD_DEF(addperm),
 		ACMD_DEF2("rmvperm", addperm),
 		ACMD_DEF(unloadnpcfile),
+		ACMD_DEF(reloadnpcfile),
 		ACMD_DEF(cart),
 		ACMD_DEF(mount2),
 		ACMD_DEF(join),
@@ -6473,6 +6473,11 @@ static const struct _battle_data {
 	{ "idletime_criteria",                  &battle_config.idletime_criteria,            0x25,      1,      INT_MAX,        },
 
 	{ "mon_trans_disable_in_gvg",           &battle_config.mon_trans_disable_in_gvg,        0,      0,      1,              },
+	{ "npc_file_watch",                     &battle_config.npc_file_watch,                  0,      0,      1,              },
+	{ "item_bonus_cache",                   &battle_config.item_bonus_cache,                1,      0,      1,              },
+	{ "status_calc_stats",                  &battle_config.status_calc_stats,               0,      0,      3600,           },
+	{ "aoi_batch",                          &battle_config.aoi_batch,                       0,      0,      1,              },
+	{ "aoi_stats",                          &battle_config.aoi_stats,                       0,      0,      3600,           },
 };
 #ifndef STATS_OPT_OUT
 /**
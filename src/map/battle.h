@@ -465,6 +465,12 @@ struct Battle_Config {
 	int feature_auction;
 
 	int mon_trans_disable_in_gvg;
+
+	int npc_file_watch;
+	int item_bonus_cache;
+	int status_calc_stats;
+	int aoi_batch;
+	int aoi_stats;
 } battle_config;
 
 /* criteria for battle_config.idletime_critera */
@@ -86,6 +86,8 @@ struct chrif_interface chrif_s;
 //2b25: Incoming, chrif_deadopt -> 'Removes baby from Father ID and Mother ID'
 //2b26: Outgoing, chrif_authreq -> 'client authentication request'
 //2b27: Incoming, chrif_authfail -> 'client authentication failed'
+//2b28: Outgoing, chrif_send_mapload -> 'users on each map we host'
+//2b29: Incoming, chrif_mapowner -> 'maps moved to another map-server (or to us)'
 
 //This define should spare writing the check in every function. [Skotlex]
 #define chrif_check(a) { if(!chrif->isconnected()) return a; }
@@ -316,6 +318,8 @@ int chrif_sendmap(int fd) {
 	
 	ShowStatus("Sending maps to char server...\n");
 	
+	map->standby_reset(); // until the char-server says otherwise
+	
 	// Sending normal maps, not instances
 	WFIFOHEAD(fd, 4 + instance->start_id * 4);
 	WFIFOW(fd,0) = 0x2afa;
@@ -345,11 +349,26 @@ int chrif_recvmap(int fd) {
 	return 0;
 }
 
+// maps moved by the char-server, either to us or to another map-server
+int chrif_mapowner(int fd) {
+	int i, j;
+	uint32 ip = ntohl(RFIFOL(fd,4));
+	uint16 port = ntohs(RFIFOW(fd,8));
+
+	for(i = 10, j = 0; i < RFIFOW(fd,2); i += 4, j++)
+		map->setipport(RFIFOW(fd,i), ip, port);
+
+	if (battle_config.etc_log)
+		ShowStatus("%d maps moved to %d.%d.%d.%d:%d\n", j, CONVIP(ip), port);
+
+	return 0;
+}
+
 // remove specified maps (used when some other map-server disconnects)
 int chrif_removemap(int fd) {
 	int i, j;
-	uint32 ip =  RFIFOL(fd,4);
-	uint16 port = RFIFOW(fd,8);
+	uint32 ip = ntohl(RFIFOL(fd,4));
+	uint16 port = ntohs(RFIFOW(fd,8));
 
 	for(i = 10, j = 0; i < RFIFOW(fd, 2); i += 4, j++)
 		map->eraseipport(RFIFOW(fd, i), ip, port);
@@ -1142,7 +1161,6 @@ int chrif_save_scdata(struct map_session_data *sd) { //parses the sc_data of the
 	int64 tick;
 	struct status_change_data data;
 	struct status_change *sc = &sd->sc;
-	const struct TimerData *td;
 
 	chrif_check(-1);
 	tick = timer->gettick();
@@ -1156,10 +1174,10 @@ int chrif_save_scdata(struct map_session_data *sd) { //parses the sc_data of the
 		if (!sc->data[i])
 			continue;
 		if (sc->data[i]->timer != INVALID_TIMER) {
-			td = timer->get(sc->data[i]->timer);
-			if (td == NULL || td->func != status->change_timer || DIFF_TICK(td->tick,tick) < 0)
+			int64 sc_tick = status->sc_timer_gettick(&sd->bl, (sc_type)i);
+			if (sc_tick == 0 || DIFF_TICK(sc_tick,tick) < 0)
 				continue;
-			data.tick = DIFF_TICK32(td->tick,tick); //Duration that is left before ending.
+			data.tick = DIFF_TICK32(sc_tick,tick); //Duration that is left before ending.
 		} else
 			data.tick = -1; //Infinite duration
 		data.type = i;
@@ -1452,6 +1470,7 @@ int chrif_parse(int fd) {
 			case 0x2b24: chrif->keepalive_ack(fd); break;
 			case 0x2b25: chrif->deadopt(RFIFOL(fd,2), RFIFOL(fd,6), RFIFOL(fd,10)); break;
 			case 0x2b27: chrif->authfail(fd); break;
+			case 0x2b29: chrif->mapowner(fd); break;
 			default:
 				ShowError("chrif_parse : unknown packet (session #%d): 0x%x. Disconnecting.\n", fd, cmd);
 				set_eof(fd);
@@ -1471,9 +1490,33 @@ int send_usercount_tochar(int tid, int64 tick, int id, intptr_t data) {
 	WFIFOW(chrif->fd,0) = 0x2afe;
 	WFIFOW(chrif->fd,2) = map->usercount();
 	WFIFOSET(chrif->fd,4);
+	chrif->send_mapload();
 	return 0;
 }
 
+/*==========================================
+ * Send to char the users on each map we host,
+ * so it can move maps between map-servers
+ *------------------------------------------*/
+void chrif_send_mapload(void) {
+	int16 m;
+	int len = 4;
+
+	chrif_check();
+
+	WFIFOHEAD(chrif->fd, 4 + instance->start_id * 4);
+	WFIFOW(chrif->fd,0) = 0x2b28;
+	for( m = 0; m < instance->start_id; m++ ) { // not instances, they stay here
+		if( map->list[m].standby || map->list[m].users == 0 )
+			continue;
+		WFIFOW(chrif->fd,len) = map_id2index(m);
+		WFIFOW(chrif->fd,len+2) = (uint16)min(map->list[m].users, UINT16_MAX);
+		len += 4;
+	}
+	WFIFOW(chrif->fd,2) = len;
+	WFIFOSET(chrif->fd,len);
+}
+
 /*==========================================
  * timerFunction
  * Send to char the number of client connected to map
@@ -1646,6 +1689,7 @@ void chrif_defaults(void) {
 		11,10,10, 0,11, 0,266,10,	// 2b10-2b17: U->2b10, U->2b11, U->2b12, F->2b13, U->2b14, F->2b15, U->2b16, U->2b17
 		2,10, 2,-1,-1,-1, 2, 7,		// 2b18-2b1f: U->2b18, U->2b19, U->2b1a, U->2b1b, U->2b1c, U->2b1d, U->2b1e, U->2b1f
 		-1,10, 8, 2, 2,14,19,19,	// 2b20-2b27: U->2b20, U->2b21, U->2b22, U->2b23, U->2b24, U->2b25, U->2b26, U->2b27
+		-1,-1, 0, 0, 0, 0, 0, 0,	// 2b28-2b2f: U->2b28, U->2b29, F->2b2a, F->2b2b, F->2b2c, F->2b2d, F->2b2e, F->2b2f
 	};
 
 	chrif = &chrif_s;
@@ -1724,6 +1768,7 @@ void chrif_defaults(void) {
 	chrif->char_ask_name_answer = chrif_char_ask_name_answer;
 	chrif->auth_db_final = auth_db_final;
 	chrif->send_usercount_tochar = send_usercount_tochar;
+	chrif->send_mapload = chrif_send_mapload;
 	chrif->auth_db_cleanup = auth_db_cleanup;
 	
 	chrif->connect = chrif_connect;
@@ -1740,6 +1785,7 @@ void chrif_defaults(void) {
 	chrif->update_ip = chrif_update_ip;
 	chrif->disconnectplayer = chrif_disconnectplayer;
 	chrif->removemap = chrif_removemap;
+	chrif->mapowner = chrif_mapowner;
 	chrif->updatefamelist_ack = chrif_updatefamelist_ack;
 	chrif->keepalive = chrif_keepalive;
 	chrif->keepalive_ack = chrif_keepalive_ack;
@@ -117,6 +117,7 @@ struct chrif_interface {
 	void (*char_ask_name_answer) (int acc, const char* player_name, uint16 type, uint16 answer);
 	int (*auth_db_final) (DBKey key, DBData *data, va_list ap);
 	int (*send_usercount_tochar) (int tid, int64 tick, int id, intptr_t data);
+	void (*send_mapload) (void);
 	int (*auth_db_cleanup) (int tid, int64 tick, int id, intptr_t data);
 
 	int (*connect) (int fd);
@@ -133,6 +134,7 @@ struct chrif_interface {
 	void (*update_ip) (int fd);
 	int (*disconnectplayer) (int fd);
 	int (*removemap) (int fd);
+	int (*mapowner) (int fd);
 	int (*updatefamelist_ack) (int fd);
 	void (*keepalive)(int fd);
 	void (*keepalive_ack) (int fd);
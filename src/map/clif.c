@@ -5,6 +5,7 @@
 #include "../common/cbasetypes.h"
 #include "../common/socket.h"
 #include "../common/timer.h"
+#include "../common/profiler.h"
 #include "../common/grfio.h"
 #include "../common/malloc.h"
 #include "../common/nullpo.h"
@@ -792,6 +793,9 @@ void clif_clearunit_area(struct block_list* bl, clr_type type)
 		WBUFL(buf,2) = -bl->id;
 		clif->send(buf, packet_len(0x80), bl, SELF);
 	}
+
+	if( battle_config.aoi_batch && clif->aoi.observer_count && !(bl->type == BL_PC && (type == CLR_DEAD || type == CLR_TRICKDEAD)) )
+		clif->aoi_cancel(bl->id); // dead players stay in sight
 }
 
 
@@ -922,79 +926,131 @@ void clif_set_unit_idle2(struct block_list* bl, struct map_session_data *tsd, en
 	return;
 #endif
 }
-/*==========================================
- * Prepares 'unit standing' packet
- *------------------------------------------*/
-void clif_set_unit_idle(struct block_list* bl, struct map_session_data *tsd, enum send_target target) {
-	struct map_session_data* sd;
-	struct status_change* sc = status->get_sc(bl);
-	struct view_data* vd = status->get_viewdata(bl);
-	struct packet_idle_unit p;
+/// Fills the parts of a 'unit standing' packet that only change with the unit's look or guild.
+static void clif_set_unit_idle_look(struct block_list *bl, struct view_data *vd, struct packet_idle_unit *p) {
+	struct map_session_data *sd = BL_CAST(BL_PC, bl);
 	int g_id = status->get_guild_id(bl);
-	
-#if PACKETVER < 20091103
-	if( !pcdb_checkid(vd->class_) ) {
-		clif->set_unit_idle2(bl,tsd,target);
-		return;
-	}
-#endif
-	
-	sd = BL_CAST(BL_PC, bl);
-	
-	p.PacketType = idle_unitType;
+
+	p->PacketType = idle_unitType;
 #if PACKETVER >= 20091103
-	p.PacketLength = sizeof(p);
-	p.objecttype = clif_bl_type(bl);
+	p->PacketLength = sizeof(*p);
+	p->objecttype = clif_bl_type(bl);
 #endif
-	p.GID = bl->id;
-	p.speed = status->get_speed(bl);
-	p.bodyState = (sc) ? sc->opt1 : 0;
-	p.healthState = (sc) ? sc->opt2 : 0;
-	p.effectState = (sc) ? sc->option : bl->type == BL_NPC ? ((TBL_NPC*)bl)->option : 0;
-	p.job = vd->class_;
-	p.head = vd->hair_style;
-	p.weapon = vd->weapon;
-	p.accessory = vd->head_bottom;
+	p->GID = bl->id;
+	p->job = vd->class_;
+	p->head = vd->hair_style;
+	p->weapon = vd->weapon;
+	p->accessory = vd->head_bottom;
 #if PACKETVER < 7
-	p.shield = vd->shield;
+	p->shield = vd->shield;
 #endif
-	p.accessory2 = vd->head_top;
-	p.accessory3 = vd->head_mid;
+	p->accessory2 = vd->head_top;
+	p->accessory3 = vd->head_mid;
 	if( bl->type == BL_NPC && vd->class_ == FLAG_CLASS ) { //The hell, why flags work like this?
-		p.accessory = status->get_emblem_id(bl);
-		p.accessory2 = GetWord(g_id, 1);
-		p.accessory3 = GetWord(g_id, 0);
+		p->accessory = status->get_emblem_id(bl);
+		p->accessory2 = GetWord(g_id, 1);
+		p->accessory3 = GetWord(g_id, 0);
 	}
-	p.headpalette = vd->hair_color;
-	p.bodypalette = vd->cloth_color;
-	p.headDir = (sd)? sd->head_dir : 0;
+	p->headpalette = vd->hair_color;
+	p->bodypalette = vd->cloth_color;
 #if PACKETVER >= 20101124
-	p.robe = vd->robe;
+	p->robe = vd->robe;
 #endif
-	p.GUID = g_id;
-	p.GEmblemVer = status->get_emblem_id(bl);
-	p.honor = (sd) ? sd->status.manner : 0;
-	p.virtue = (sc) ? sc->opt3 : 0;
-	p.isPKModeON = (sd && sd->status.karma) ? 1 : 0;
-	p.sex = vd->sex;
-	WBUFPOS(&p.PosDir[0],0,bl->x,bl->y,unit->getdir(bl));
-	p.xSize = p.ySize = (sd) ? 5 : 0;
-	p.state = vd->dead_sit;
-	p.clevel = clif_setlevel(bl);
+	p->GUID = g_id;
+	p->GEmblemVer = status->get_emblem_id(bl);
+	p->sex = vd->sex;
+	p->xSize = p->ySize = (sd) ? 5 : 0;
+#if PACKETVER >= 20140000 //actual 20120221
+	p->isBoss = ( bl->type == BL_MOB && ((TBL_MOB*)bl)->spawn && ((TBL_MOB*)bl)->spawn->state.boss ) ? 1 : 0;
+#endif
+}
+
+/// Fills the parts of a 'unit standing' packet that change all the time.
+static void clif_set_unit_idle_state(struct block_list *bl, struct view_data *vd, struct packet_idle_unit *p) {
+	struct map_session_data *sd = BL_CAST(BL_PC, bl);
+	struct status_change *sc = status->get_sc(bl);
+
+	p->speed = status->get_speed(bl);
+	p->bodyState = (sc) ? sc->opt1 : 0;
+	p->healthState = (sc) ? sc->opt2 : 0;
+	p->effectState = (sc) ? sc->option : bl->type == BL_NPC ? ((TBL_NPC*)bl)->option : 0;
+	p->headDir = (sd)? sd->head_dir : 0;
+	p->honor = (sd) ? sd->status.manner : 0;
+	p->virtue = (sc) ? sc->opt3 : 0;
+	p->isPKModeON = (sd && sd->status.karma) ? 1 : 0;
+	WBUFPOS(&p->PosDir[0],0,bl->x,bl->y,unit->getdir(bl));
+	p->state = vd->dead_sit;
+	p->clevel = clif_setlevel(bl);
 #if PACKETVER >= 20080102
-	p.font = (sd) ? sd->user_font : 0;
+	p->font = (sd) ? sd->user_font : 0;
 #endif
 #if PACKETVER >= 20140000 //actual 20120221
 	if( bl->type == BL_MOB ) {
-		p.maxHP = status_get_max_hp(bl);
-		p.HP = status_get_hp(bl);
-		p.isBoss = ( ((TBL_MOB*)bl)->spawn && ((TBL_MOB*)bl)->spawn->state.boss ) ? 1 : 0;
+		p->maxHP = status_get_max_hp(bl);
+		p->HP = status_get_hp(bl);
 	} else {
-		p.maxHP = -1;
-		p.HP = -1;
-		p.isBoss = 0;
+		p->maxHP = -1;
+		p->HP = -1;
 	}
 #endif
+}
+
+/// Whether the look part of the unit's 'unit standing' packet can be cached.
+/// NPCs share their unit data until they move, guardians and summoned monsters
+/// show a guild that changes without them noticing.
+static bool clif_set_unit_idle_cacheable(struct block_list *bl) {
+	switch( bl->type ) {
+		case BL_NPC:
+			return false;
+		case BL_MOB:
+			return !((TBL_MOB*)bl)->guardian_data && !((TBL_MOB*)bl)->special_state.ai;
+		default:
+			return true;
+	}
+}
+
+/// Makes the next 'unit standing' packet of bl rebuild its look, call it when the unit's
+/// view data changes. Changes of class or guild are noticed without it.
+void clif_look_changed(struct block_list *bl) {
+	struct unit_data *ud;
+
+	nullpo_retv(bl);
+	if( clif_set_unit_idle_cacheable(bl) && (ud = unit->bl2ud(bl)) != NULL )
+		ud->look_version++;
+}
+
+/*==========================================
+ * Prepares 'unit standing' packet
+ * The look part is built once and kept in the unit's data until its
+ * look, class or guild changes; players walking by only cost a copy.
+ *------------------------------------------*/
+void clif_set_unit_idle(struct block_list* bl, struct map_session_data *tsd, enum send_target target) {
+	struct view_data* vd = status->get_viewdata(bl);
+	struct unit_data *ud;
+	struct packet_idle_unit p;
+	
+#if PACKETVER < 20091103
+	if( !pcdb_checkid(vd->class_) ) {
+		clif->set_unit_idle2(bl,tsd,target);
+		return;
+	}
+#endif
+	
+	if( clif_set_unit_idle_cacheable(bl) && (ud = unit->bl2ud(bl)) != NULL ) {
+		struct packet_idle_unit *cache = ud->idle_packet;
+
+		if( cache == NULL || ud->idle_packet_version != ud->look_version || cache->job != vd->class_
+		 || cache->GUID != (unsigned int)status->get_guild_id(bl) || cache->GEmblemVer != (short)status->get_emblem_id(bl) ) {
+			if( cache == NULL )
+				CREATE(cache, struct packet_idle_unit, 1);
+			clif_set_unit_idle_look(bl, vd, cache);
+			ud->idle_packet = cache;
+			ud->idle_packet_version = ud->look_version;
+		}
+		memcpy(&p, cache, sizeof(p));
+	} else
+		clif_set_unit_idle_look(bl, vd, &p);
+	clif_set_unit_idle_state(bl, vd, &p);
 	
 	clif->send(&p,sizeof(p),tsd?&tsd->bl:bl,target);
 
@@ -1009,9 +1065,9 @@ void clif_set_unit_idle(struct block_list* bl, struct map_session_data *tsd, enu
 	}
 	
 }
-/* for 'packetver < 20091103' 0x7c non-pc-looking unit handling */
+/* for 'packetver < 20080827' 0x7c non-pc-looking unit handling */
 void clif_spawn_unit2(struct block_list* bl, enum send_target target) {
-#if PACKETVER < 20091103
+#if PACKETVER < 20080827
 	struct map_session_data* sd;
 	struct status_change* sc = status->get_sc(bl);
 	struct view_data* vd = status->get_viewdata(bl);
@@ -1061,7 +1117,7 @@ void clif_spawn_unit(struct block_list* bl, enum send_target target) {
 	struct packet_spawn_unit p;
 	int g_id = status->get_guild_id(bl);
 
-#if PACKETVER < 20091103
+#if PACKETVER < 20080827 // 0x7c is 44 bytes for later clients, they get the full spawn packet
 	if( !pcdb_checkid(vd->class_) ) {
 		clif->spawn_unit2(bl,target);
 		return;
@@ -1532,13 +1588,12 @@ int clif_hom_food(struct map_session_data *sd,int foodid,int fail)	//[orn]
 /// 0087 <walk start time>.L <walk data>.6B
 void clif_walkok(struct map_session_data *sd)
 {
-	int fd=sd->fd;
+	struct packet_notify_playermove p;
 
-	WFIFOHEAD(fd, packet_len(0x87));
-	WFIFOW(fd,0)=0x87;
-	WFIFOL(fd,2)=(unsigned int)timer->gettick();
-	WFIFOPOS2(fd,6,sd->bl.x,sd->bl.y,sd->ud.to_x,sd->ud.to_y,8,8);
-	WFIFOSET(fd,packet_len(0x87));
+	p.PacketType = notify_playermoveType;
+	p.moveStartTime = (unsigned int)timer->gettick();
+	WBUFPOS2(&p.MoveData[0],0,sd->bl.x,sd->bl.y,sd->ud.to_x,sd->ud.to_y,8,8);
+	clif->send(&p,sizeof(p),&sd->bl,SELF);
 }
 
 
@@ -1588,7 +1643,7 @@ void clif_move2(struct block_list *bl, struct view_data *vd, struct unit_data *u
 /// Note: unit must not be self
 void clif_move(struct unit_data *ud)
 {
-	unsigned char buf[16];
+	struct packet_notify_move p;
 	struct view_data *vd;
 	struct block_list *bl = ud->bl;
 	struct status_change *sc = NULL;
@@ -1613,14 +1668,14 @@ void clif_move(struct unit_data *ud)
 	if( (sc = status->get_sc(bl)) && sc->option&(OPTION_HIDE|OPTION_CLOAK|OPTION_INVISIBLE|OPTION_CHASEWALK) )
 		clif->ally_only = true;
 
-	WBUFW(buf,0)=0x86;
-	WBUFL(buf,2)=bl->id;
-	WBUFPOS2(buf,6,bl->x,bl->y,ud->to_x,ud->to_y,8,8);
-	WBUFL(buf,12)=(unsigned int)timer->gettick();
-	clif->send(buf, packet_len(0x86), bl, AREA_WOS);
+	p.PacketType = notify_moveType;
+	p.GID = bl->id;
+	WBUFPOS2(&p.MoveData[0],0,bl->x,bl->y,ud->to_x,ud->to_y,8,8);
+	p.moveStartTime = (unsigned int)timer->gettick();
+	clif->send(&p, sizeof(p), bl, AREA_WOS);
 	if (disguised(bl)) {
-		WBUFL(buf,2)=-bl->id;
-		clif->send(buf, packet_len(0x86), bl, SELF);
+		p.GID = -bl->id;
+		clif->send(&p, sizeof(p), bl, SELF);
 	}
 	
 	clif->ally_only = false;
@@ -1702,19 +1757,19 @@ void clif_blown(struct block_list *bl)
 /// sitting it will stand up (ZC_STOPMOVE).
 /// 0088 <id>.L <x>.W <y>.W
 void clif_fixpos(struct block_list *bl) {
-	unsigned char buf[10];
+	struct packet_stopmove p;
 	
 	nullpo_retv(bl);
 	
-	WBUFW(buf,0) = 0x88;
-	WBUFL(buf,2) = bl->id;
-	WBUFW(buf,6) = bl->x;
-	WBUFW(buf,8) = bl->y;
-	clif->send(buf, packet_len(0x88), bl, AREA);
+	p.PacketType = stopmoveType;
+	p.AID = bl->id;
+	p.xPos = bl->x;
+	p.yPos = bl->y;
+	clif->send(&p, sizeof(p), bl, AREA);
 
 	if( disguised(bl) ) {
-		WBUFL(buf,2) = -bl->id;
-		clif->send(buf, packet_len(0x88), bl, SELF);
+		p.AID = -bl->id;
+		clif->send(&p, sizeof(p), bl, SELF);
 	}
 }
 
@@ -2557,6 +2612,93 @@ void clif_guild_xy(struct map_session_data *sd)
 	clif->send(buf,packet_len(0x1eb),&sd->bl,GUILD_SAMEMAP_WOS);
 }
 
+/*==========================================
+ * Sends a batch of same sized position packets, one per mover
+ * (movers sorted by map). Each recipient gets the packets of the
+ * movers on its map, except its own, in a single write.
+ *------------------------------------------*/
+static void clif_xy_list_send(const unsigned char *buf, int len, struct map_session_data **movers, int count, struct map_session_data **recipients, int recipient_count)
+{
+	int i;
+
+	for( i = 0; i < recipient_count; i++ ) {
+		struct map_session_data *sd = recipients[i];
+		int lo, hi, self, fd, size;
+
+		if( sd == NULL || !(fd = sd->fd) )
+			continue;
+
+		for( lo = 0; lo < count && movers[lo]->bl.m != sd->bl.m; lo++ )
+			;
+		for( hi = lo; hi < count && movers[hi]->bl.m == sd->bl.m; hi++ )
+			;
+		for( self = lo; self < hi && movers[self] != sd; self++ )
+			;
+		size = (hi - lo - (self < hi ? 1 : 0)) * len;
+		if( size <= 0 )
+			continue;
+
+		WFIFOHEAD(fd, size);
+		memcpy(WFIFOP(fd,0), buf + lo*len, (self - lo)*len);
+		if( self < hi )
+			memcpy(WFIFOP(fd,(self - lo)*len), buf + (self + 1)*len, (hi - self - 1)*len);
+		WFIFOSET(fd, size);
+	}
+}
+
+/// Sorts the movers by map, so each map's packets are contiguous.
+static void clif_xy_list_sort(struct map_session_data **movers, int count)
+{
+	int i, j;
+
+	for( i = 1; i < count; i++ ) {
+		struct map_session_data *sd = movers[i];
+		for( j = i; j > 0 && movers[j-1]->bl.m > sd->bl.m; j-- )
+			movers[j] = movers[j-1];
+		movers[j] = sd;
+	}
+}
+
+/*==========================================
+ * Guild member positions of one interval (guild_send_xy_timer).
+ * 01eb <account id>.L <x>.W <y>.W, one per moved member
+ *------------------------------------------*/
+void clif_guild_xy_list(struct guild *g, struct map_session_data **movers, int count)
+{
+	unsigned char buf[MAX_GUILD*10];
+	struct map_session_data *recipients[MAX_GUILD];
+	int i;
+
+	nullpo_retv(g);
+
+	if( count <= 0 )
+		return;
+
+	clif_xy_list_sort(movers, count);
+	for( i = 0; i < count; i++ ) {
+		WBUFW(buf,i*10+0)=0x1eb;
+		WBUFL(buf,i*10+2)=movers[i]->status.account_id;
+		WBUFW(buf,i*10+6)=movers[i]->bl.x;
+		WBUFW(buf,i*10+8)=movers[i]->bl.y;
+	}
+	for( i = 0; i < g->max_member; i++ )
+		recipients[i] = g->member[i].sd;
+	clif_xy_list_send(buf, 10, movers, count, recipients, g->max_member);
+
+	if( map->enable_spy ) {
+		struct s_mapiterator* iter = mapit_getallusers();
+		struct map_session_data *tsd;
+		while( (tsd = (TBL_PC*)mapit->next(iter)) != NULL ) {
+			if( tsd->guildspy == g->guild_id ) {
+				WFIFOHEAD(tsd->fd, count*10);
+				memcpy(WFIFOP(tsd->fd,0), buf, count*10);
+				WFIFOSET(tsd->fd, count*10);
+			}
+		}
+		mapit->free(iter);
+	}
+}
+
 /*==========================================
  * Sends x/y dot to a single fd. [Skotlex]
  *------------------------------------------*/
@@ -3128,6 +3270,7 @@ void clif_changelook(struct block_list *bl,int type,int val)
 	sc = status->get_sc(bl);
 	vd = status->get_viewdata(bl);
 	//nullpo_ret(vd);
+	clif->look_changed(bl);
 	if( vd ) //temp hack to let Warp Portal change appearance
 		switch(type) {
 			case LOOK_WEAPON:
@@ -4349,14 +4492,9 @@ int clif_calc_walkdelay(struct block_list *bl,int delay, int type, int damage, i
 ///     11 = lucky dodge
 ///     12 = (touch skill?)
 int clif_damage(struct block_list* src, struct block_list* dst, int64 tick, int sdelay, int ddelay, int64 in_damage, int div, int type, int64 in_damage2) {
-	unsigned char buf[33];
+	struct packet_damage p;
 	struct status_change *sc;
 	int damage,damage2;
-#if PACKETVER < 20071113
-	const int cmd = 0x8a;
-#else
-	const int cmd = 0x2e1;
-#endif
 
 	nullpo_ret(src);
 	nullpo_ret(dst);
@@ -4373,52 +4511,40 @@ int clif_damage(struct block_list* src, struct block_list* dst, int64 tick, int
 		}
 	}
 
-	WBUFW(buf,0)=cmd;
-	WBUFL(buf,2)=src->id;
-	WBUFL(buf,6)=dst->id;
-	WBUFL(buf,10)=(uint32)tick;
-	WBUFL(buf,14)=sdelay;
-	WBUFL(buf,18)=ddelay;
-#if PACKETVER < 20071113
+	p.PacketType = damageType;
+	p.GID = src->id;
+	p.targetGID = dst->id;
+	p.startTime = (uint32)tick;
+	p.attackMT = sdelay;
+	p.attackedMT = ddelay;
 	if (battle_config.hide_woe_damage && map_flag_gvg2(src->m)) {
-		WBUFW(buf,22)=damage?div:0;
-		WBUFW(buf,27)=damage2?div:0;
+		p.damage = damage?div:0;
+		p.leftDamage = damage2?div:0;
 	} else {
-		WBUFW(buf,22)=min(damage, INT16_MAX);
-		WBUFW(buf,27)=damage2;
-	}
-	WBUFW(buf,24)=div;
-	WBUFB(buf,26)=type;
+#if PACKETVER < 20071113
+		p.damage = min(damage, INT16_MAX);
 #else
-	if (battle_config.hide_woe_damage && map_flag_gvg2(src->m)) {
-		WBUFL(buf,22)=damage?div:0;
-		WBUFL(buf,29)=damage2?div:0;
-	} else {
-		WBUFL(buf,22)=damage;
-		WBUFL(buf,29)=damage2;
-	}
-	WBUFW(buf,26)=div;
-	WBUFB(buf,28)=type;
+		p.damage = damage;
 #endif
+		p.leftDamage = damage2;
+	}
+	p.count = div;
+	p.action = type;
+
 	if(disguised(dst)) {
-		clif->send(buf,packet_len(cmd),dst,AREA_WOS);
-		WBUFL(buf,6) = -dst->id;
-		clif->send(buf,packet_len(cmd),dst,SELF);
+		clif->send(&p,sizeof(p),dst,AREA_WOS);
+		p.targetGID = -dst->id;
+		clif->send(&p,sizeof(p),dst,SELF);
 	} else
-		clif->send(buf,packet_len(cmd),dst,AREA);
+		clif->send(&p,sizeof(p),dst,AREA);
 
 	if(disguised(src)) {
-		WBUFL(buf,2) = -src->id;
+		p.GID = -src->id;
 		if (disguised(dst))
-			WBUFL(buf,6) = dst->id;
-#if PACKETVER < 20071113
-		if(damage > 0) WBUFW(buf,22) = -1;
-		if(damage2 > 0) WBUFW(buf,27) = -1;
-#else
-		if(damage > 0) WBUFL(buf,22) = -1;
-		if(damage2 > 0) WBUFL(buf,29) = -1;
-#endif
-		clif->send(buf,packet_len(cmd),src,SELF);
+			p.targetGID = dst->id;
+		if(damage > 0) p.damage = -1;
+		if(damage2 > 0) p.leftDamage = -1;
+		clif->send(&p,sizeof(p),src,SELF);
 	}
 
 	if(src == dst) {
@@ -4654,6 +4780,9 @@ int clif_getareachar(struct block_list* bl,va_list ap) {
 	if (sd == NULL || !sd->fd)
 		return 0;
 
+	if( battle_config.aoi_batch && &sd->bl != bl )
+		clif->aoi_known_add(sd, bl->id);
+
 	switch(bl->type){
 		case BL_ITEM:
 			clif->getareachar_item(sd,(struct flooritem_data*) bl);
@@ -4684,39 +4813,15 @@ int clif_outsight(struct block_list *bl,va_list ap)
 	tsd = BL_CAST(BL_PC, tbl);
 
 	if (tsd && tsd->fd) { //tsd has lost sight of the bl object.
-		switch(bl->type){
-			case BL_PC:
-				if (sd->vd.class_ != INVISIBLE_CLASS)
-					clif->clearunit_single(bl->id,CLR_OUTSIGHT,tsd->fd);
-				if(sd->chatID){
-					struct chat_data *cd;
-					cd=(struct chat_data*)map->id2bl(sd->chatID);
-					if(cd->usersd[0]==sd)
-						clif->dispchat(cd,tsd->fd);
-				}
-				if( sd->state.vending )
-					clif->closevendingboard(bl,tsd->fd);
-				if( sd->state.buyingstore )
-					clif->buyingstore_disappear_entry_single(tsd, sd);
-				break;
-			case BL_ITEM:
-				clif->clearflooritem((struct flooritem_data*)bl,tsd->fd);
-				break;
-			case BL_SKILL:
-				clif->clearchar_skillunit((struct skill_unit *)bl,tsd->fd);
-				break;
-			case BL_NPC:
-				if( !(((TBL_NPC*)bl)->option&OPTION_INVISIBLE) )
-					clif->clearunit_single(bl->id,CLR_OUTSIGHT,tsd->fd);
-				break;
-			default:
-				if ((vd=status->get_viewdata(bl)) && vd->class_ != INVISIBLE_CLASS)
-					clif->clearunit_single(bl->id,CLR_OUTSIGHT,tsd->fd);
-				break;
-			}
+		if( battle_config.aoi_batch )
+			clif->aoi_leave(tsd, bl);
+		else
+			clif->aoi_vanish(tsd, bl);
 	}
 	if (sd && sd->fd) { //sd is watching tbl go out of view.
-		if (((vd=status->get_viewdata(tbl)) && vd->class_ != INVISIBLE_CLASS) &&
+		if( battle_config.aoi_batch )
+			clif->aoi_leave(sd, tbl);
+		else if (((vd=status->get_viewdata(tbl)) && vd->class_ != INVISIBLE_CLASS) &&
 			!(tbl->type == BL_NPC && (((TBL_NPC*)tbl)->option&OPTION_INVISIBLE)))
 			clif->clearunit_single(tbl->id,CLR_OUTSIGHT,sd->fd);
 	}
@@ -4738,7 +4843,9 @@ int clif_insight(struct block_list *bl,va_list ap)
 	tsd = BL_CAST(BL_PC, tbl);
 
 	if (tsd && tsd->fd) { //Tell tsd that bl entered into his view
-		switch(bl->type) {
+		if( battle_config.aoi_batch )
+			clif->aoi_enter(tsd, bl);
+		else switch(bl->type) {
 			case BL_ITEM:
 				clif->getareachar_item(tsd,(struct flooritem_data*)bl);
 				break;
@@ -4751,11 +4858,293 @@ int clif_insight(struct block_list *bl,va_list ap)
 		}
 	}
 	if (sd && sd->fd) { //Tell sd that tbl walked into his view
-		clif->getareachar_unit(sd,tbl);
+		if( battle_config.aoi_batch )
+			clif->aoi_enter(sd, tbl);
+		else
+			clif->getareachar_unit(sd,tbl);
 	}
 	return 0;
 }
 
+/*==========================================
+ * Interest management (battle_config.aoi_batch)
+ * Units coming into view are queued per player and spawned once per tick,
+ * so a unit that enters and leaves the view within the same tick, or is
+ * reported several times, costs no (or one) packet. Units leaving the view
+ * are cleared right away, unless their spawn is still queued.
+ *------------------------------------------*/
+
+/// Tells sd that bl is no longer in sight.
+void clif_aoi_vanish(struct map_session_data *sd, struct block_list *bl) {
+	struct view_data *vd;
+
+	nullpo_retv(sd);
+	nullpo_retv(bl);
+
+	switch(bl->type){
+		case BL_PC:
+		{
+			TBL_PC *bsd = (TBL_PC*)bl;
+			if (bsd->vd.class_ != INVISIBLE_CLASS)
+				clif->clearunit_single(bl->id,CLR_OUTSIGHT,sd->fd);
+			if(bsd->chatID){
+				struct chat_data *cd;
+				cd=(struct chat_data*)map->id2bl(bsd->chatID);
+				if(cd->usersd[0]==bsd)
+					clif->dispchat(cd,sd->fd);
+			}
+			if( bsd->state.vending )
+				clif->closevendingboard(bl,sd->fd);
+			if( bsd->state.buyingstore )
+				clif->buyingstore_disappear_entry_single(sd, bsd);
+		}
+			break;
+		case BL_ITEM:
+			clif->clearflooritem((struct flooritem_data*)bl,sd->fd);
+			break;
+		case BL_SKILL:
+			clif->clearchar_skillunit((struct skill_unit *)bl,sd->fd);
+			break;
+		case BL_NPC:
+			if( !(((TBL_NPC*)bl)->option&OPTION_INVISIBLE) )
+				clif->clearunit_single(bl->id,CLR_OUTSIGHT,sd->fd);
+			break;
+		default:
+			if ((vd=status->get_viewdata(bl)) && vd->class_ != INVISIBLE_CLASS)
+				clif->clearunit_single(bl->id,CLR_OUTSIGHT,sd->fd);
+			break;
+	}
+}
+
+/// Records that the client of sd was sent unit id.
+/// Only the 'units in sight' figure of battle_config.aoi_stats uses it, so it's kept only then.
+void clif_aoi_known_add(struct map_session_data *sd, int id) {
+	int lo = 0, hi = sd->aoi.known_count;
+
+	if( !battle_config.aoi_stats )
+		return;
+
+	while( lo < hi ) {
+		int mid = (lo + hi) / 2;
+		if( sd->aoi.known[mid] < id )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if( lo < sd->aoi.known_count && sd->aoi.known[lo] == id )
+		return;
+
+	if( sd->aoi.known_count == sd->aoi.known_max ) {
+		sd->aoi.known_max += 32;
+		RECREATE(sd->aoi.known, int, sd->aoi.known_max);
+	}
+	if( lo < sd->aoi.known_count )
+		memmove(&sd->aoi.known[lo+1], &sd->aoi.known[lo], sizeof(int) * (sd->aoi.known_count - lo));
+	sd->aoi.known[lo] = id;
+	sd->aoi.known_count++;
+}
+
+/// Forgets unit id for the client of sd.
+/// @return Whether the id was known
+bool clif_aoi_known_remove(struct map_session_data *sd, int id) {
+	int lo = 0, hi = sd->aoi.known_count;
+
+	while( lo < hi ) {
+		int mid = (lo + hi) / 2;
+		if( sd->aoi.known[mid] < id )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if( lo == sd->aoi.known_count || sd->aoi.known[lo] != id )
+		return false;
+
+	sd->aoi.known_count--;
+	if( lo < sd->aoi.known_count )
+		memmove(&sd->aoi.known[lo], &sd->aoi.known[lo+1], sizeof(int) * (sd->aoi.known_count - lo));
+	return true;
+}
+
+/// Queues the spawn of bl for sd until the end of the tick.
+void clif_aoi_enter(struct map_session_data *sd, struct block_list *bl) {
+	int i;
+
+	nullpo_retv(sd);
+	nullpo_retv(bl);
+
+	ARR_FIND( 0, sd->aoi.enter_count, i, sd->aoi.enter[i] == bl->id );
+	if( i < sd->aoi.enter_count ) { // already queued
+		clif->aoi.coalesced++;
+		return;
+	}
+
+	if( sd->aoi.enter_count == 0 ) {
+		if( clif->aoi.observer_count == clif->aoi.observer_max ) {
+			clif->aoi.observer_max += 32;
+			RECREATE(clif->aoi.observer, int, clif->aoi.observer_max);
+		}
+		clif->aoi.observer[clif->aoi.observer_count++] = sd->bl.id;
+		if( clif->aoi.timer == INVALID_TIMER )
+			clif->aoi.timer = timer->add(timer->gettick(), clif->aoi_flush_timer, 0, 0);
+	}
+
+	if( sd->aoi.enter_count == sd->aoi.enter_max ) {
+		sd->aoi.enter_max += 16;
+		RECREATE(sd->aoi.enter, int, sd->aoi.enter_max);
+	}
+	sd->aoi.enter[sd->aoi.enter_count++] = bl->id;
+}
+
+/// bl went out of sd's sight, cancels a queued spawn or clears it right away.
+void clif_aoi_leave(struct map_session_data *sd, struct block_list *bl) {
+	int i;
+
+	nullpo_retv(sd);
+	nullpo_retv(bl);
+
+	ARR_FIND( 0, sd->aoi.enter_count, i, sd->aoi.enter[i] == bl->id );
+	if( i < sd->aoi.enter_count ) { // never sent, neither spawn nor vanish are needed
+		sd->aoi.enter[i] = sd->aoi.enter[--sd->aoi.enter_count];
+		clif->aoi.coalesced += 2;
+		return;
+	}
+
+	clif->aoi_known_remove(sd, bl->id);
+	clif->aoi_vanish(sd, bl);
+	clif->aoi.vanish++;
+}
+
+/// Unit id was cleared from the area (death, warp, removal), drops its queued spawns.
+void clif_aoi_cancel(int id) {
+	int i, j;
+
+	for( i = 0; i < clif->aoi.observer_count; i++ ) {
+		struct map_session_data *sd = map->id2sd(clif->aoi.observer[i]);
+
+		if( sd == NULL )
+			continue;
+
+		ARR_FIND( 0, sd->aoi.enter_count, j, sd->aoi.enter[j] == id );
+		if( j < sd->aoi.enter_count ) {
+			sd->aoi.enter[j] = sd->aoi.enter[--sd->aoi.enter_count];
+			clif->aoi.coalesced++;
+		}
+	}
+}
+
+/// The client is about to be sent everything in sight again (map change).
+void clif_aoi_reset(struct map_session_data *sd) {
+	sd->aoi.known_count = 0;
+	sd->aoi.enter_count = 0;
+}
+
+void clif_aoi_free(struct map_session_data *sd) {
+	if( sd->aoi.known )
+		aFree(sd->aoi.known);
+	if( sd->aoi.enter )
+		aFree(sd->aoi.enter);
+	sd->aoi.known = sd->aoi.enter = NULL;
+	sd->aoi.known_count = sd->aoi.known_max = 0;
+	sd->aoi.enter_count = sd->aoi.enter_max = 0;
+}
+
+/// Sends the spawns queued by clif_aoi_enter, checked against the current state of the units.
+int clif_aoi_flush_timer(int tid, int64 tick, int id, intptr_t data) {
+	int i, j;
+
+	clif->aoi.timer = INVALID_TIMER;
+
+	for( i = 0; i < clif->aoi.observer_count; i++ ) {
+		struct map_session_data *sd = map->id2sd(clif->aoi.observer[i]);
+
+		if( sd == NULL )
+			continue;
+
+		for( j = 0; j < sd->aoi.enter_count; j++ ) {
+			struct block_list *bl = map->id2bl(sd->aoi.enter[j]);
+
+			if( bl == NULL || bl == &sd->bl || bl->m != sd->bl.m || !check_distance_bl(&sd->bl, bl, AREA_SIZE) || !sd->fd )
+				continue; // gone, or out of sight again in a way that did not go through outsight
+			if( bl->prev == NULL || (bl->type != BL_PC && status->isdead(bl)) )
+				continue; // removed from the map or dying, dead players stay on it lying down
+
+			switch( bl->type ) {
+				case BL_ITEM:
+					clif->getareachar_item(sd,(struct flooritem_data*)bl);
+					break;
+				case BL_SKILL:
+					clif->getareachar_skillunit(sd,(TBL_SKILL*)bl);
+					break;
+				default:
+					clif->getareachar_unit(sd,bl);
+					break;
+			}
+			clif->aoi_known_add(sd, bl->id);
+			clif->aoi.spawn++;
+		}
+		sd->aoi.enter_count = 0;
+	}
+	clif->aoi.observer_count = 0;
+
+	return 0;
+}
+
+/// Reports visible set sizes and packets sent/saved per second (battle_config.aoi_stats)
+int clif_aoi_stats_timer(int tid, int64 tick, int id, intptr_t data) {
+	static bool tracking = false; // whether sd->aoi.known may hold ids
+	int64 diff = DIFF_TICK(tick, clif->aoi.report_tick);
+	struct s_mapiterator* iter;
+	struct map_session_data *sd;
+	int players = 0, max_known = 0;
+	int64 known = 0;
+	double secs;
+
+	if( battle_config.aoi_stats )
+		tracking = true;
+	else if( tracking ) { // switched off, forget the units tracked for it
+		iter = mapit_getallusers();
+		for( sd = (TBL_PC*)mapit->first(iter); mapit->exists(iter); sd = (TBL_PC*)mapit->next(iter) )
+			sd->aoi.known_count = 0;
+		mapit->free(iter);
+		tracking = false;
+	}
+
+	if( !battle_config.aoi_stats || diff < (int64)battle_config.aoi_stats*1000 ) {
+		if( !battle_config.aoi_stats ) {
+			clif->aoi.spawn = clif->aoi.vanish = clif->aoi.coalesced = 0;
+			clif->aoi.report_tick = tick;
+		}
+		return 0;
+	}
+
+	// drop units that vanished without going through outsight (death, warp, ...)
+	iter = mapit_getallusers();
+	for( sd = (TBL_PC*)mapit->first(iter); mapit->exists(iter); sd = (TBL_PC*)mapit->next(iter) ) {
+		int i, n;
+		for( i = 0, n = 0; i < sd->aoi.known_count; i++ ) {
+			struct block_list *bl = map->id2bl(sd->aoi.known[i]);
+			if( bl && bl->m == sd->bl.m && check_distance_bl(&sd->bl, bl, AREA_SIZE) )
+				sd->aoi.known[n++] = sd->aoi.known[i];
+		}
+		sd->aoi.known_count = n;
+		known += n;
+		max_known = max(max_known, n);
+		players++;
+	}
+	mapit->free(iter);
+
+	secs = diff / 1000.;
+	ShowInfo("AOI: '"CL_WHITE"%.1f"CL_RESET"' units in sight per player (max '"CL_WHITE"%d"CL_RESET"'), '"CL_WHITE"%.1f"CL_RESET"' spawns/s, '"CL_WHITE"%.1f"CL_RESET"' vanishes/s, '"CL_WHITE"%.1f"CL_RESET"' packets/s saved.\n",
+		players ? (double)known/players : 0., max_known,
+		clif->aoi.spawn/secs, clif->aoi.vanish/secs, clif->aoi.coalesced/secs);
+
+	clif->aoi.spawn = clif->aoi.vanish = clif->aoi.coalesced = 0;
+	clif->aoi.report_tick = tick;
+	return 0;
+}
+
 
 /// Updates whole skill tree (ZC_SKILLINFO_LIST).
 /// 010f <packet len>.W { <skill id>.W <type>.L <level>.W <sp cost>.W <attack range>.W <skill name>.24B <upgradable>.B }*
@@ -5035,7 +5424,7 @@ void clif_skill_cooldown(struct map_session_data *sd, uint16 skill_id, unsigned
 /// 0114 <skill id>.W <src id>.L <dst id>.L <tick>.L <src delay>.L <dst delay>.L <damage>.W <level>.W <div>.W <type>.B (ZC_NOTIFY_SKILL)
 /// 01de <skill id>.W <src id>.L <dst id>.L <tick>.L <src delay>.L <dst delay>.L <damage>.L <level>.W <div>.W <type>.B (ZC_NOTIFY_SKILL2)
 int clif_skill_damage(struct block_list *src, struct block_list *dst, int64 tick, int sdelay, int ddelay, int64 in_damage, int div, uint16 skill_id, uint16 skill_lv, int type) {
-	unsigned char buf[64];
+	struct packet_skill_damage p;
 	struct status_change *sc;
 	int damage;
 
@@ -5050,69 +5439,36 @@ int clif_skill_damage(struct block_list *src, struct block_list *dst, int64 tick
 			damage = damage*(sc->data[SC_ILLUSION]->val2) + rnd()%100;
 	}
 
-#if PACKETVER < 3
-	WBUFW(buf,0)=0x114;
-	WBUFW(buf,2)=skill_id;
-	WBUFL(buf,4)=src->id;
-	WBUFL(buf,8)=dst->id;
-	WBUFL(buf,12)=(uint32)tick;
-	WBUFL(buf,16)=sdelay;
-	WBUFL(buf,20)=ddelay;
+	p.PacketType = skill_damageType;
+	p.SKID = skill_id;
+	p.AID = src->id;
+	p.targetID = dst->id;
+	p.startTime = (uint32)tick;
+	p.attackMT = sdelay;
+	p.attackedMT = ddelay;
 	if (battle_config.hide_woe_damage && map_flag_gvg2(src->m)) {
-		WBUFW(buf,24)=damage?div:0;
+		p.damage = damage?div:0;
 	} else {
-		WBUFW(buf,24)=damage;
+		p.damage = damage;
 	}
-	WBUFW(buf,26)=skill_lv;
-	WBUFW(buf,28)=div;
-	WBUFB(buf,30)=type;
+	p.level = skill_lv;
+	p.count = div;
+	p.action = type;
 	if (disguised(dst)) {
-		clif->send(buf,packet_len(0x114),dst,AREA_WOS);
-		WBUFL(buf,8)=-dst->id;
-		clif->send(buf,packet_len(0x114),dst,SELF);
+		clif->send(&p,sizeof(p),dst,AREA_WOS);
+		p.targetID = -dst->id;
+		clif->send(&p,sizeof(p),dst,SELF);
 	} else
-		clif->send(buf,packet_len(0x114),dst,AREA);
+		clif->send(&p,sizeof(p),dst,AREA);
 
 	if(disguised(src)) {
-		WBUFL(buf,4)=-src->id;
+		p.AID = -src->id;
 		if (disguised(dst))
-			WBUFL(buf,8)=dst->id;
+			p.targetID = dst->id;
 		if(damage > 0)
-			WBUFW(buf,24)=-1;
-		clif->send(buf,packet_len(0x114),src,SELF);
+			p.damage = -1;
+		clif->send(&p,sizeof(p),src,SELF);
 	}
-#else
-	WBUFW(buf,0)=0x1de;
-	WBUFW(buf,2)=skill_id;
-	WBUFL(buf,4)=src->id;
-	WBUFL(buf,8)=dst->id;
-	WBUFL(buf,12)=(uint32)tick;
-	WBUFL(buf,16)=sdelay;
-	WBUFL(buf,20)=ddelay;
-	if (battle_config.hide_woe_damage && map_flag_gvg2(src->m)) {
-		WBUFL(buf,24)=damage?div:0;
-	} else {
-		WBUFL(buf,24)=damage;
-	}
-	WBUFW(buf,28)=skill_lv;
-	WBUFW(buf,30)=div;
-	WBUFB(buf,32)=type;
-	if (disguised(dst)) {
-		clif->send(buf,packet_len(0x1de),dst,AREA_WOS);
-		WBUFL(buf,8)=-dst->id;
-		clif->send(buf,packet_len(0x1de),dst,SELF);
-	} else
-		clif->send(buf,packet_len(0x1de),dst,AREA);
-
-	if(disguised(src)) {
-		WBUFL(buf,4)=-src->id;
-		if (disguised(dst))
-			WBUFL(buf,8)=dst->id;
-		if(damage > 0)
-			WBUFL(buf,24)=-1;
-		clif->send(buf,packet_len(0x1de),src,SELF);
-	}
-#endif
 
 	//Because the damage delay must be synced with the client, here is where the can-walk tick must be updated. [Skotlex]
 	return clif->calc_walkdelay(dst,ddelay,type,damage,div);
@@ -6705,6 +7061,46 @@ void clif_party_xy(struct map_session_data *sd)
 }
 
 
+/*==========================================
+ * Party member positions of one interval (party_send_xy_timer).
+ * 0107 <account id>.L <x>.W <y>.W, one per moved member
+ *------------------------------------------*/
+void clif_party_xy_list(struct party_data *p, struct map_session_data **movers, int count)
+{
+	unsigned char buf[MAX_PARTY*10];
+	struct map_session_data *recipients[MAX_PARTY];
+	int i;
+
+	nullpo_retv(p);
+
+	if( count <= 0 )
+		return;
+
+	clif_xy_list_sort(movers, count);
+	for( i = 0; i < count; i++ ) {
+		WBUFW(buf,i*10+0)=0x107;
+		WBUFL(buf,i*10+2)=movers[i]->status.account_id;
+		WBUFW(buf,i*10+6)=movers[i]->bl.x;
+		WBUFW(buf,i*10+8)=movers[i]->bl.y;
+	}
+	for( i = 0; i < MAX_PARTY; i++ )
+		recipients[i] = p->data[i].sd;
+	clif_xy_list_send(buf, 10, movers, count, recipients, MAX_PARTY);
+
+	if( map->enable_spy ) {
+		struct s_mapiterator* iter = mapit_getallusers();
+		struct map_session_data *tsd;
+		while( (tsd = (TBL_PC*)mapit->next(iter)) != NULL ) {
+			if( tsd->partyspy == p->party.party_id ) {
+				WFIFOHEAD(tsd->fd, count*10);
+				memcpy(WFIFOP(tsd->fd,0), buf, count*10);
+				WFIFOSET(tsd->fd, count*10);
+			}
+		}
+		mapit->free(iter);
+	}
+}
+
 /*==========================================
  * Sends x/y dot to a single fd. [Skotlex]
  *------------------------------------------*/
@@ -9221,6 +9617,11 @@ void clif_parse_LoadEndAck(int fd,struct map_session_data *sd) {
 		return;
 	}
 
+	// The map went on standby while loading (map->standby_sub only sees the players on it),
+	// or this is a login to a map on standby: change to the map-server hosting it.
+	if( map->list[sd->bl.m].standby && pc->setpos(sd, sd->mapindex, sd->bl.x, sd->bl.y, CLR_OUTSIGHT) == 0 )
+		return;
+
 	sd->state.warping = 0;
 	sd->state.dialog = 0;/* reset when warping, client dialog will go missing */
 
@@ -9257,8 +9658,11 @@ void clif_parse_LoadEndAck(int fd,struct map_session_data *sd) {
 		pc->setinvincibletimer(sd,battle_config.pc_invincible_time);
 	}
 
-	if( map->list[sd->bl.m].users++ == 0 && battle_config.dynamic_mobs )
-		map->spawnmobs(sd->bl.m);
+	if( map->list[sd->bl.m].users++ == 0 ) {
+		if( battle_config.dynamic_mobs )
+			map->spawnmobs(sd->bl.m);
+		mob->ai_wake_map(sd->bl.m);
+	}
 	
 	if( !(sd->sc.option&OPTION_INVISIBLE) ) { // increment the number of pvp players on the map
 		map->list[sd->bl.m].users_pvp++;
@@ -9305,6 +9709,7 @@ void clif_parse_LoadEndAck(int fd,struct map_session_data *sd) {
 
 	// info about nearby objects
 	// must use foreachinarea (CIRCULAR_AREA interferes with foreachinrange)
+	clif->aoi_reset(sd);
 	map->foreachinarea(clif->getareachar, sd->bl.m, sd->bl.x-AREA_SIZE, sd->bl.y-AREA_SIZE, sd->bl.x+AREA_SIZE, sd->bl.y+AREA_SIZE, BL_ALL, sd);
 
 	// pet
@@ -17466,6 +17871,7 @@ void clif_maptypeproperty2(struct block_list *bl,enum send_target t) {
 }
 
 void clif_status_change2(struct block_list *bl, int tid, enum send_target target, int type, int val1, int val2, int val3) {
+#if PACKETVER >= 20090121
 	struct packet_status_change2 p;
 	
 	p.PacketType = status_change2Type;
@@ -17476,6 +17882,15 @@ void clif_status_change2(struct block_list *bl, int tid, enum send_target target
 	p.val1 = val1;
 	p.val2 = val2;
 	p.val3 = val3;
+#else
+	// 0x43f is an 8 byte packet for these clients, they only get the icon
+	struct packet_sc_notick p;
+	
+	p.PacketType = sc_notickType;
+	p.index = type;
+	p.AID = tid;
+	p.state = 1;
+#endif
 	
 	clif->send(&p,sizeof(p), bl, target);
 }
@@ -17929,8 +18344,11 @@ int clif_parse(int fd) {
 			else
 				if( sd && sd->bl.prev == NULL && packet_db[cmd].func != clif->pLoadEndAck )
 					; //Only valid packet when player is not on a map
-				else
+				else {
+					int64 zone = profiler->begin();
 					packet_db[cmd].func(fd, sd);
+					profiler->end(PROFILER_PACKET, cmd, zone);
+				}
 		}
 #ifdef DUMP_UNKNOWN_PACKET
 		else {
@@ -18059,12 +18477,18 @@ int do_init_clif(void) {
 
 	timer->add_func_list(clif->clearunit_delayed_sub, "clif_clearunit_delayed_sub");
 	timer->add_func_list(clif->delayquit, "clif_delayquit");
+	timer->add_func_list(clif->aoi_flush_timer, "clif_aoi_flush_timer");
+	timer->add_func_list(clif->aoi_stats_timer, "clif_aoi_stats_timer");
 
 	clif->delay_clearunit_ers = ers_new(sizeof(struct block_list),"clif.c::delay_clearunit_ers",ERS_OPT_CLEAR);
 
 	clif->channel_db = stridb_alloc(DB_OPT_DUP_KEY|DB_OPT_RELEASE_DATA, HCHSYS_NAME_LENGTH);
 	hChSys.ally = hChSys.local = hChSys.irc = hChSys.ally_autojoin = hChSys.local_autojoin = false;
 	clif->chann_config_read();
+
+	clif->aoi.timer = INVALID_TIMER;
+	clif->aoi.report_tick = timer->gettick();
+	timer->add_interval(clif->aoi.report_tick + 1000, clif->aoi_stats_timer, 0, 0, 1000);
 	
 	return 0;
 }
@@ -18091,6 +18515,9 @@ void do_final_clif(void) {
 
 	db_destroy(clif->channel_db);
 	ers_destroy(clif->delay_clearunit_ers);
+
+	if( clif->aoi.observer )
+		aFree(clif->aoi.observer);
 	
 	for(i = 0; i < CASHSHOP_TAB_MAX; i++) {
 		int k;
@@ -18165,6 +18592,7 @@ void clif_defaults(void) {
 	clif->skillunit_update = clif_skillunit_update;
 	clif->clearunit_delayed_sub = clif_clearunit_delayed_sub;
 	clif->set_unit_idle = clif_set_unit_idle;
+	clif->look_changed = clif_look_changed;
 	clif->spawn_unit = clif_spawn_unit;
 	clif->spawn_unit2 = clif_spawn_unit2;
 	clif->set_unit_idle2 = clif_set_unit_idle2;
@@ -18220,6 +18648,16 @@ void clif_defaults(void) {
 	clif->update_rankingpoint = clif_update_rankingpoint;
 	clif->hotkeys = clif_hotkeys_send;
 	clif->insight = clif_insight;
+	clif->aoi_enter = clif_aoi_enter;
+	clif->aoi_leave = clif_aoi_leave;
+	clif->aoi_vanish = clif_aoi_vanish;
+	clif->aoi_known_add = clif_aoi_known_add;
+	clif->aoi_known_remove = clif_aoi_known_remove;
+	clif->aoi_cancel = clif_aoi_cancel;
+	clif->aoi_reset = clif_aoi_reset;
+	clif->aoi_free = clif_aoi_free;
+	clif->aoi_flush_timer = clif_aoi_flush_timer;
+	clif->aoi_stats_timer = clif_aoi_stats_timer;
 	clif->outsight = clif_outsight;
 	clif->skillcastcancel = clif_skillcastcancel;
 	clif->skill_fail = clif_skill_fail;
@@ -18407,6 +18845,7 @@ void clif_defaults(void) {
 	clif->party_message = clif_party_message;
 	clif->party_xy = clif_party_xy;
 	clif->party_xy_single = clif_party_xy_single;
+	clif->party_xy_list = clif_party_xy_list;
 	clif->party_hp = clif_party_hp;
 	clif->party_xy_remove = clif_party_xy_remove;
 	clif->party_show_picker = clif_party_show_picker;
@@ -18439,6 +18878,7 @@ void clif_defaults(void) {
 	clif->guild_broken = clif_guild_broken;
 	clif->guild_xy = clif_guild_xy;
 	clif->guild_xy_single = clif_guild_xy_single;
+	clif->guild_xy_list = clif_guild_xy_list;
 	clif->guild_xy_remove = clif_guild_xy_remove;
 	clif->guild_positionnamelist = clif_guild_positionnamelist;
 	clif->guild_positioninfolist = clif_guild_positioninfolist;
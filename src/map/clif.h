@@ -525,6 +525,14 @@ struct clif_interface {
 	unsigned int cryptKey[3];
 	/* */
 	bool ally_only;
+	/* interest management (battle_config.aoi_batch) */
+	struct {
+		int *observer; // char ids with pending sd->aoi.enter
+		int observer_count, observer_max;
+		int timer;
+		unsigned int spawn, vanish, coalesced; // packets sent and saved since the last report
+		int64 report_tick;
+	} aoi;
 	/* core */
 	int (*init) (void);
 	void (*final) (void);
@@ -583,6 +591,7 @@ struct clif_interface {
 	void (*skillunit_update) (struct block_list* bl);
 	int (*clearunit_delayed_sub) (int tid, int64 tick, int id, intptr_t data);
 	void (*set_unit_idle) (struct block_list* bl, struct map_session_data *tsd,enum send_target target);
+	void (*look_changed) (struct block_list *bl);
 	void (*spawn_unit) (struct block_list* bl, enum send_target target);
 	void (*spawn_unit2) (struct block_list* bl, enum send_target target);
 	void (*set_unit_idle2) (struct block_list* bl, struct map_session_data *tsd, enum send_target target);
@@ -639,6 +648,16 @@ struct clif_interface {
 	void (*hotkeys) (struct map_session_data *sd);
 	int (*insight) (struct block_list *bl,va_list ap);
 	int (*outsight) (struct block_list *bl,va_list ap);
+	void (*aoi_enter) (struct map_session_data *sd, struct block_list *bl);
+	void (*aoi_leave) (struct map_session_data *sd, struct block_list *bl);
+	void (*aoi_vanish) (struct map_session_data *sd, struct block_list *bl);
+	void (*aoi_known_add) (struct map_session_data *sd, int id);
+	bool (*aoi_known_remove) (struct map_session_data *sd, int id);
+	void (*aoi_cancel) (int id);
+	void (*aoi_reset) (struct map_session_data *sd);
+	void (*aoi_free) (struct map_session_data *sd);
+	int (*aoi_flush_timer) (int tid, int64 tick, int id, intptr_t data);
+	int (*aoi_stats_timer) (int tid, int64 tick, int id, intptr_t data);
 	void (*skillcastcancel) (struct block_list* bl);
 	void (*skill_fail) (struct map_session_data *sd,uint16 skill_id,enum useskill_fail_cause cause,int btype);
 	void (*skill_cooldown) (struct map_session_data *sd, uint16 skill_id, unsigned int duration);
@@ -825,6 +844,7 @@ struct clif_interface {
 	void (*party_message) (struct party_data* p, int account_id, const char* mes, int len);
 	void (*party_xy) (struct map_session_data *sd);
 	void (*party_xy_single) (int fd, struct map_session_data *sd);
+	void (*party_xy_list) (struct party_data *p, struct map_session_data **movers, int count);
 	void (*party_hp) (struct map_session_data *sd);
 	void (*party_xy_remove) (struct map_session_data *sd);
 	void (*party_show_picker) (struct map_session_data * sd, struct item * item_data);
@@ -857,6 +877,7 @@ struct clif_interface {
 	void (*guild_broken) (struct map_session_data *sd,int flag);
 	void (*guild_xy) (struct map_session_data *sd);
 	void (*guild_xy_single) (int fd, struct map_session_data *sd);
+	void (*guild_xy_list) (struct guild *g, struct map_session_data **movers, int count);
 	void (*guild_xy_remove) (struct map_session_data *sd);
 	void (*guild_positionnamelist) (struct map_session_data *sd);
 	void (*guild_positioninfolist) (struct map_session_data *sd);
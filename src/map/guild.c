@@ -291,7 +291,8 @@ int guild_payexp_timer(int tid, int64 tick, int id, intptr_t data) {
 int guild_send_xy_timer_sub(DBKey key, DBData *data, va_list ap)
 {
 	struct guild *g = DB->data2ptr(data);
-	int i;
+	struct map_session_data *movers[MAX_GUILD];
+	int i, count = 0;
 
 	nullpo_ret(g);
 
@@ -304,11 +305,13 @@ int guild_send_xy_timer_sub(DBKey key, DBData *data, va_list ap)
 		struct map_session_data* sd = g->member[i].sd;
 		if( sd != NULL && sd->fd && (sd->guild_x != sd->bl.x || sd->guild_y != sd->bl.y) && !sd->bg_id )
 		{
-			clif->guild_xy(sd);
+			movers[count++] = sd;
 			sd->guild_x = sd->bl.x;
 			sd->guild_y = sd->bl.y;
 		}
 	}
+	// one write per member for everyone who moved
+	clif->guild_xy_list(g, movers, count);
 	return 0;
 }
 
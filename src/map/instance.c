@@ -147,7 +147,7 @@ int instance_create(int owner_id, const char *name, enum instance_owner_type typ
 int instance_add_map(const char *name, int instance_id, bool usebasename, const char *map_name) {
 	int16 m = map->mapname2mapid(name);
 	int i, im = -1;
-	size_t num_cell, size;
+	size_t size;
 
 	if( m < 0 )
 		return -1; // source map not found
@@ -172,9 +172,11 @@ int instance_add_map(const char *name, int instance_id, bool usebasename, const
 		
 	if( i < map->count )
 		im = i; // Unused map found (old instance)
+	else if( map->count < map->list_max )
+		im = map->count++; // Using next map index from the pool
 	else {
-		im = map->count; // Using next map index
-		RECREATE(map->list,struct map_data,++map->count);
+		ShowError("instance_add_map: no free map slot for '%s', increase 'instance_map_pool' (currently %d).\n", name, map->instance_pool);
+		return -3;
 	}
 	
 	if( map->list[m].cell == (struct mapcell *)0xdeadbeaf )
@@ -189,21 +191,22 @@ int instance_add_map(const char *name, int instance_id, bool usebasename, const
 	map->list[im].index = mapindex_addmap(-1, map->list[im].name); // Add map index
 
 	map->list[im].channel = NULL;
+	map->list[im].standby = false;
 	
 	if( !map->list[im].index ) {
 		map->list[im].name[0] = '\0';
+		map->list[im].cell = NULL; // still the source map's
 		ShowError("instance_add_map: no more free map indexes.\n");
 		return -3; // No free map index
 	}
 	
-	// Reallocate cells
-	num_cell = map->list[im].xs * map->list[im].ys;
-	CREATE( map->list[im].cell, struct mapcell, num_cell );
-	memcpy( map->list[im].cell, map->list[m].cell, num_cell * sizeof(struct mapcell) );
+	// Share cells with the source map, pages get copied on write
+	map->cell_share(im, m);
 
 	size = map->list[im].bxs * map->list[im].bys * sizeof(struct block_list*);
 	map->list[im].block = (struct block_list**)aCalloc(size, 1);
 	map->list[im].block_mob = (struct block_list**)aCalloc(size, 1);
+	CREATE(map->list[im].block_char, unsigned int, map->list[im].bxs * map->list[im].bys);
 
 	memset(map->list[im].npc, 0x00, sizeof(map->list[i].npc));
 	map->list[im].npc_num = 0;
@@ -422,9 +425,10 @@ void instance_del_map(int16 m) {
 	mapindex_removemap(map_id2index(m));
 
 	// Free memory
-	aFree(map->list[m].cell);
+	map->cell_unshare(&map->list[m]);
 	aFree(map->list[m].block);
 	aFree(map->list[m].block_mob);
+	aFree(map->list[m].block_char);
 	
 	if( map->list[m].unit_count ) {
 		for(i = 0; i < map->list[m].unit_count; i++) {
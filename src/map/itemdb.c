@@ -14,6 +14,7 @@
 #include "battle.h" // struct battle_config
 #include "script.h" // item script processing
 #include "pc.h"     // W_MUSICAL, W_WHIP
+#include "status.h" // item bonus cache
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -1684,6 +1685,9 @@ int itemdb_parse_dbrow(char** str, const char* source, int line, int scriptopt)
 		script->free_code(id->script);
 		id->script = NULL;
 	}
+	// recorded bonuses belong to the old script (their memory is released on reload)
+	id->bonus_state = ITEM_BONUS_UNKNOWN;
+	id->bonus_vec = NULL;
 	if (id->equip_script) {
 		script->free_code(id->equip_script);
 		id->equip_script = NULL;
@@ -2058,6 +2062,9 @@ void itemdb_reload(void) {
 	itemdb->other->clear(itemdb->other, itemdb->final_sub);
 	
 	memset(itemdb->array, 0, sizeof(itemdb->array));
+
+	// the recorded item bonuses belonged to the freed item data
+	status->item_bonus_clear();
 	
 	db_clear(itemdb->names);
 		
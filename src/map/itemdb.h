@@ -14,6 +14,7 @@
  **/
 struct item_group;
 struct item_package;
+struct status_item_bonus_vec;
 
 /**
  * Defines
@@ -159,6 +160,9 @@ struct item_data {
 	/* TODO add a pointer to some sort of (struct extra) and gather all the not-common vals into it to save memory */
 	struct item_group *group;
 	struct item_package *package;
+	/* bonuses recorded from the script, see status->item_script */
+	unsigned char bonus_state; // enum status_item_bonus_state
+	struct status_item_bonus_vec *bonus_vec;
 };
 
 struct item_combo {
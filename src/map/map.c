@@ -154,7 +154,7 @@ void map_addblcell(struct block_list *bl) {
 	              || bl->y < 0 || bl->y >= map->list[bl->m].ys
 	              || !(bl->type&BL_CHAR) )
 		return;
-	map->list[bl->m].cell[bl->x+bl->y*map->list[bl->m].xs].cell_bl++;
+	map->cell_write(bl->m, bl->x+bl->y*map->list[bl->m].xs)->cell_bl++;
 #else
 	return;
 #endif
@@ -165,7 +165,7 @@ void map_delblcell(struct block_list *bl) {
 	if( bl->m < 0 || bl->x < 0 || bl->x >= map->list[bl->m].xs
 	              || bl->y < 0 || bl->y >= map->list[bl->m].ys
 	              || !(bl->type&BL_CHAR) )
-	map->list[bl->m].cell[bl->x+bl->y*map->list[bl->m].xs].cell_bl--;
+	map->cell_write(bl->m, bl->x+bl->y*map->list[bl->m].xs)->cell_bl--;
 #else
 	return;
 #endif
@@ -212,6 +212,8 @@ int map_addblock(struct block_list* bl)
 		if (bl->next) bl->next->prev = bl;
 		map->list[m].block[pos] = bl;
 	}
+	if (bl->type&BL_CHAR)
+		map->list[m].block_char[pos]++;
 
 #ifdef CELL_NOSTACK
 	map->addblcell(bl);
@@ -255,6 +257,8 @@ int map_delblock(struct block_list* bl)
 	} else {
 		bl->prev->next = bl->next;
 	}
+	if (bl->type&BL_CHAR)
+		map->list[bl->m].block_char[pos]--;
 	bl->next = NULL;
 	bl->prev = NULL;
 
@@ -369,6 +373,33 @@ int map_moveblock(struct block_list *bl, int x1, int y1, int64 tick) {
 	return 0;
 }
 
+/*==========================================
+ * Tells whether BL_CHAR objects may be in the given area.
+ * Only the per-block counts are checked, so a true result is
+ * approximate (the blocks overlap the area), a false one is exact.
+ *------------------------------------------*/
+bool map_chars_inarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1) {
+	int bx, by;
+
+	if (m < 0)
+		return false;
+
+	if (x1 < x0) swap(x0, x1);
+	if (y1 < y0) swap(y0, y1);
+
+	x0 = max(x0, 0);
+	y0 = max(y0, 0);
+	x1 = min(x1, map->list[m].xs - 1);
+	y1 = min(y1, map->list[m].ys - 1);
+
+	for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++)
+		for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++)
+			if (map->list[m].block_char[bx + by * map->list[m].bxs])
+				return true;
+
+	return false;
+}
+
 /*==========================================
  * Counts specified number of objects on given cell.
  * TODO: merge with bl_getall_area
@@ -1754,6 +1785,9 @@ int map_quit(struct map_session_data *sd) {
 	}
 
 	if( sd->state.vending ) {
+		int i;
+		for( i = 0; i < sd->vend_num; i++ )
+			vending->index_remove(sd, i);
 		idb_remove(vending->db, sd->status.char_id);
 	}
 	
@@ -2353,6 +2387,15 @@ int16 map_mapindex2mapid(unsigned short mapindex) {
  *------------------------------------------*/
 int map_mapname2ipport(unsigned short name, uint32* ip, uint16* port) {
 	struct map_data_other_server *mdos;
+	int16 m = map->mapindex2mapid(name);
+
+	if( m >= 0 ) { // Local map, only elsewhere when on standby
+		if( !map->list[m].standby )
+			return -1;
+		*ip = map->list[m].owner_ip;
+		*port = map->list[m].owner_port;
+		return 0;
+	}
 
 	mdos = (struct map_data_other_server*)uidb_get(map->map_db,(unsigned int)name);
 	if(mdos==NULL || mdos->cell) //If gat isn't null, this is a local map.
@@ -2532,7 +2575,7 @@ int map_getcellp(struct map_data* m,int16 x,int16 y,cell_chk cellchk) {
 	if(x<0 || x>=m->xs-1 || y<0 || y>=m->ys-1)
 		return( cellchk == CELL_CHKNOPASS );
 
-	cell = m->cell[x + y*m->xs];
+	cell = map_cell(m, x + y*m->xs);
 
 	switch(cellchk) {
 		// gat type retrieval
@@ -2606,25 +2649,25 @@ int map_sub_getcellp(struct map_data* m,int16 x,int16 y,cell_chk cellchk) {
  * 'flag' - true = on, false = off
  *------------------------------------------*/
 void map_setcell(int16 m, int16 x, int16 y, cell_t cell, bool flag) {
-	int j;
+	struct mapcell *c;
 
 	if( m < 0 || m >= map->count || x < 0 || x >= map->list[m].xs || y < 0 || y >= map->list[m].ys )
 		return;
 
-	j = x + y*map->list[m].xs;
+	c = map->cell_write(m, x + y*map->list[m].xs);
 
 	switch( cell ) {
-	case CELL_WALKABLE:      map->list[m].cell[j].walkable = flag;      break;
-	case CELL_SHOOTABLE:     map->list[m].cell[j].shootable = flag;     break;
-	case CELL_WATER:         map->list[m].cell[j].water = flag;         break;
-
-	case CELL_NPC:           map->list[m].cell[j].npc = flag;           break;
-	case CELL_BASILICA:      map->list[m].cell[j].basilica = flag;      break;
-	case CELL_LANDPROTECTOR: map->list[m].cell[j].landprotector = flag; break;
-	case CELL_NOVENDING:     map->list[m].cell[j].novending = flag;     break;
-	case CELL_NOCHAT:        map->list[m].cell[j].nochat = flag;        break;
-	case CELL_MAELSTROM:     map->list[m].cell[j].maelstrom = flag;     break;
-	case CELL_ICEWALL:       map->list[m].cell[j].icewall = flag;       break;
+	case CELL_WALKABLE:      c->walkable = flag;      break;
+	case CELL_SHOOTABLE:     c->shootable = flag;     break;
+	case CELL_WATER:         c->water = flag;         break;
+
+	case CELL_NPC:           c->npc = flag;           break;
+	case CELL_BASILICA:      c->basilica = flag;      break;
+	case CELL_LANDPROTECTOR: c->landprotector = flag; break;
+	case CELL_NOVENDING:     c->novending = flag;     break;
+	case CELL_NOCHAT:        c->nochat = flag;        break;
+	case CELL_MAELSTROM:     c->maelstrom = flag;     break;
+	case CELL_ICEWALL:       c->icewall = flag;       break;
 	default:
 		ShowWarning("map_setcell: invalid cell type '%d'\n", (int)cell);
 		break;
@@ -2640,18 +2683,71 @@ void map_sub_setcell(int16 m, int16 x, int16 y, cell_t cell, bool flag) {
 	map->list[m].setcell(m,x,y,cell,flag);
 }
 void map_setgatcell(int16 m, int16 x, int16 y, int gat) {
-	int j;
-	struct mapcell cell;
+	struct mapcell cell, *c;
 
 	if( m < 0 || m >= map->count || x < 0 || x >= map->list[m].xs || y < 0 || y >= map->list[m].ys )
 		return;
 
-	j = x + y*map->list[m].xs;
+	c = map->cell_write(m, x + y*map->list[m].xs);
 
 	cell = map->gat2cell(gat);
-	map->list[m].cell[j].walkable = cell.walkable;
-	map->list[m].cell[j].shootable = cell.shootable;
-	map->list[m].cell[j].water = cell.water;
+	c->walkable = cell.walkable;
+	c->shootable = cell.shootable;
+	c->water = cell.water;
+}
+
+/*==========================================
+ * Copy-on-write cells of instance maps
+ *------------------------------------------*/
+static void map_cell_page_copy(struct map_data *m, int p) {
+	int base = p << MAP_CELL_PAGE_SHIFT;
+	int num = min(MAP_CELL_PAGE_MASK + 1, m->xs*m->ys - base);
+
+	CREATE(m->cell_page[p], struct mapcell, MAP_CELL_PAGE_MASK + 1);
+	memcpy(m->cell_page[p], &m->cell[base], num * sizeof(struct mapcell));
+}
+
+/// Returns cell j of map m for writing.
+/// Instance maps get a private copy of the page first; on a source map,
+/// instances still sharing the page are given their copy before it changes.
+struct mapcell* map_cell_write(int16 m, int j) {
+	struct map_data *md = &map->list[m];
+	int p = j >> MAP_CELL_PAGE_SHIFT;
+
+	if( md->flag.src4instance ) {
+		int i;
+		for( i = instance->start_id; i < map->count; i++ ) {
+			if( map->list[i].cell_page && map->list[i].instance_src_map == m && !map->list[i].cell_page[p] )
+				map_cell_page_copy(&map->list[i], p);
+		}
+	}
+
+	if( !md->cell_page )
+		return &md->cell[j];
+
+	if( !md->cell_page[p] )
+		map_cell_page_copy(md, p);
+
+	return &md->cell_page[p][j & MAP_CELL_PAGE_MASK];
+}
+
+/// Makes instance map im read its cells from source map m.
+void map_cell_share(int16 im, int16 m) {
+	map->list[im].cell = map->list[m].cell;
+	CREATE(map->list[im].cell_page, struct mapcell*, map_cell_pages(&map->list[m]));
+}
+
+/// Releases the private cell pages of an instance map.
+void map_cell_unshare(struct map_data *m) {
+	int p, pages = map_cell_pages(m);
+
+	for( p = 0; p < pages; p++ ) {
+		if( m->cell_page[p] )
+			aFree(m->cell_page[p]);
+	}
+	aFree(m->cell_page);
+	m->cell_page = NULL;
+	m->cell = NULL;
 }
 
 /*==========================================
@@ -2780,6 +2876,24 @@ DBData create_map_data_other_server(DBKey key, va_list args)
 int map_setipport(unsigned short mapindex, uint32 ip, uint16 port)
 {
 	struct map_data_other_server *mdos;
+	int16 m = map->mapindex2mapid(mapindex);
+
+	if( m >= 0 ) { // Local map, the char-server tells who hosts it
+		bool standby = ( ip != clif->map_ip || port != clif->map_port );
+
+		map->list[m].owner_ip = ip;
+		map->list[m].owner_port = port;
+		if( map->list[m].standby == standby )
+			return 0;
+		map->list[m].standby = standby;
+		if( standby ) {
+			int n = map->foreachinmap(map->standby_sub, m, BL_PC);
+			if( battle_config.etc_log || n )
+				ShowStatus("Map '%s' moved to %d.%d.%d.%d:%d (%d players sent over)\n", map->list[m].name, CONVIP(ip), port, n);
+		} else if( battle_config.etc_log )
+			ShowStatus("Map '%s' is now hosted by this map-server\n", map->list[m].name);
+		return 0;
+	}
 
 	mdos= uidb_ensure(map->map_db,(unsigned int)mapindex, map->create_map_data_other_server);
 
@@ -2795,6 +2909,31 @@ int map_setipport(unsigned short mapindex, uint32 ip, uint16 port)
 	return 1;
 }
 
+/**
+ * Sends a player on a map that went on standby to the map-server hosting it now
+ * @see map_foreachinmap
+ */
+int map_standby_sub(struct block_list *bl, va_list ap)
+{
+	struct map_session_data *sd = (TBL_PC*)bl;
+
+	if( !sd->state.active || sd->state.autotrade ) // autotraders have no client to send over
+		return 0;
+	return pc->setpos(sd, sd->mapindex, sd->bl.x, sd->bl.y, CLR_TELEPORT) == 0 ? 1 : 0;
+}
+
+/**
+ * Hosts all local maps again, done before (re)sending them to the char-server
+ * which then tells which of them other map-servers host.
+ */
+void map_standby_reset(void)
+{
+	int16 m;
+
+	for( m = 0; m < map->count; m++ )
+		map->list[m].standby = false;
+}
+
 /**
  * Delete all the other maps server management
  * @see DBApply
@@ -3004,9 +3143,11 @@ void map_zone_db_clear(void) {
 }
 void map_clean(int i) {
 	int v;
-	if(map->list[i].cell && map->list[i].cell != (struct mapcell *)0xdeadbeaf) aFree(map->list[i].cell);
+	if(map->list[i].cell_page) map->cell_unshare(&map->list[i]);
+	else if(map->list[i].cell && map->list[i].cell != (struct mapcell *)0xdeadbeaf) aFree(map->list[i].cell);
 	if(map->list[i].block) aFree(map->list[i].block);
 	if(map->list[i].block_mob) aFree(map->list[i].block_mob);
+	if(map->list[i].block_char) aFree(map->list[i].block_char);
 
 	if(battle_config.dynamic_mobs) { //Dynamic mobs flag by [random]
 		int j;
@@ -3057,9 +3198,11 @@ void do_final_maps(void) {
 
 	for( i = 0; i < map->count; i++ ) {
 
-		if(map->list[i].cell && map->list[i].cell != (struct mapcell *)0xdeadbeaf ) aFree(map->list[i].cell);
+		if(map->list[i].cell_page) map->cell_unshare(&map->list[i]);
+		else if(map->list[i].cell && map->list[i].cell != (struct mapcell *)0xdeadbeaf ) aFree(map->list[i].cell);
 		if(map->list[i].block) aFree(map->list[i].block);
 		if(map->list[i].block_mob) aFree(map->list[i].block_mob);
+		if(map->list[i].block_char) aFree(map->list[i].block_char);
 
 		if(battle_config.dynamic_mobs) { //Dynamic mobs flag by [random]
 			int j;
@@ -3345,6 +3488,7 @@ int map_readallmaps (void) {
 		size = map->list[i].bxs * map->list[i].bys * sizeof(struct block_list*);
 		map->list[i].block = (struct block_list**)aCalloc(size, 1);
 		map->list[i].block_mob = (struct block_list**)aCalloc(size, 1);
+		CREATE(map->list[i].block_char, unsigned int, map->list[i].bxs * map->list[i].bys);
 
 		map->list[i].getcellp = map->sub_getcellp;
 		map->list[i].setcell  = map->sub_setcell;
@@ -3421,6 +3565,8 @@ int map_config_read(char *cfgName) {
 			map->port = (atoi(w2));
 		} else if (strcmpi(w1, "map") == 0)
 			map->count++;
+		else if (strcmpi(w1, "instance_map_pool") == 0)
+			map->instance_pool = max(atoi(w2), 0);
 		else if (strcmpi(w1, "delmap") == 0)
 			map->count--;
 		else if (strcmpi(w1, "npc") == 0)
@@ -3453,6 +3599,12 @@ int map_config_read(char *cfgName) {
 			map->enable_grf = config_switch(w2);
 		else if (strcmpi(w1, "console_msg_log") == 0)
 			console_msg_log = atoi(w2);//[Ind]
+		else if (strcmpi(w1, "console_msg_async") == 0)
+			console_msg_async = config_switch(w2);
+		else if (strcmpi(w1, "console_msg_rate") == 0)
+			console_msg_rate = max(atoi(w2), 0);
+		else if (strcmpi(w1, "console_msg_json") == 0)
+			safestrncpy(console_msg_json, w2, sizeof(console_msg_json));
 		else if (strcmpi(w1, "import") == 0)
 			map->config_read(w2);
 		else
@@ -5127,6 +5279,7 @@ void do_final(void)
 	pet->final();
 	mob->final();
 	homun->final();
+	quest->final();
 	atcommand->final_msg();
 	skill->final();
 	status->final();
@@ -5307,6 +5460,9 @@ CPCMD(gm_use) {
 	map->cpsd->fd = 0;
 
 }
+CPCMD(mob_ai) {
+	mob->ai_report(line ? atoi(line) : 20);
+}
 /* Hercules Console Parser */
 void map_cp_defaults(void) {
 #ifdef CONSOLE_INPUT
@@ -5319,6 +5475,7 @@ void map_cp_defaults(void) {
 
 	console->addCommand("gm:info",CPCMD_A(gm_position));
 	console->addCommand("gm:use",CPCMD_A(gm_use));
+	console->addCommand("mob:ai",CPCMD_A(mob_ai));
 #endif
 }
 /* Hercules Plugin Mananger */
@@ -5490,7 +5647,9 @@ int do_init(int argc, char *argv[])
 
 	map_load_defaults();
 	map->config_read(map->MAP_CONF_NAME);
-	CREATE(map->list,struct map_data,map->count);
+	// instances take their maps from a preallocated pool, map->list is never moved after this
+	map->list_max = map->count + map->instance_pool;
+	CREATE(map->list,struct map_data,map->list_max);
 	map->count = 0;
 	map->config_read_sub(map->MAP_CONF_NAME);
 	// loads npcs
@@ -5621,6 +5780,8 @@ void map_defaults(void) {
 
 	/* */
 	map->count = 0;
+	map->list_max = 0;
+	map->instance_pool = 128;
 	
 	sprintf(map->db_path ,"db");
 	sprintf(map->help_txt ,"conf/help.txt");
@@ -5717,6 +5878,9 @@ void map_defaults(void) {
 	map->setgatcell = map_setgatcell;
 
 	map->cellfromcache = map_cellfromcache;
+	map->cell_write = map_cell_write;
+	map->cell_share = map_cell_share;
+	map->cell_unshare = map_cell_unshare;
 	// users
 	map->setusers = map_setusers;
 	map->getusers = map_getusers;
@@ -5731,6 +5895,7 @@ void map_defaults(void) {
 	map->moveblock = map_moveblock;
 	//blocklist nb in one cell
 	map->count_oncell = map_count_oncell;
+	map->chars_inarea = map_chars_inarea;
 	map->find_skill_unit_oncell = map_find_skill_unit_oncell;
 	// search and creation
 	map->get_new_object_id = map_get_new_object_id;
@@ -5797,6 +5962,8 @@ void map_defaults(void) {
 	map->setipport = map_setipport;
 	map->eraseipport = map_eraseipport;
 	map->eraseallipport = map_eraseallipport;
+	map->standby_sub = map_standby_sub;
+	map->standby_reset = map_standby_reset;
 	map->addiddb = map_addiddb;
 	map->deliddb = map_deliddb;
 	/* */
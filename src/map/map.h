@@ -323,6 +323,7 @@ struct spawn_data {
 	unsigned short active;//Number of mobs that are already spawned (for mob_remove_damaged: no)
 	unsigned int delay1, delay2; //Spawn delay (fixed base + random variance)
 	unsigned int level;
+	unsigned int file_id; //Id of the npc source file that defined this spawn (0: none)
 	struct {
 		unsigned int size : 2; //Holds if mob has to be tiny/large
 		unsigned int ai : 4; //Special ai for summoned monsters.
@@ -491,6 +492,14 @@ struct mapcell {
 #endif
 };
 
+/// Instance maps share the source map's cells, a page of cells is only
+/// copied when it is first written (on either map).
+#define MAP_CELL_PAGE_SHIFT 8
+#define MAP_CELL_PAGE_MASK ((1<<MAP_CELL_PAGE_SHIFT)-1)
+#define map_cell_pages(m) (((m)->xs*(m)->ys+MAP_CELL_PAGE_MASK)>>MAP_CELL_PAGE_SHIFT)
+/// Reads cell j of map m, looking through the private pages of instance maps
+#define map_cell(m,j) ( (m)->cell_page && (m)->cell_page[(j)>>MAP_CELL_PAGE_SHIFT] ? (m)->cell_page[(j)>>MAP_CELL_PAGE_SHIFT][(j)&MAP_CELL_PAGE_MASK] : (m)->cell[(j)] )
+
 struct iwall_data {
 	char wall_name[50];
 	short m, x, y, size;
@@ -572,6 +581,7 @@ struct map_data {
 	char name[MAP_NAME_LENGTH];
 	uint16 index; // The map index used by the mapindex* functions.
 	struct mapcell* cell; // Holds the information of each map cell (NULL if the map is not on this map-server).
+	struct mapcell** cell_page; // Instance maps: private copies of written cell pages, 'cell' points to the source map's cells
 	
 	/* 2D Orthogonal Range Search: Grid Implementation
 	   "Algorithms in Java, Parts 1-4" 3.18, Robert Sedgewick
@@ -584,6 +594,7 @@ struct map_data {
 	*/
 	struct block_list **block; // Grid array of block_lists containing only non-BL_MOB objects
 	struct block_list **block_mob; // Grid array of block_lists containing only BL_MOB objects
+	unsigned int *block_char; // Number of BL_CHAR objects in each block, lets area scans for characters skip empty areas
 	
 	int16 m;
 	int16 xs,ys; // map dimensions (in cells)
@@ -592,6 +603,7 @@ struct map_data {
 	int npc_num;
 	int users;
 	int users_pvp;
+	uint64 mob_ai_time; // Microseconds spent in mob AI while the profiler is recording, see mob:ai
 	int iwall_num; // Total of invisible walls in this map
 	struct map_flag {
 		unsigned town : 1; // [Suggestion to protect Mail System]
@@ -665,6 +677,10 @@ struct map_data {
 	// Instance Variables
 	int instance_id;
 	int instance_src_map;
+	// Loaded here, but hosted by the map-server at owner_ip:owner_port (the char-server decides, see map_setipport)
+	bool standby;
+	uint32 owner_ip;
+	uint16 owner_port;
 
 	/* adjust_unit_duration mapflag */
 	struct mapflag_skill_adjust **units;
@@ -798,6 +814,8 @@ struct map_interface {
 
 	/* vars */
 	int count;
+	int list_max; // allocated size of map->list, instance maps use the slots past the loaded maps
+	int instance_pool; // map slots reserved for instances
 
 	int autosave_interval;
 	int minsave_interval;
@@ -892,6 +910,9 @@ struct map_interface {
 	void (*setgatcell) (int16 m, int16 x, int16 y, int gat);
 
 	void (*cellfromcache) (struct map_data *m);
+	struct mapcell* (*cell_write) (int16 m, int j);
+	void (*cell_share) (int16 im, int16 m);
+	void (*cell_unshare) (struct map_data *m);
 	// users
 	void (*setusers) (int);
 	int (*getusers) (void);
@@ -906,6 +927,7 @@ struct map_interface {
 	int (*moveblock) (struct block_list *bl, int x1, int y1, int64 tick);
 	//blocklist nb in one cell
 	int (*count_oncell) (int16 m,int16 x,int16 y,int type);
+	bool (*chars_inarea) (int16 m, int16 x0, int16 y0, int16 x1, int16 y1);
 	struct skill_unit * (*find_skill_unit_oncell) (struct block_list* target,int16 x,int16 y,uint16 skill_id,struct skill_unit* out_unit, int flag);
 	// search and creation
 	int (*get_new_object_id) (void);
@@ -972,6 +994,8 @@ struct map_interface {
 	int (*setipport) (unsigned short mapindex, uint32 ip, uint16 port);
 	int (*eraseipport) (unsigned short mapindex, uint32 ip, uint16 port);
 	int (*eraseallipport) (void);
+	int (*standby_sub) (struct block_list *bl, va_list ap);
+	void (*standby_reset) (void);
 	void (*addiddb) (struct block_list *bl);
 	void (*deliddb) (struct block_list *bl);
 	/* */
@@ -9,6 +9,7 @@
 #include "../common/malloc.h"
 #include "../common/showmsg.h"
 #include "../common/ers.h"
+#include "../common/profiler.h"
 #include "../common/random.h"
 #include "../common/strlib.h"
 #include "../common/utils.h"
@@ -941,6 +942,12 @@ int mob_spawn (struct mob_data *md)
 	md->dmgtick = tick - 5000;
 	md->last_pcneartime = 0;
 
+	// Slaves, and mobs spotted before on a map that has players, have something to do in the lazy AI
+	if( md->master_id || (md->state.spotted && map->list[md->bl.m].users > 0) )
+		mob->ai_activate(md);
+	else
+		mob->ai_sleep(md);
+
 	for (i = 0, c = tick-MOB_MAX_DELAY; i < MAX_MOBSKILL; i++)
 		md->skilldelay[i] = c;
 
@@ -1648,6 +1655,7 @@ int mob_ai_sub_hard_timer(struct block_list *bl, va_list ap) {
 		if(!md->state.spotted)
 			md->state.spotted = 1;
 		md->last_pcneartime = tick;
+		mob->ai_activate(md);
 	}
 	return 0;
 }
@@ -1656,9 +1664,12 @@ int mob_ai_sub_hard_timer(struct block_list *bl, va_list ap) {
  * Serious processing for mob in PC field of view (foreachclient)
  *------------------------------------------*/
 int mob_ai_sub_foreachclient(struct map_session_data *sd, va_list ap) {
-	int64 tick;
+	int64 tick, zone;
 	tick=va_arg(ap, int64);
+	zone = profiler->begin();
 	map->foreachinrange(mob->ai_sub_hard_timer,&sd->bl, AREA_SIZE+ACTIVE_AI_RANGE, BL_MOB,tick);
+	if( zone )
+		map->list[sd->bl.m].mob_ai_time += timer->microtick() - zone;
 
 	return 0;
 }
@@ -1733,8 +1744,51 @@ int mob_ai_sub_lazy(struct mob_data *md, va_list args) {
 /*==========================================
  * Negligent processing for mob outside PC field of view   (interval timer function)
  *------------------------------------------*/
+static int mob_ai_sub_lazy_call(struct mob_data *md, ...) {
+	va_list ap;
+	int ret;
+
+	va_start(ap, md);
+	ret = mob->ai_sub_lazy(md, ap);
+	va_end(ap);
+
+	return ret;
+}
+
 int mob_ai_lazy(int tid, int64 tick, int id, intptr_t data) {
-	map->foreachmob(mob->ai_sub_lazy,tick);
+	int i;
+
+	if (battle_config.mob_ai&0x20) {
+		map->foreachmob(mob->ai_sub_lazy,tick);
+		return 0;
+	}
+
+	// Only the active mobs are visited. Going backwards, mobs activated meanwhile
+	// wait for the next round and mobs put to sleep don't make us skip any.
+	map->freeblock_lock();
+	for( i = mob->active_count-1; i >= 0; i-- ) {
+		struct mob_data *md;
+		int16 m;
+		int64 zone;
+
+		if( i >= mob->active_count )
+			continue;
+		md = mob->active[i];
+		m = md->bl.m;
+
+		zone = profiler->begin();
+		mob_ai_sub_lazy_call(md, tick);
+		if( zone )
+			map->list[m].mob_ai_time += timer->microtick() - zone;
+
+		// Nothing left to do until a player comes near again
+		if( md->active_index && !md->master_id
+		 && (!md->last_pcneartime || !(md->status.mode&MD_BOSS ? battle_config.boss_active_time : battle_config.mob_active_time))
+		 && (md->bl.prev == NULL || !md->state.spotted || map->list[md->bl.m].users == 0) )
+			mob->ai_sleep(md);
+	}
+	map->freeblock_unlock();
+
 	return 0;
 }
 
@@ -1751,6 +1805,108 @@ int mob_ai_hard(int tid, int64 tick, int id, intptr_t data) {
 	return 0;
 }
 
+/*==========================================
+ * Puts a mob in the set visited by the lazy AI
+ *------------------------------------------*/
+void mob_ai_activate(struct mob_data *md) {
+	if( md->active_index )
+		return;
+
+	if( mob->active_count == mob->active_max ) {
+		mob->active_max += 256;
+		RECREATE(mob->active, struct mob_data *, mob->active_max);
+	}
+	mob->active[mob->active_count++] = md;
+	md->active_index = mob->active_count;
+}
+
+/*==========================================
+ * Makes a mob dormant, the lazy AI skips it until it's activated again
+ *------------------------------------------*/
+void mob_ai_sleep(struct mob_data *md) {
+	int i = md->active_index - 1;
+
+	if( i < 0 )
+		return;
+
+	mob->active[i] = mob->active[--mob->active_count];
+	mob->active[i]->active_index = i + 1;
+	md->active_index = 0;
+}
+
+int mob_ai_wake_sub(struct block_list *bl, va_list ap) {
+	struct mob_data *md = (struct mob_data *)bl;
+
+	if( md->state.spotted && md->bl.prev != NULL )
+		mob->ai_activate(md);
+
+	return 0;
+}
+
+/*==========================================
+ * Wakes the mobs of a map that were spotted before it became empty
+ *------------------------------------------*/
+void mob_ai_wake_map(int16 m) {
+	map->foreachinmap(mob->ai_wake_sub, m, BL_MOB);
+}
+
+struct mob_ai_stat {
+	int16 m;
+	int total, active;
+	uint64 time;
+};
+
+static int mob_ai_report_sub(struct mob_data *md, va_list ap) {
+	struct mob_ai_stat *stats = va_arg(ap, struct mob_ai_stat *);
+
+	if( md->bl.m >= 0 && md->bl.m < map->count )
+		stats[md->bl.m].total++;
+
+	return 0;
+}
+
+static int mob_ai_report_cmp(const void *a, const void *b) {
+	const struct mob_ai_stat *x = a, *y = b;
+
+	if( x->time != y->time )
+		return x->time < y->time ? 1 : -1;
+	return y->total - x->total;
+}
+
+/*==========================================
+ * Prints the active/dormant mob counts and the AI time of the busiest maps,
+ * the times are reset afterwards.
+ *------------------------------------------*/
+void mob_ai_report(int top) {
+	struct mob_ai_stat *stats;
+	int i, total = 0;
+
+	CREATE(stats, struct mob_ai_stat, max(map->count, 1));
+	for( i = 0; i < map->count; i++ ) {
+		stats[i].m = i;
+		stats[i].time = map->list[i].mob_ai_time;
+		map->list[i].mob_ai_time = 0;
+	}
+	map->foreachmob(mob_ai_report_sub, stats);
+	for( i = 0; i < mob->active_count; i++ ) {
+		int16 m = mob->active[i]->bl.m;
+		if( m >= 0 && m < map->count )
+			stats[m].active++;
+	}
+	for( i = 0; i < map->count; i++ )
+		total += stats[i].total;
+	qsort(stats, map->count, sizeof(struct mob_ai_stat), mob_ai_report_cmp);
+
+	ShowInfo("mob AI: %d mobs, %d active, %d dormant.%s\n", total, mob->active_count, total - mob->active_count,
+		profiler->enabled ? "" : " AI times are only measured while the profiler is recording.");
+	for( i = 0; i < top && i < map->count && stats[i].total; i++ ) {
+		const struct mob_ai_stat *st = &stats[i];
+		ShowMessage("  %-16s %5d users %6d mobs %6d active %6d dormant %10.2f ms AI\n", map->list[st->m].name,
+			map->list[st->m].users, st->total, st->active, st->total - st->active, st->time/1000.);
+	}
+	aFree(stats);
+}
+
 /*==========================================
  * Initializes the delay drop structure for mob-dropped items.
  *------------------------------------------*/
@@ -4580,6 +4736,30 @@ void mob_clear_spawninfo()
 			memset(&mob->db_data[i]->spawn,0,sizeof(mob->db_data[i]->spawn));
 }
 
+void mob_spawninfo_remove(struct spawn_data *data)
+{	//Takes a single spawn set out of the spawn lookup, used when only part of the scripts is reloaded.
+	struct mob_db *db = mob->db(data->class_);
+	unsigned short mapindex = map_id2index(data->m);
+	int i, j;
+
+	ARR_FIND(0, ARRAYLENGTH(db->spawn), i, db->spawn[i].mapindex == mapindex);
+	if (i == ARRAYLENGTH(db->spawn))
+		return;
+	if (db->spawn[i].qty > data->num) {
+		db->spawn[i].qty -= data->num;
+		//Keep the list sorted by quantity
+		for (j = i; j+1 < ARRAYLENGTH(db->spawn) && db->spawn[j+1].qty > db->spawn[i].qty; ++j);
+		if (j != i) {
+			struct spawn_info tmp = db->spawn[i];
+			memmove(&db->spawn[i], &db->spawn[i+1], (j-i)*sizeof(db->spawn[0]));
+			db->spawn[j] = tmp;
+		}
+	} else {
+		memmove(&db->spawn[i], &db->spawn[i+1], sizeof(db->spawn) - (i+1)*sizeof(db->spawn[0]));
+		memset(&db->spawn[ARRAYLENGTH(db->spawn)-1], 0, sizeof(db->spawn[0]));
+	}
+}
+
 /*==========================================
  * Circumference initialization of mob
  *------------------------------------------*/
@@ -4643,6 +4823,10 @@ int do_final_mob(void)
 	}
 	ers_destroy(item_drop_ers);
 	ers_destroy(item_drop_list_ers);
+	if( mob->active )
+		aFree(mob->active);
+	mob->active = NULL;
+	mob->active_count = mob->active_max = 0;
 	return 0;
 }
 
@@ -4659,6 +4843,9 @@ void mob_defaults(void) {
 	
 	memcpy(mob->manuk, mob_manuk, sizeof(mob->manuk));
 	memcpy(mob->splendide, mob_splendide, sizeof(mob->splendide));
+
+	mob->active = NULL;
+	mob->active_count = mob->active_max = 0;
 	/* */
 	mob->reload = mob_reload;
 	mob->init = do_init_mob;
@@ -4708,6 +4895,11 @@ void mob_defaults(void) {
 	mob->ai_sub_lazy = mob_ai_sub_lazy;
 	mob->ai_lazy = mob_ai_lazy;
 	mob->ai_hard = mob_ai_hard;
+	mob->ai_activate = mob_ai_activate;
+	mob->ai_sleep = mob_ai_sleep;
+	mob->ai_wake_sub = mob_ai_wake_sub;
+	mob->ai_wake_map = mob_ai_wake_map;
+	mob->ai_report = mob_ai_report;
 	mob->setdropitem = mob_setdropitem;
 	mob->setlootitem = mob_setlootitem;
 	mob->delay_item_drop = mob_delay_item_drop;
@@ -4756,4 +4948,5 @@ void mob_defaults(void) {
 	mob->readdb_itemratio = mob_readdb_itemratio;
 	mob->load = mob_load;
 	mob->clear_spawninfo = mob_clear_spawninfo;
+	mob->spawninfo_remove = mob_spawninfo_remove;
 }
@@ -173,6 +173,7 @@ struct mob_data {
 
 	int deletetimer;
 	int master_id,master_dist;
+	int active_index; // Position in mob->active + 1, 0 while dormant
 
 	int8 skill_idx;// key of array
 	int64 skilldelay[MAX_MOBSKILL];
@@ -258,6 +259,9 @@ struct mob_interface {
 	//Defines the Manuk/Splendide mob groups for the status reductions [Epoque]
 	int manuk[8];
 	int splendide[5];
+	// Mobs the lazy AI has to visit, the others are dormant
+	struct mob_data **active;
+	int active_count, active_max;
 	/* */
 	int (*init) (void);
 	int (*final) (void);
@@ -308,6 +312,11 @@ struct mob_interface {
 	int (*ai_sub_lazy) (struct mob_data *md, va_list args);
 	int (*ai_lazy) (int tid, int64 tick, int id, intptr_t data);
 	int (*ai_hard) (int tid, int64 tick, int id, intptr_t data);
+	void (*ai_activate) (struct mob_data *md);
+	void (*ai_sleep) (struct mob_data *md);
+	int (*ai_wake_sub) (struct block_list *bl, va_list ap);
+	void (*ai_wake_map) (int16 m);
+	void (*ai_report) (int top);
 	struct item_drop* (*setdropitem) (int nameid, int qty, struct item_data *data);
 	struct item_drop* (*setlootitem) (struct item *item);
 	int (*delay_item_drop) (int tid, int64 tick, int id, intptr_t data);
@@ -356,6 +365,7 @@ struct mob_interface {
 	bool (*readdb_itemratio) (char *str[], int columns, int current);
 	void (*load) (void);
 	void (*clear_spawninfo) ();
+	void (*spawninfo_remove) (struct spawn_data *data);
 };
 
 struct mob_interface *mob;
@@ -35,6 +35,13 @@
 #include <math.h>
 #include <time.h>
 #include <errno.h>
+#include <sys/stat.h>
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#define NPC_FILE_WATCH
+#endif
 
 struct npc_interface npc_s;
 
@@ -43,6 +50,8 @@ static int npc_warp=0;
 static int npc_shop=0;
 static int npc_script=0;
 static int npc_mob=0;
+static unsigned int npc_src_id=0; // last id handed out to a npc source file
+static unsigned int npc_current_src=0; // id of the npc source file being parsed
 static int npc_delay_mob=0;
 static int npc_cache_mob=0;
 
@@ -1897,6 +1906,9 @@ void npc_addsrcfile(const char* name)
 
 	file = (struct npc_src_list*)aMalloc(sizeof(struct npc_src_list) + strlen(name));
 	file->next = NULL;
+	file->id = ++npc_src_id;
+	file->mtime = 0;
+	file->reload = false;
 	safestrncpy(file->name, name, strlen(name) + 1);
 	if( file_prev == NULL )
 		npc->src_files = file;
@@ -2971,6 +2983,7 @@ const char* npc_parse_mob(char* w1, char* w2, char* w3, char* w4, const char* st
 	mobspawn.ys = (signed short)ys;
 	if (mob_lv > 0 && mob_lv <= MAX_LEVEL)
 		mobspawn.level = mob_lv;
+	mobspawn.file_id = npc_current_src;
 	if (size > 0 && size <= 2)
 		mobspawn.state.size = size;
 	if (ai > 0 && ai <= 4)
@@ -3459,6 +3472,8 @@ void npc_parsesrcfile(const char* filepath, bool runOnInit)
 	size_t len;
 	char* buffer;
 	const char* p;
+	struct npc_src_list* nsl;
+	struct stat st;
 
 	// read whole file to buffer
 	fp = fopen(filepath, "rb");
@@ -3467,6 +3482,13 @@ void npc_parsesrcfile(const char* filepath, bool runOnInit)
 		ShowError("npc_parsesrcfile: File not found '%s'.\n", filepath);
 		return;
 	}
+	if( (nsl = npc->src_file(filepath)) != NULL ) {
+		// remember the file version, npc->reload_changed() compares against it
+		if( fstat(fileno(fp), &st) == 0 )
+			nsl->mtime = st.st_mtime;
+		npc_current_src = nsl->id;
+	} else
+		npc_current_src = 0;
 	fseek(fp, 0, SEEK_END);
 	len = ftell(fp);
 	buffer = (char*)aMalloc(len+1);
@@ -3482,6 +3504,8 @@ void npc_parsesrcfile(const char* filepath, bool runOnInit)
 	}
 	fclose(fp);
 
+	script->cache_begin(filepath, buffer, len);
+
 	// parse buffer
 	for( p = script->skip_space(buffer); p && *p ; p = script->skip_space(p) )
 	{
@@ -3611,7 +3635,9 @@ void npc_parsesrcfile(const char* filepath, bool runOnInit)
 			p = strchr(p,'\n');// skip and continue
 		}
 	}
+	script->cache_end();
 	aFree(buffer);
+	npc_current_src = 0;
 
 	return;
 }
@@ -3786,6 +3812,7 @@ int npc_reload(void) {
 		"\t-'"CL_WHITE"%d"CL_RESET"' Mobs Cached\n"
 		"\t-'"CL_WHITE"%d"CL_RESET"' Mobs Not Cached\n",
 		npc_id - npc_new_min, npc_warp, npc_shop, npc_script, npc_mob, npc_cache_mob, npc_delay_mob);
+	script->cache_report();
 	
 	itemdb->name_constants();
 	
@@ -3835,6 +3862,255 @@ bool npc_unloadfile( const char* filepath ) {
 	return found;
 }
 
+/// Returns the npc source file entry for the given path, or NULL if it isn't listed
+struct npc_src_list* npc_src_file(const char* filepath) {
+	struct npc_src_list* file;
+
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		if( strcmp(file->name, filepath) == 0 )
+			return file;
+	}
+	return NULL;
+}
+
+/// Returns true if the npc of an "npcname::event" label comes from a file flagged for reload
+static bool npc_event_reloading(const char* eventname) {
+	char name[NAME_LENGTH];
+	const char* p = strstr(eventname, "::");
+	struct npc_data* nd;
+	struct npc_src_list* file;
+
+	if( p == NULL )
+		return false;
+	safestrncpy(name, eventname, min(p - eventname + 1, NAME_LENGTH));
+	if( (nd = npc->name2id(name)) == NULL || nd->path == NULL
+	 || (file = npc->src_file(nd->path)) == NULL )
+		return false;
+	return file->reload;
+}
+
+/// Removes all monsters and spawn data loaded from npc source files flagged for reload,
+/// together with the monsters spawned by their scripts (call it before unloading the npcs)
+void npc_unload_mobs(void) {
+	struct s_mapiterator* iter;
+	struct block_list* bl;
+	struct npc_src_list* file;
+	struct spawn_data **spawns = NULL;
+	int spawn_count = 0, spawn_max = 0;
+	int16 m;
+	int i, j;
+
+	// collect every spawn set coming from a flagged file before its mobs free it
+	iter = mapit_geteachiddb();
+	for( bl = (struct block_list*)mapit->first(iter); mapit->exists(iter); bl = (struct block_list*)mapit->next(iter) ) {
+		struct mob_data* md = BL_CAST(BL_MOB, bl);
+		if( md == NULL )
+			continue;
+		if( md->spawn == NULL || md->spawn->file_id == 0 ) {
+			// 'monster' spawns of the reloaded scripts, OnInit spawns them again
+			if( md->npc_event[0] && npc_event_reloading(md->npc_event) )
+				unit->free(bl, CLR_OUTSIGHT);
+			continue;
+		}
+		for( file = npc->src_files; file != NULL && file->id != md->spawn->file_id; file = file->next )
+			;
+		if( file == NULL || !file->reload )
+			continue;
+		if( !md->spawn->state.dynamic ) {
+			ARR_FIND(0, spawn_count, i, spawns[i] == md->spawn);
+			if( i == spawn_count ) {
+				if( spawn_count == spawn_max ) {
+					spawn_max += 32;
+					RECREATE(spawns, struct spawn_data*, spawn_max);
+				}
+				spawns[spawn_count++] = md->spawn;
+				mob->spawninfo_remove(md->spawn);
+			}
+		}
+		unit->free(bl, CLR_OUTSIGHT);
+	}
+	mapit->free(iter);
+
+	if( spawns )
+		aFree(spawns);
+
+	// dynamic spawn data is owned by the map mob lists
+	for( m = 0; m < map->count; m++ ) {
+		for( j = 0; j < MAX_MOB_LIST_PER_MAP; j++ ) {
+			struct spawn_data* data = map->list[m].moblist[j];
+			if( data == NULL || data->file_id == 0 )
+				continue;
+			for( file = npc->src_files; file != NULL && file->id != data->file_id; file = file->next )
+				;
+			if( file == NULL || !file->reload )
+				continue;
+			mob->spawninfo_remove(data);
+			aFree(data);
+			map->list[m].moblist[j] = NULL;
+		}
+	}
+}
+
+/// Reloads every npc source file flagged for reload, leaving all other files untouched.
+/// Files holding duplicates of a reloaded npc are reloaded as well.
+/// Returns the number of reloaded files.
+int npc_reload_files(void) {
+	struct npc_src_list* file;
+	struct npc_src_list* dup_file;
+	struct s_mapiterator* iter;
+	struct map_session_data* sd;
+	DBIterator* dbi;
+	struct npc_data* nd;
+	bool changed;
+	int count = 0;
+
+	// pull in the files of duplicates whose source npc goes away
+	do {
+		changed = false;
+		dbi = db_iterator(npc->name_db);
+		for( nd = dbi_first(dbi); dbi_exists(dbi); nd = dbi_next(dbi) ) {
+			struct npc_data* snd;
+			if( nd->src_id == 0 || nd->path == NULL || (snd = map->id2nd(nd->src_id)) == NULL || snd->path == NULL )
+				continue;
+			if( (file = npc->src_file(snd->path)) == NULL || !file->reload )
+				continue;
+			if( (dup_file = npc->src_file(nd->path)) != NULL && !dup_file->reload )
+				changed = dup_file->reload = true;
+		}
+		dbi_destroy(dbi);
+	} while( changed );
+
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		if( file->reload )
+			count++;
+	}
+	if( count == 0 )
+		return 0;
+
+	// release players talking to or shopping at the npcs being replaced
+	iter = mapit_getallusers();
+	for( sd = (TBL_PC*)mapit->first(iter); mapit->exists(iter); sd = (TBL_PC*)mapit->next(iter) ) {
+		int npc_id = sd->npc_id ? sd->npc_id : sd->npc_shopid;
+		if( npc_id == 0 || sd->state.using_fake_npc )
+			continue;
+		if( (nd = map->id2nd(npc_id)) == NULL || nd->path == NULL
+		 || (file = npc->src_file(nd->path)) == NULL || !file->reload )
+			continue;
+		sd->state.menu_or_input = 0;
+		sd->npc_menu = 0;
+		sd->npc_id = 0;
+		sd->npc_shopid = 0;
+		if( sd->st && sd->st->state != END )
+			sd->st->state = END;
+	}
+	mapit->free(iter);
+
+	// mobs first, script spawned ones are found through their event npc
+	npc->unload_mobs();
+	script->cache.env_hash = 0; // the item db may have been reloaded since
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		if( file->reload )
+			npc->unloadfile(file->name);
+	}
+
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		if( !file->reload )
+			continue;
+		ShowStatus("Reloading NPC file: %s"CL_CLL"\n", file->name);
+		npc->parsesrcfile(file->name, true);
+		file->reload = false;
+	}
+
+	npc->read_event_script();
+
+	return count;
+}
+
+/// Reloads a single npc source file (and the files duplicating its npcs)
+int npc_reloadfile(const char* filepath) {
+	struct npc_src_list* file = npc->src_file(filepath);
+
+	if( file == NULL )
+		return 0;
+	file->reload = true;
+	return npc->reload_files();
+}
+
+/// Reloads the npc source files modified since they were last parsed
+int npc_reload_changed(void) {
+	struct npc_src_list* file;
+	struct stat st;
+
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		if( stat(file->name, &st) == 0 && st.st_mtime != file->mtime )
+			file->reload = true;
+	}
+	return npc->reload_files();
+}
+
+/// Starts watching the directories of all npc source files (battle_config.npc_file_watch)
+void npc_watch_init(void) {
+#ifdef NPC_FILE_WATCH
+	struct npc_src_list* file;
+	char path[256];
+	char* p;
+	int watches = 0;
+
+	if( !battle_config.npc_file_watch || npc->watch_fd >= 0 )
+		return;
+
+	if( (npc->watch_fd = inotify_init()) < 0 ) {
+		ShowError("npc_watch_init: inotify_init failed - %s\n", strerror(errno));
+		return;
+	}
+	fcntl(npc->watch_fd, F_SETFL, fcntl(npc->watch_fd, F_GETFL) | O_NONBLOCK);
+
+	for( file = npc->src_files; file != NULL; file = file->next ) {
+		safestrncpy(path, file->name, sizeof(path));
+		if( (p = strrchr(path, '/')) != NULL )
+			*p = '\0';
+		else
+			safestrncpy(path, ".", sizeof(path));
+		// watching the same directory again returns the existing descriptor
+		if( inotify_add_watch(npc->watch_fd, path, IN_CLOSE_WRITE|IN_MOVED_TO) >= 0 )
+			watches++;
+	}
+
+	timer->add_interval(timer->gettick() + 1000, npc->watch_timer, 0, 0, 1000);
+	ShowStatus("Watching NPC files for changes ("CL_WHITE"%d"CL_RESET" directories).\n", watches);
+#else
+	if( battle_config.npc_file_watch )
+		ShowWarning("npc_watch_init: npc_file_watch is not supported on this platform.\n");
+#endif
+}
+
+/// Stops watching the npc source files
+void npc_watch_final(void) {
+#ifdef NPC_FILE_WATCH
+	if( npc->watch_fd >= 0 ) {
+		close(npc->watch_fd);
+		npc->watch_fd = -1;
+	}
+#endif
+}
+
+/// Drains pending file change notifications and reloads the modified npc files
+int npc_watch_timer(int tid, int64 tick, int id, intptr_t data) {
+#ifdef NPC_FILE_WATCH
+	char buf[4096];
+	bool changed = false;
+	int count;
+
+	if( npc->watch_fd < 0 )
+		return 0;
+	while( read(npc->watch_fd, buf, sizeof(buf)) > 0 )
+		changed = true;
+	if( changed && (count = npc->reload_changed()) > 0 )
+		ShowStatus("Reloaded '"CL_WHITE"%d"CL_RESET"' modified NPC files.\n", count);
+#endif
+	return 0;
+}
+
 void do_clear_npc(void) {
 	db_clear(npc->name_db);
 	db_clear(npc->ev_db);
@@ -3850,6 +4126,7 @@ int do_final_npc(void) {
 	db_destroy(npc->name_db);
 	npc->path_db->destroy(npc->path_db, npc->path_db_clear_sub);
 	ers_destroy(npc->timer_event_ers);
+	npc->watch_final();
 	npc->clearsrcfile();
 
 	return 0;
@@ -3938,6 +4215,7 @@ int do_init_npc(void)
 		"\t-'"CL_WHITE"%d"CL_RESET"' Mobs Cached\n"
 		"\t-'"CL_WHITE"%d"CL_RESET"' Mobs Not Cached\n",
 		npc_id - START_NPC_NUM, npc_warp, npc_shop, npc_script, npc_mob, npc_cache_mob, npc_delay_mob);
+	script->cache_report();
 
 	itemdb->name_constants();
 	
@@ -3955,6 +4233,7 @@ int do_init_npc(void)
 
 	timer->add_func_list(npc->event_do_clock,"npc_event_do_clock");
 	timer->add_func_list(npc->timerevent,"npc_timerevent");
+	timer->add_func_list(npc->watch_timer,"npc_watch_timer");
 
 	// Init dummy NPC
 	npc->fake_nd = (struct npc_data *)aCalloc(1,sizeof(struct npc_data));
@@ -3974,6 +4253,8 @@ int do_init_npc(void)
 	map->addiddb(&npc->fake_nd->bl);
 	// End of initialization
 
+	npc->watch_init();
+
 	return 0;
 }
 void npc_defaults(void) {
@@ -3987,6 +4268,7 @@ void npc_defaults(void) {
 	npc->timer_event_ers = NULL;
 	npc->fake_nd = NULL;
 	npc->src_files = NULL;
+	npc->watch_fd = -1;
 	/* */
 	npc->init = do_init_npc;
 	npc->final = do_final_npc;
@@ -4071,6 +4353,14 @@ void npc_defaults(void) {
 	npc->ev_label_db_clear_sub = npc_ev_label_db_clear_sub;
 	npc->reload = npc_reload;
 	npc->unloadfile = npc_unloadfile;
+	npc->src_file = npc_src_file;
+	npc->unload_mobs = npc_unload_mobs;
+	npc->reload_files = npc_reload_files;
+	npc->reloadfile = npc_reloadfile;
+	npc->reload_changed = npc_reload_changed;
+	npc->watch_init = npc_watch_init;
+	npc->watch_final = npc_watch_final;
+	npc->watch_timer = npc_watch_timer;
 	npc->do_clear_npc = do_clear_npc;
 	npc->debug_warps_sub = npc_debug_warps_sub;
 	npc->debug_warps = npc_debug_warps;
@@ -114,6 +114,9 @@ enum npce_event {
 // linked list of npc source files
 struct npc_src_list {
 	struct npc_src_list* next;
+	unsigned int id; // unique file id, referenced by the spawn data loaded from this file
+	time_t mtime; // modification time of the file when it was last parsed
+	bool reload; // flagged for the next npc->reload_files() call
 	char name[4]; // dynamic array, the structure is allocated with extra bytes (string length)
 };
 
@@ -139,6 +142,7 @@ struct npc_interface {
 	struct npc_data *fake_nd;
 	struct npc_src_list *src_files;
 	struct unit_data base_ud;
+	int watch_fd; // inotify descriptor watching the npc source directories, -1 when disabled
 	/* */
 	int (*init) (void);
 	int (*final) (void);
@@ -223,6 +227,14 @@ struct npc_interface {
 	int (*ev_label_db_clear_sub) (DBKey key, DBData *data, va_list args);
 	int (*reload) (void);
 	bool (*unloadfile) (const char *filepath);
+	struct npc_src_list* (*src_file) (const char *filepath);
+	void (*unload_mobs) (void);
+	int (*reload_files) (void);
+	int (*reloadfile) (const char *filepath);
+	int (*reload_changed) (void);
+	void (*watch_init) (void);
+	void (*watch_final) (void);
+	int (*watch_timer) (int tid, int64 tick, int id, intptr_t data);
 	void (*do_clear_npc) (void);
 	void (*debug_warps_sub) (struct npc_data *nd);
 	void (*debug_warps) (void);
@@ -48,10 +48,14 @@ enum packet_headers {
 #else
 	status_changeType = sc_notickType,/* 0x196 */
 #endif
+#if PACKETVER >= 20090121 // 0x43f is 8 bytes before
 	status_change2Type = 0x43f,
+#endif
 	status_change_endType = 0x196,
-#if PACKETVER < 20091103
+#if PACKETVER < 20080827 // 0x7c is 44 bytes after, its layout isn't known
 	spawn_unit2Type = 0x7c,
+#endif
+#if PACKETVER < 20091103
 	idle_unit2Type = 0x78,
 #endif
 #if PACKETVER < 4
@@ -183,6 +187,19 @@ enum packet_headers {
 #endif
 	monsterhpType = 0x977,
 	maptypeproperty2Type = 0x99b,
+#if PACKETVER < 20071113
+	damageType = 0x8a,
+#else
+	damageType = 0x2e1,
+#endif
+#if PACKETVER < 3
+	skill_damageType = 0x114,
+#else
+	skill_damageType = 0x1de,
+#endif
+	notify_moveType = 0x86,
+	notify_playermoveType = 0x87,
+	stopmoveType = 0x88,
 };
 
 #pragma pack(push, 1)
@@ -393,7 +410,7 @@ struct packet_spawn_unit {
 	short speed;
 	short bodyState;
 	short healthState;
-#if PACKETVER < 20080102
+#if PACKETVER < 7
 	short effectState;
 #else
 	int effectState;
@@ -446,7 +463,7 @@ struct packet_unit_walking {
 #if PACKETVER >= 20091103
 	short PacketLength;
 #endif
-#if PACKETVER > 20071106
+#if PACKETVER >= 20071106
 	unsigned char objecttype;
 #endif
 	unsigned int GID;
@@ -512,7 +529,7 @@ struct packet_idle_unit {
 	short speed;
 	short bodyState;
 	short healthState;
-#if PACKETVER < 20080102
+#if PACKETVER < 7
 	short effectState;
 #else
 	int effectState;
@@ -804,7 +821,86 @@ struct packet_viewequip_ack {
 	struct EQUIPITEM_INFO list[MAX_INVENTORY];
 } __attribute__((packed));
 
+/* ZC_NOTIFY_ACT / ZC_NOTIFY_ACT2 */
+struct packet_damage {
+	short PacketType;
+	unsigned int GID;
+	unsigned int targetGID;
+	unsigned int startTime;
+	int attackMT;
+	int attackedMT;
+#if PACKETVER < 20071113
+	short damage;
+#else
+	int damage;
+#endif
+	short count;
+	unsigned char action;
+#if PACKETVER < 20071113
+	short leftDamage;
+#else
+	int leftDamage;
+#endif
+} __attribute__((packed));
+
+/* ZC_NOTIFY_SKILL / ZC_NOTIFY_SKILL2 */
+struct packet_skill_damage {
+	short PacketType;
+	unsigned short SKID;
+	unsigned int AID;
+	unsigned int targetID;
+	unsigned int startTime;
+	int attackMT;
+	int attackedMT;
+#if PACKETVER < 3
+	short damage;
+#else
+	int damage;
+#endif
+	short level;
+	short count;
+	unsigned char action;
+} __attribute__((packed));
+
+/* ZC_NOTIFY_MOVE */
+struct packet_notify_move {
+	short PacketType;
+	unsigned int GID;
+	unsigned char MoveData[6];
+	unsigned int moveStartTime;
+} __attribute__((packed));
+
+/* ZC_NOTIFY_PLAYERMOVE */
+struct packet_notify_playermove {
+	short PacketType;
+	unsigned int moveStartTime;
+	unsigned char MoveData[6];
+} __attribute__((packed));
+
+/* ZC_STOPMOVE */
+struct packet_stopmove {
+	short PacketType;
+	unsigned int AID;
+	short xPos;
+	short yPos;
+} __attribute__((packed));
 
 #pragma pack(pop)
 
+/**
+ * Compile-time size checks of the fixed-size packets sent most often,
+ * a mismatch fails the build with a negative array size.
+ * test_packets checks all the structs against the lengths in packets.h.
+ **/
+#define packet_size_check(name, size) typedef char name##_size_check[ (sizeof(struct name) == (size)) ? 1 : -1 ]
+
+packet_size_check(packet_damage, PACKETVER < 20071113 ? 29 : 33);
+packet_size_check(packet_skill_damage, PACKETVER < 3 ? 31 : 33);
+packet_size_check(packet_notify_move, 16);
+packet_size_check(packet_notify_playermove, 12);
+packet_size_check(packet_stopmove, 10);
+packet_size_check(packet_status_change_end, 9);
+packet_size_check(packet_status_change2, 25);
+packet_size_check(packet_status_change, PACKETVER >= 20120618 ? 29 : PACKETVER >= 20090121 ? 25 : 9);
+
 #endif /* _PACKETS_STRUCT_H_ */
@@ -838,7 +838,8 @@ int party_send_xy_timer(int tid, int64 tick, int id, intptr_t data) {
 	// for each existing party,
 	for( p = dbi_first(iter); dbi_exists(iter); p = dbi_next(iter) )
 	{
-		int i;
+		struct map_session_data *movers[MAX_PARTY];
+		int i, count = 0;
 
 		if( !p->party.count )
 		{// no online party members so do not iterate
@@ -853,7 +854,7 @@ int party_send_xy_timer(int tid, int64 tick, int id, intptr_t data) {
 
 			if( p->data[i].x != sd->bl.x || p->data[i].y != sd->bl.y )
 			{// perform position update
-				clif->party_xy(sd);
+				movers[count++] = sd;
 				p->data[i].x = sd->bl.x;
 				p->data[i].y = sd->bl.y;
 			}
@@ -863,6 +864,8 @@ int party_send_xy_timer(int tid, int64 tick, int id, intptr_t data) {
 				p->data[i].hp = sd->battle_status.hp;
 			}
 		}
+		// one write per member for everyone who moved
+		clif->party_xy_list(p, movers, count);
 	}
 	dbi_destroy(iter);
 
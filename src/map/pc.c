@@ -1030,7 +1030,7 @@ bool pc_authok(struct map_session_data *sd, int login_id2, time_t expiration_tim
 		sd->state.showdelay = 1;
 
 	pc->setinventorydata(sd);
-	pc_setequipindex(sd);
+	pc->setequipindex(sd);
 
 	if( sd->status.option & OPTION_INVISIBLE && !pc->can_use_command(sd, "@hide") )
 		sd->status.option &=~ OPTION_INVISIBLE;
@@ -4741,17 +4741,18 @@ int pc_setpos(struct map_session_data* sd, unsigned short mapindex, int x, int y
 
 	nullpo_ret(sd);
 
-	if( !mapindex || !mapindex_id2name(mapindex) || ( m = map->mapindex2mapid(mapindex) ) == -1 ) {
+	if( !mapindex || !mapindex_id2name(mapindex) ) {
 		ShowDebug("pc_setpos: Passed mapindex(%d) is invalid!\n", mapindex);
 		return 1;
 	}
+	m = map->mapindex2mapid(mapindex);
 
 	if( pc_isdead(sd) ) { //Revive dead people before warping them
 		pc->setstand(sd);
 		pc->setrestartvalue(sd,1);
 	}
 
-	if( map->list[m].flag.src4instance ) {
+	if( m >= 0 && map->list[m].flag.src4instance ) {
 		struct party_data *p;
 		bool stop = false;
 		int i = 0, j = 0;
@@ -4818,12 +4819,12 @@ int pc_setpos(struct map_session_data* sd, unsigned short mapindex, int x, int y
 		for( i = 0; i < sd->queues_count; i++ ) {
 			struct hQueue *queue;
 			if( (queue = script->queue(sd->queues[i])) && queue->onMapChange[0] != '\0' ) {
-				pc->setregstr(sd, script->add_str("QMapChangeTo"), map->list[m].name);
+				pc->setregstr(sd, script->add_str("QMapChangeTo"), mapindex_id2name(mapindex));
 				npc->event(sd, queue->onMapChange, 0);
 			}
 		}
 		
-		if( map->list[m].cell == (struct mapcell *)0xdeadbeaf )
+		if( m >= 0 && map->list[m].cell == (struct mapcell *)0xdeadbeaf )
 			map->cellfromcache(&map->list[m]);
 		if (sd->sc.count) { // Cancel some map related stuff.
 			if (sd->sc.data[SC_JAILED])
@@ -4836,9 +4837,7 @@ int pc_setpos(struct map_session_data* sd, unsigned short mapindex, int x, int y
 			status_change_end(&sd->bl, SC_MIRACLE, INVALID_TIMER);
 			if (sd->sc.data[SC_KNOWLEDGE]) {
 				struct status_change_entry *sce = sd->sc.data[SC_KNOWLEDGE];
-				if (sce->timer != INVALID_TIMER)
-					timer->delete(sce->timer, status->change_timer);
-				sce->timer = timer->add(timer->gettick() + skill->get_time(SG_KNOWLEDGE, sce->val1), status->change_timer, sd->bl.id, SC_KNOWLEDGE);
+				sce->timer = status->sc_timer_add(&sd->bl, SC_KNOWLEDGE, timer->gettick() + skill->get_time(SG_KNOWLEDGE, sce->val1));
 			}
 			status_change_end(&sd->bl, SC_PROPERTYWALK, INVALID_TIMER);
 			status_change_end(&sd->bl, SC_CLOAKING, INVALID_TIMER);
@@ -4857,7 +4856,7 @@ int pc_setpos(struct map_session_data* sd, unsigned short mapindex, int x, int y
 		if (sd->regen.state.gc)
 			sd->regen.state.gc = 0;
 		// make sure vending is allowed here
-		if (sd->state.vending && map->list[m].flag.novending) {
+		if (sd->state.vending && m >= 0 && map->list[m].flag.novending) {
 			clif->message (sd->fd, msg_txt(276)); // "You can't open a shop on this map"
 			vending->close(sd);
 		}
@@ -4867,7 +4866,9 @@ int pc_setpos(struct map_session_data* sd, unsigned short mapindex, int x, int y
 		}
 	}
 
-	if( m < 0 ) {
+	// on another map-server, or moved to one; logins (!sd->mapindex) to a map on standby are
+	// placed on the local copy first and changed over once they're loaded (clif_parse_LoadEndAck)
+	if( m < 0 || (map->list[m].standby && sd->mapindex) ) {
 		uint32 ip;
 		uint16 port;
 		//if can't find any map-servers, just abort setting position.
@@ -9232,6 +9233,8 @@ int pc_setsavepoint(struct map_session_data *sd, short mapindex,int x,int y)
 
 /*==========================================
  * Save 1 player data at autosave intervall
+ * The timer only schedules the next call and defers the save
+ * to the server's idle time (called with INVALID_TIMER then).
  *------------------------------------------*/
 int pc_autosave(int tid, int64 tick, int id, intptr_t data) {
 	int interval;
@@ -9239,6 +9242,15 @@ int pc_autosave(int tid, int64 tick, int id, intptr_t data) {
 	struct map_session_data* sd;
 	static int last_save_id = 0, save_flag = 0;
 
+	if( tid != INVALID_TIMER ) {
+		interval = map->autosave_interval/(map->usercount()+1);
+		if(interval < map->minsave_interval)
+			interval = map->minsave_interval;
+		timer->add(timer->gettick()+interval,pc->autosave,0,0);
+		timer->defer(pc->autosave, 0, 0);
+		return 0;
+	}
+
 	if(save_flag == 2) //Someone was saved on last call, normal cycle
 		save_flag = 0;
 	else
@@ -9264,11 +9276,6 @@ int pc_autosave(int tid, int64 tick, int id, intptr_t data) {
 	}
 	mapit->free(iter);
 
-	interval = map->autosave_interval/(map->usercount()+1);
-	if(interval < map->minsave_interval)
-		interval = map->minsave_interval;
-	timer->add(timer->gettick()+interval,pc->autosave,0,0);
-
 	return 0;
 }
 
@@ -10256,6 +10263,7 @@ void pc_defaults(void) {
 	pc->isequip = pc_isequip;
 	pc->equippoint = pc_equippoint;
 	pc->setinventorydata = pc_setinventorydata;
+	pc->setequipindex = pc_setequipindex;
 	
 	pc->checkskill = pc_checkskill;
 	pc->checkskill2 = pc_checkskill2;
@@ -441,6 +441,8 @@ struct map_session_data {
 	int avail_quests;
 	int quest_index[MAX_QUEST_DB];
 	struct quest quest_log[MAX_QUEST_DB];
+	struct quest_objective_ref *quest_objectives; // Hunting objectives of the active quests, sorted by mob
+	int quest_objectives_count, quest_objectives_max;
 	bool save_quest;
 
 	// temporary debug [flaviojs]
@@ -511,6 +513,14 @@ struct map_session_data {
 
 	int *queues;
 	unsigned int queues_count;
+
+	/* interest management (battle_config.aoi_batch) */
+	struct {
+		int *known; // ids of the units the client was sent, sorted (only kept for battle_config.aoi_stats)
+		int known_count, known_max;
+		int *enter; // units that came into view this tick, spawned by clif->aoi_flush_timer
+		int enter_count, enter_max;
+	} aoi;
 	
 	/* Made Possible Thanks to Yommy~! */
 	unsigned int cryptKey;                                                 ///< Packet obfuscation key to be used for the next received packet
@@ -767,6 +777,7 @@ struct pc_interface {
 	int (*isequip) (struct map_session_data *sd,int n);
 	int (*equippoint) (struct map_session_data *sd,int n);
 	int (*setinventorydata) (struct map_session_data *sd);
+	int (*setequipindex) (struct map_session_data *sd);
 	
 	int (*checkskill) (struct map_session_data *sd,uint16 skill_id);
 	int (*checkskill2) (struct map_session_data *sd,uint16 index);
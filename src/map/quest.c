@@ -37,13 +37,58 @@ struct quest_interface quest_s;
 
 int quest_search_db(int quest_id)
 {
-	int i;
+	return (int)idb_iget(quest->db_index, quest_id) - 1;
+}
 
-	ARR_FIND(0, MAX_QUEST_DB,i,quest_id == quest->db[i].id);
-	if( i == MAX_QUEST_DB )
-		return -1;
+static int quest_objective_cmp(const void *a, const void *b)
+{
+	const struct quest_objective_ref *x = a, *y = b;
 
-	return i;
+	if( x->mob_id != y->mob_id )
+		return x->mob_id < y->mob_id ? -1 : 1;
+	if( x->slot != y->slot )
+		return x->slot - y->slot;
+	return x->objective - y->objective;
+}
+
+/**
+ * Rebuilds the mob -> objective index of the character's active quests,
+ * has to be called whenever quest_log changes.
+ */
+void quest_build_objectives(TBL_PC *sd)
+{
+	int i, j;
+
+	sd->quest_objectives_count = 0;
+	for( i = 0; i < sd->avail_quests; i++ ) {
+		const struct s_quest_db *qi;
+
+		if( sd->quest_log[i].state != Q_ACTIVE || sd->quest_index[i] < 0 )
+			continue;
+
+		qi = &quest->db[sd->quest_index[i]];
+		for( j = 0; j < qi->num_objectives; j++ ) {
+			struct quest_objective_ref *ref;
+
+			if( sd->quest_objectives_count == sd->quest_objectives_max ) {
+				sd->quest_objectives_max += 8;
+				RECREATE(sd->quest_objectives, struct quest_objective_ref, sd->quest_objectives_max);
+			}
+			ref = &sd->quest_objectives[sd->quest_objectives_count++];
+			ref->mob_id = qi->mob[j];
+			ref->slot = (short)i;
+			ref->objective = (short)j;
+		}
+	}
+
+	if( sd->quest_objectives_count > 1 )
+		qsort(sd->quest_objectives, sd->quest_objectives_count, sizeof(struct quest_objective_ref), quest_objective_cmp);
+}
+
+int quest_build_objectives_sub(struct map_session_data *sd, va_list ap)
+{
+	quest->build_objectives(sd);
+	return 0;
 }
 
 //Send quest info on login
@@ -51,6 +96,8 @@ int quest_pc_login(TBL_PC * sd)
 {
 	int i;
 
+	quest->build_objectives(sd);
+
 	if(sd->avail_quests == 0)
 		return 1;
 
@@ -100,6 +147,7 @@ int quest_add(TBL_PC * sd, int quest_id)
 	sd->num_quests++;
 	sd->avail_quests++;
 	sd->save_quest = true;
+	quest->build_objectives(sd);
 
 	clif->quest_add(sd, &sd->quest_log[i], sd->quest_index[i]);
 	clif->quest_update_objective(sd, &sd->quest_log[i], sd->quest_index[i]);
@@ -147,6 +195,7 @@ int quest_change(TBL_PC * sd, int qid1, int qid2)
 
 	sd->quest_index[i] = j;
 	sd->save_quest = true;
+	quest->build_objectives(sd);
 
 	clif->quest_delete(sd, qid1);
 	clif->quest_add(sd, &sd->quest_log[i], sd->quest_index[i]);
@@ -180,6 +229,7 @@ int quest_delete(TBL_PC * sd, int quest_id)
 	memset(&sd->quest_log[sd->num_quests], 0, sizeof(struct quest));
 	sd->quest_index[sd->num_quests] = 0;
 	sd->save_quest = true;
+	quest->build_objectives(sd);
 
 	clif->quest_delete(sd, quest_id);
 
@@ -199,7 +249,7 @@ int quest_update_objective_sub(struct block_list *bl, va_list ap) {
 	party_id = va_arg(ap,int);
 	mob_id = va_arg(ap,int);
 
-	if( !sd->avail_quests )
+	if( !sd->quest_objectives_count )
 		return 0;
 	if( sd->status.party_id != party_id )
 		return 0;
@@ -211,18 +261,25 @@ int quest_update_objective_sub(struct block_list *bl, va_list ap) {
 
 
 void quest_update_objective(TBL_PC * sd, int mob_id) {
-	int i,j;
+	int lo = 0, hi = sd->quest_objectives_count;
+
+	// first objective on this mob
+	while( lo < hi ) {
+		int mid = (lo + hi) / 2;
+		if( sd->quest_objectives[mid].mob_id < mob_id )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-	for( i = 0; i < sd->avail_quests; i++ ) {
-		if( sd->quest_log[i].state != Q_ACTIVE )
-			continue;
+	for( ; lo < sd->quest_objectives_count && sd->quest_objectives[lo].mob_id == mob_id; lo++ ) {
+		int i = sd->quest_objectives[lo].slot, j = sd->quest_objectives[lo].objective;
 
-		for( j = 0; j < MAX_QUEST_OBJECTIVES; j++ )
-			if( quest->db[sd->quest_index[i]].mob[j] == mob_id && sd->quest_log[i].count[j] < quest->db[sd->quest_index[i]].count[j] )  {
-				sd->quest_log[i].count[j]++;
-				sd->save_quest = true;
-				clif->quest_update_objective(sd,&sd->quest_log[i],sd->quest_index[i]);
-			}
+		if( sd->quest_log[i].count[j] < quest->db[sd->quest_index[i]].count[j] ) {
+			sd->quest_log[i].count[j]++;
+			sd->save_quest = true;
+			clif->quest_update_objective(sd,&sd->quest_log[i],sd->quest_index[i]);
+		}
 	}
 }
 
@@ -240,16 +297,22 @@ int quest_update_status(TBL_PC * sd, int quest_id, quest_state qs) {
 	sd->save_quest = true;
 
 	if( qs < Q_COMPLETE ) {
+		quest->build_objectives(sd);
 		clif->quest_update_status(sd, quest_id, (bool)qs);
 		return 0;
 	}
 
 	if( i != (--sd->avail_quests) ) {
 		struct quest tmp_quest;
+		int tmp_index;
 		memcpy(&tmp_quest, &sd->quest_log[i],sizeof(struct quest));
 		memcpy(&sd->quest_log[i], &sd->quest_log[sd->avail_quests],sizeof(struct quest));
 		memcpy(&sd->quest_log[sd->avail_quests], &tmp_quest,sizeof(struct quest));
+		tmp_index = sd->quest_index[i];
+		sd->quest_index[i] = sd->quest_index[sd->avail_quests];
+		sd->quest_index[sd->avail_quests] = tmp_index;
 	}
+	quest->build_objectives(sd);
 
 	clif->quest_delete(sd, quest_id);
 
@@ -344,6 +407,9 @@ int quest_read_db(void) {
 		
 		quest->db[k].num_objectives = i;
 
+		if( !idb_iget(quest->db_index, quest->db[k].id) )
+			idb_iput(quest->db_index, quest->db[k].id, k + 1);
+
 		k++;
 	}
 	fclose(fp);
@@ -352,20 +418,29 @@ int quest_read_db(void) {
 }
 
 void do_init_quest(void) {
+	quest->db_index = idb_alloc(DB_OPT_BASE);
 	quest->read_db();
 }
 
+void do_final_quest(void) {
+	db_destroy(quest->db_index);
+}
+
 void do_reload_quest(void) {
 	memset(&quest->db, 0, sizeof(quest->db));
+	db_clear(quest->db_index);
 	quest->read_db();
+	map->foreachpc(quest->build_objectives_sub);
 }
 
 void quest_defaults(void) {
 	quest = &quest_s;
 	
 	memset(&quest->db, 0, sizeof(quest->db));
+	quest->db_index = NULL;
 	/* */
 	quest->init = do_init_quest;
+	quest->final = do_final_quest;
 	quest->reload = do_reload_quest;
 	/* */
 	quest->search_db = quest_search_db;
@@ -377,5 +452,7 @@ void quest_defaults(void) {
 	quest->update_objective = quest_update_objective;
 	quest->update_status = quest_update_status;
 	quest->check = quest_check;
+	quest->build_objectives = quest_build_objectives;
+	quest->build_objectives_sub = quest_build_objectives_sub;
 	quest->read_db = quest_read_db;
 }
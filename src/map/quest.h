@@ -14,12 +14,21 @@ struct s_quest_db {
 	//char name[NAME_LENGTH];
 };
 
+/// One hunting objective of an active quest, see quest->build_objectives.
+struct quest_objective_ref {
+	int mob_id;
+	short slot; // Index in quest_log
+	short objective;
+};
+
 typedef enum quest_check_type { HAVEQUEST, PLAYTIME, HUNTING } quest_check_type;
 
 struct quest_interface {
 	struct s_quest_db db[MAX_QUEST_DB];
+	DBMap *db_index; // quest_id -> index in db + 1
 	/* */
 	void (*init) (void);
+	void (*final) (void);
 	void (*reload) (void);
 	/* */
 	int (*search_db) (int quest_id);
@@ -31,6 +40,8 @@ struct quest_interface {
 	void (*update_objective) (TBL_PC *sd, int mob_id);
 	int (*update_status) (TBL_PC *sd, int quest_id, quest_state qs);
 	int (*check) (TBL_PC *sd, int quest_id, quest_check_type type);
+	void (*build_objectives) (TBL_PC *sd);
+	int (*build_objectives_sub) (struct map_session_data *sd, va_list ap);
 	int (*read_db) (void);
 };
 
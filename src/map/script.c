@@ -11,6 +11,7 @@
 #include "../common/socket.h"	// usage: getcharip
 #include "../common/strlib.h"
 #include "../common/timer.h"
+#include "../common/profiler.h"
 #include "../common/utils.h"
 
 #include "map.h"
@@ -53,6 +54,7 @@
 #ifndef WIN32
 	#include <sys/time.h>
 #endif
+#include <sys/stat.h>
 #include <time.h>
 
 static inline int GETVALUE(const unsigned char* buf, int i) {
@@ -1959,6 +1961,9 @@ struct script_code* parse_script(const char *src,const char *file,int line,int o
 	if( src == NULL )
 		return NULL;// empty script
 
+	if( script->cache.active && (code = script->cache_load(src, options)) != NULL )
+		return code;
+
 	memset(&script->syntax,0,sizeof(script->syntax));
 
 	script->buf=(unsigned char *)aMalloc(SCRIPT_BLOCK_SIZE*sizeof(unsigned char));
@@ -2129,9 +2134,544 @@ struct script_code* parse_script(const char *src,const char *file,int line,int o
 	code->script_buf  = script->buf;
 	code->script_size = script->size;
 	code->script_vars = NULL;
+
+	if( script->cache.active )
+		script->cache_store(src, options, code);
+	return code;
+}
+
+/*==========================================
+ * NPC script bytecode cache
+ *------------------------------------------*/
+
+/// Appends raw data to the entries being written to the cache file.
+static void script_cache_out(const void *data, int len) {
+	struct script_cache_data *cache = &script->cache;
+
+	if( cache->out_len + len > cache->out_size ) {
+		cache->out_size = cache->out_len + len + 65536;
+		RECREATE(cache->out, unsigned char, cache->out_size);
+	}
+	memcpy(cache->out + cache->out_len, data, len);
+	cache->out_len += len;
+}
+
+static void script_cache_out_int(int32 value) {
+	script_cache_out(&value, sizeof(value));
+}
+
+/// Reads an integer from a cache entry, flags *pos as -1 when out of bounds.
+static int32 script_cache_in_int(const unsigned char *buf, int len, int *pos) {
+	int32 value;
+
+	if( *pos < 0 || *pos + (int)sizeof(value) > len ) {
+		*pos = -1;
+		return 0;
+	}
+	memcpy(&value, buf + *pos, sizeof(value));
+	*pos += sizeof(value);
+	return value;
+}
+
+/// Returns the str_data id of an entry name, adding it if necessary.
+static int script_cache_in_name(const unsigned char *buf, int len, int *pos) {
+	uint16 name_len;
+
+	if( *pos < 0 || *pos + (int)sizeof(name_len) > len ) {
+		*pos = -1;
+		return -1;
+	}
+	memcpy(&name_len, buf + *pos, sizeof(name_len));
+	*pos += sizeof(name_len);
+	if( name_len == 0 || *pos + name_len > len ) {
+		*pos = -1;
+		return -1;
+	}
+	if( name_len+1 > script->word_size )
+		RECREATE(script->word_buf, char, (script->word_size = (name_len+1)));
+	memcpy(script->word_buf, buf + *pos, name_len);
+	script->word_buf[name_len] = '\0';
+	*pos += name_len;
+
+	return script->add_str(script->word_buf);
+}
+
+/// Hash of everything compiled bytecode depends on besides its own source:
+/// buildin function ids, parameter ids and constant values (which are inlined).
+/// Item name constants are only in str_data after the boot parse (itemdb->name_constants),
+/// so they are hashed from the item db instead, the same way at boot and on reload.
+uint32 script_cache_env_hash(void) {
+	uint32 hash = 2166136261U, items = 0;
+	DBIterator *iter;
+	struct item_data *item;
+	int i;
+
+	if( script->cache.env_hash )
+		return script->cache.env_hash;
+
+#define SCRIPT_CACHE_HASH(h,v) ( (h) = ((h) ^ (uint32)(v)) * 16777619U )
+	SCRIPT_CACHE_HASH(hash, SCRIPT_CACHE_VERSION);
+	for( i = LABEL_START; i < script->str_num; i++ ) {
+		const char *p, *name = script->get_str(i);
+
+		if( script->str_data[i].type != C_INT && script->str_data[i].type != C_PARAM && script->str_data[i].type != C_FUNC )
+			continue;
+		if( script->str_data[i].type == C_INT && (item = itemdb->exists(script->str_data[i].val)) != NULL && strcasecmp(item->name, name) == 0 )
+			continue; // item name constant, see below
+		SCRIPT_CACHE_HASH(hash, script->str_data[i].type);
+		SCRIPT_CACHE_HASH(hash, script->str_data[i].val);
+		for( p = name; *p; p++ )
+			SCRIPT_CACHE_HASH(hash, TOLOWER(*p));
+	}
+
+	// summed, the db's iteration order doesn't matter
+	iter = db_iterator(itemdb->names);
+	for( item = dbi_first(iter); dbi_exists(iter); item = dbi_next(iter) ) {
+		uint32 h = 2166136261U;
+		const char *p;
+
+		SCRIPT_CACHE_HASH(h, item->nameid);
+		for( p = item->name; *p; p++ )
+			SCRIPT_CACHE_HASH(h, TOLOWER(*p));
+		items += h;
+	}
+	dbi_destroy(iter);
+	SCRIPT_CACHE_HASH(hash, items);
+#undef SCRIPT_CACHE_HASH
+
+	if( hash == 0 )
+		hash = 1;
+	return script->cache.env_hash = hash;
+}
+
+/// Opens the cache for a npc source file.
+/// Scripts parsed until script->cache_end are looked up in/stored to it.
+void script_cache_begin(const char *filepath, const char *buffer, size_t len) {
+	struct script_cache_data *cache = &script->cache;
+	struct stat st;
+	FILE *fp;
+	char *p;
+	uint32 version = 0, src_len = 0, env_hash = 0;
+	int64 recompile_time = 0, mtime = 0;
+	unsigned char md5[16];
+	long start, end;
+
+	cache->active = false;
+	if( !script->config.npc_script_cache || !HCache->enabled || stat(filepath, &st) != 0 )
+		return;
+
+	if( filepath[0] == '.' && (filepath[1] == '/' || filepath[1] == '\\') )
+		filepath += 2;
+	// all cache files live directly in cache/npc/
+	if( snprintf(cache->name, sizeof(cache->name), "npc/%s.bin", filepath) >= (int)sizeof(cache->name) )
+		return;
+	for( p = cache->name + 4; *p; p++ ) {
+		if( *p == '/' || *p == '\\' )
+			*p = '.';
+	}
+
+	cache->active = true;
+	cache->dirty = false;
+	cache->src = buffer;
+	cache->src_len = (uint32)len;
+	cache->src_mtime = (int64)st.st_mtime;
+	MD5_Binary(buffer, cache->src_md5);
+	cache->in = NULL;
+	cache->in_len = cache->in_pos = 0;
+	cache->out_len = 0;
+	cache->tick = timer->gettick_nocache();
+	cache->scripts_loaded_file = cache->scripts_loaded;
+	cache->scripts_parsed_file = cache->scripts_parsed;
+
+	if( !(fp = HCache->open(cache->name, "rb")) )
+		return;
+
+	if( hread(&version, sizeof(version), 1, fp) != 1 || version != SCRIPT_CACHE_VERSION
+	 || hread(&recompile_time, sizeof(recompile_time), 1, fp) != 1 || recompile_time != (int64)HCache->recompile_time
+	 || hread(&mtime, sizeof(mtime), 1, fp) != 1 || mtime != cache->src_mtime
+	 || hread(&src_len, sizeof(src_len), 1, fp) != 1 || src_len != cache->src_len
+	 || hread(md5, sizeof(md5), 1, fp) != 1 || memcmp(md5, cache->src_md5, sizeof(md5)) != 0
+	 || hread(&env_hash, sizeof(env_hash), 1, fp) != 1 || env_hash != script->cache_env_hash()
+	) {// outdated
+		fclose(fp);
+		return;
+	}
+
+	start = ftell(fp);
+	fseek(fp, 0, SEEK_END);
+	end = ftell(fp);
+	fseek(fp, start, SEEK_SET);
+	if( end > start ) {
+		cache->in_len = (int)(end - start);
+		cache->in = (unsigned char *)aMalloc(cache->in_len);
+		if( hread(cache->in, cache->in_len, 1, fp) != 1 ) {
+			aFree(cache->in);
+			cache->in = NULL;
+			cache->in_len = 0;
+		}
+	}
+	fclose(fp);
+}
+
+/// Closes the cache of the current npc source file, rewriting it if anything had to be parsed.
+void script_cache_end(void) {
+	struct script_cache_data *cache = &script->cache;
+	int64 elapsed;
+
+	if( !cache->active )
+		return;
+	cache->active = false;
+
+	elapsed = DIFF_TICK(timer->gettick_nocache(), cache->tick);
+	if( cache->scripts_parsed != cache->scripts_parsed_file ) {
+		cache->files_parsed++;
+		cache->parse_time += elapsed;
+	} else if( cache->scripts_loaded != cache->scripts_loaded_file ) {
+		cache->files_loaded++;
+		cache->load_time += elapsed;
+	}
+
+	if( cache->dirty ) {
+		FILE *fp;
+
+		if( (fp = HCache->open(cache->name, "wb")) ) {
+			uint32 version = SCRIPT_CACHE_VERSION, env_hash = script->cache_env_hash();
+			int64 recompile_time = (int64)HCache->recompile_time;
+
+			hwrite(&version, sizeof(version), 1, fp);
+			hwrite(&recompile_time, sizeof(recompile_time), 1, fp);
+			hwrite(&cache->src_mtime, sizeof(cache->src_mtime), 1, fp);
+			hwrite(&cache->src_len, sizeof(cache->src_len), 1, fp);
+			hwrite(cache->src_md5, sizeof(cache->src_md5), 1, fp);
+			hwrite(&env_hash, sizeof(env_hash), 1, fp);
+			if( cache->out_len )
+				hwrite(cache->out, cache->out_len, 1, fp);
+			fclose(fp);
+		}
+	}
+
+	if( cache->in )
+		aFree(cache->in);
+	cache->in = NULL;
+	cache->in_len = cache->in_pos = 0;
+	cache->out_len = 0;
+	cache->src = NULL;
+}
+
+/// Builds a script from a cache entry, relocating its name references into str_data.
+/// Returns NULL if the entry doesn't match or is malformed.
+static struct script_code* script_cache_relocate(const unsigned char *entry, int len, int options) {
+	struct script_code *code;
+	unsigned char *buf;
+	int *ids;
+	int pos = 2*sizeof(int32), size, name_count, count, i;
+
+	if( script_cache_in_int(entry, len, &pos) != options )
+		return NULL;
+	size = script_cache_in_int(entry, len, &pos);
+	if( pos < 0 || size <= 0 || pos + size > len )
+		return NULL;
+	buf = (unsigned char *)aMalloc(size);
+	memcpy(buf, entry + pos, size);
+	pos += size;
+
+	// name table
+	name_count = script_cache_in_int(entry, len, &pos);
+	if( pos < 0 || name_count < 0 || name_count > len ) {
+		aFree(buf);
+		return NULL;
+	}
+	CREATE(ids, int, name_count+1);
+	for( i = 0; i < name_count && pos >= 0; i++ )
+		ids[i] = script_cache_in_name(entry, len, &pos);
+
+	// name references (C_NAME)
+	count = script_cache_in_int(entry, len, &pos);
+	for( i = 0; i < count && pos >= 0; i++ ) {
+		int at = script_cache_in_int(entry, len, &pos);
+		int name = script_cache_in_int(entry, len, &pos);
+		int id;
+
+		if( pos < 0 || at < 0 || at + 3 > size || name < 0 || name >= name_count ) {
+			pos = -1;
+			break;
+		}
+		id = ids[name];
+		SETVALUE(buf, at, id);
+		switch( script->str_data[id].type ) {
+			case C_NOP: case C_NAME: case C_POS: case C_USERFUNC: case C_USERFUNC_POS:
+				// same as the default for unknown references in parse_script
+				script->str_data[id].type = C_NAME;
+				script->str_data[id].label = id;
+				script->str_data[id].backpatch = -1;
+				break;
+			default:
+				break;
+		}
+	}
+
+	// labels and local functions, as left behind by set_label
+	count = script_cache_in_int(entry, len, &pos);
+	for( i = 0; i < count && pos >= 0; i++ ) {
+		int name = script_cache_in_int(entry, len, &pos);
+		int type = script_cache_in_int(entry, len, &pos);
+		int label = script_cache_in_int(entry, len, &pos);
+
+		if( pos < 0 || name < 0 || name >= name_count || (type != C_POS && type != C_USERFUNC_POS) || label < 0 || label >= size ) {
+			pos = -1;
+			break;
+		}
+		script->str_data[ids[name]].type = type;
+		script->str_data[ids[name]].label = label;
+		script->str_data[ids[name]].backpatch = -1;
+	}
+
+	// label db
+	count = script_cache_in_int(entry, len, &pos);
+	if( options&SCRIPT_USE_LABEL_DB )
+		script->label_count = 0;
+	for( i = 0; i < count && pos >= 0; i++ ) {
+		int name = script_cache_in_int(entry, len, &pos);
+		int label = script_cache_in_int(entry, len, &pos);
+
+		if( pos < 0 || name < 0 || name >= name_count || label < 0 || label >= size ) {
+			pos = -1;
+			break;
+		}
+		if( options&SCRIPT_USE_LABEL_DB )
+			script->label_add(ids[name], label);
+	}
+
+	aFree(ids);
+	if( pos < 0 ) {
+		aFree(buf);
+		if( options&SCRIPT_USE_LABEL_DB )
+			script->label_count = 0;
+		return NULL;
+	}
+
+	script->parse_options = options;
+	CREATE(code,struct script_code,1);
+	code->script_buf  = buf;
+	code->script_size = size;
+	code->script_vars = NULL;
 	return code;
 }
 
+/// Looks up the script starting at src in the cache of the current npc source file.
+struct script_code* script_cache_load(const char *src, int options) {
+	struct script_cache_data *cache = &script->cache;
+	int32 offset;
+
+	if( !cache->active || src < cache->src || src >= cache->src + cache->src_len )
+		return NULL;
+	offset = (int32)(src - cache->src);
+
+	// entries are sorted by offset, the ones skipped belong to scripts that weren't loaded this time
+	while( cache->in != NULL && cache->in_pos < cache->in_len ) {
+		const unsigned char *entry = cache->in + cache->in_pos;
+		int pos = 0;
+		int32 entry_len = script_cache_in_int(entry, cache->in_len - cache->in_pos, &pos);
+		int32 entry_offset = script_cache_in_int(entry, cache->in_len - cache->in_pos, &pos);
+		struct script_code *code;
+
+		if( pos < 0 || entry_len < pos || entry_len > cache->in_len - cache->in_pos ) {// corrupted
+			aFree(cache->in);
+			cache->in = NULL;
+			break;
+		}
+		if( entry_offset < offset ) {
+			cache->in_pos += entry_len;
+			continue;
+		}
+		if( entry_offset > offset )
+			break;
+
+		cache->in_pos += entry_len;
+		if( (code = script_cache_relocate(entry, entry_len, options)) == NULL )
+			break;
+		script_cache_out(entry, entry_len);
+		cache->scripts_loaded++;
+		return code;
+	}
+
+	return NULL;
+}
+
+/// Appends a freshly parsed script to the cache of the current npc source file.
+/// Must be called right after parse_script, while str_data still holds its labels.
+void script_cache_store(const char *src, int options, struct script_code *code) {
+	struct script_cache_data *cache = &script->cache;
+	int *names = NULL, *refs = NULL;
+	int name_count = 0, ref_count = 0, ref_size = 0, sym_count = 0;
+	int start, pos, i;
+
+	if( !cache->active || code == NULL || src < cache->src || src >= cache->src + cache->src_len )
+		return;
+
+	cache->scripts_parsed++;
+	cache->dirty = true;
+
+	if( cache->name_map_size < script->str_num ) {
+		RECREATE(cache->name_map, int, script->str_num);
+		for( i = cache->name_map_size; i < script->str_num; i++ )
+			cache->name_map[i] = -1;
+		cache->name_map_size = script->str_num;
+	}
+	CREATE(names, int, script->str_num);
+
+#define script_cache_name(id) ( cache->name_map[(id)] < 0 ? ( names[name_count] = (id), cache->name_map[(id)] = name_count++ ) : cache->name_map[(id)] )
+	// collect name references
+	for( pos = 0; pos < code->script_size; ) {
+		switch( script->get_com(code->script_buf, &pos) ) {
+			case C_INT:
+				script->get_num(code->script_buf, &pos);
+				break;
+			case C_POS:
+			case C_USERFUNC_POS:
+				pos += 3;
+				break;
+			case C_NAME:
+				i = GETVALUE(code->script_buf, pos);
+				if( i < LABEL_START || i >= script->str_num ) {// unresolved name, don't cache
+					ref_count = -1;
+					pos = code->script_size;
+					break;
+				}
+				if( ref_count + 2 > ref_size ) {
+					ref_size += 256;
+					RECREATE(refs, int, ref_size);
+				}
+				refs[ref_count++] = pos;
+				refs[ref_count++] = script_cache_name(i);
+				pos += 3;
+				break;
+			case C_STR:
+				while( code->script_buf[pos++] );
+				break;
+			default:
+				break;
+		}
+	}
+
+	if( ref_count >= 0 ) {
+		start = cache->out_len;
+		script_cache_out_int(0); // entry length, set below
+		script_cache_out_int((int32)(src - cache->src));
+		script_cache_out_int(options);
+		script_cache_out_int(code->script_size);
+		script_cache_out(code->script_buf, code->script_size);
+
+		// labels and local functions
+		for( i = LABEL_START; i < script->str_num; i++ ) {
+			if( script->str_data[i].type == C_POS || script->str_data[i].type == C_USERFUNC_POS ) {
+				script_cache_name(i);
+				sym_count++;
+			}
+		}
+		if( options&SCRIPT_USE_LABEL_DB ) {
+			for( i = 0; i < script->label_count; i++ )
+				script_cache_name(script->labels[i].key);
+		}
+
+		script_cache_out_int(name_count);
+		for( i = 0; i < name_count; i++ ) {
+			const char *name = script->get_str(names[i]);
+			uint16 len = (uint16)strlen(name);
+
+			script_cache_out(&len, sizeof(len));
+			script_cache_out(name, len);
+		}
+
+		script_cache_out_int(ref_count/2);
+		script_cache_out(refs, ref_count*sizeof(int32));
+
+		script_cache_out_int(sym_count);
+		for( i = LABEL_START; i < script->str_num; i++ ) {
+			if( script->str_data[i].type == C_POS || script->str_data[i].type == C_USERFUNC_POS ) {
+				script_cache_out_int(cache->name_map[i]);
+				script_cache_out_int(script->str_data[i].type);
+				script_cache_out_int(script->str_data[i].label);
+			}
+		}
+
+		if( options&SCRIPT_USE_LABEL_DB ) {
+			script_cache_out_int(script->label_count);
+			for( i = 0; i < script->label_count; i++ ) {
+				script_cache_out_int(cache->name_map[script->labels[i].key]);
+				script_cache_out_int(script->labels[i].pos);
+			}
+		} else
+			script_cache_out_int(0);
+
+		i = cache->out_len - start;
+		memcpy(cache->out + start, &i, sizeof(int32));
+	}
+#undef script_cache_name
+
+	for( i = 0; i < name_count; i++ )
+		cache->name_map[names[i]] = -1;
+	aFree(names);
+	if( refs )
+		aFree(refs);
+}
+
+/// Shows how the npc scripts were loaded since the last report.
+void script_cache_report(void) {
+	struct script_cache_data *cache = &script->cache;
+
+	if( cache->files_loaded || cache->files_parsed )
+		ShowInfo("Script cache: '"CL_WHITE"%u"CL_RESET"' files ('"CL_WHITE"%u"CL_RESET"' scripts) loaded in '"CL_WHITE"%"PRId64""CL_RESET"' ms, '"CL_WHITE"%u"CL_RESET"' files ('"CL_WHITE"%u"CL_RESET"' scripts) parsed in '"CL_WHITE"%"PRId64""CL_RESET"' ms.\n",
+			cache->files_loaded, cache->scripts_loaded, cache->load_time, cache->files_parsed, cache->scripts_parsed, cache->parse_time);
+
+	cache->files_loaded = cache->files_parsed = 0;
+	cache->scripts_loaded = cache->scripts_parsed = 0;
+	cache->load_time = cache->parse_time = 0;
+}
+
+/// Checks whether a script reads no variables and calls no functions but the
+/// given ones, so that running it always does the same for the same player state.
+/// used[i] is set if funcs[i] is called anywhere in the script.
+bool script_code_only_calls(struct script_code *code, const char **funcs, int count, bool *used) {
+	int pos, id, i;
+
+	memset(used, 0, count*sizeof(used[0]));
+	if( code == NULL )
+		return false;
+
+	for( pos = 0; pos < code->script_size; ) {
+		switch( script->get_com(code->script_buf, &pos) ) {
+			case C_INT:
+				script->get_num(code->script_buf, &pos);
+				break;
+			case C_POS:
+			case C_USERFUNC_POS:
+				pos += 3;
+				break;
+			case C_NAME:
+				id = GETVALUE(code->script_buf, pos);
+				pos += 3;
+				if( id < 0 || id >= script->str_num )
+					return false;
+				if( script->str_data[id].type == C_INT )
+					break;// constant
+				if( script->str_data[id].type != C_FUNC )
+					return false;// variable, parameter or user function
+				ARR_FIND(0, count, i, strcmp(script->get_str(id), funcs[i]) == 0);
+				if( i == count )
+					return false;
+				used[i] = true;
+				break;
+			case C_STR:
+				while( code->script_buf[pos++] );
+				break;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
 /// Returns the player attached to this script, identified by the rid.
 /// If there is no player attached, the script is terminated.
 TBL_PC *script_rid2sd(struct script_state *st) {
@@ -3280,6 +3820,8 @@ void run_script_main(struct script_state *st) {
 	TBL_PC *sd;
 	struct script_stack *stack = st->stack;
 	struct npc_data *nd;
+	int64 zone = profiler->begin();
+	int oid = st->oid; // st may be freed below
 
 	script->attach_state(st);
 
@@ -3421,6 +3963,8 @@ void run_script_main(struct script_state *st) {
 		script->free_state(st);
 		st = NULL;
 	}
+
+	profiler->end(PROFILER_SCRIPT, oid, zone);
 }
 
 int script_config_read(char *cfgName) {
@@ -3458,6 +4002,9 @@ int script_config_read(char *cfgName) {
 		else if(strcmpi(w1,"warn_func_mismatch_argtypes")==0) {
 			script->config.warn_func_mismatch_argtypes = config_switch(w2);
 		}
+		else if(strcmpi(w1,"npc_script_cache")==0) {
+			script->config.npc_script_cache = config_switch(w2);
+		}
 		else if(strcmpi(w1,"import")==0){
 			script->config_read(w2);
 		}
@@ -3690,7 +4237,22 @@ void do_final_script(void) {
 	
 	if( script->labels != NULL )
 		aFree(script->labels);
+	if( script->cache.out != NULL )
+		aFree(script->cache.out);
+	if( script->cache.name_map != NULL )
+		aFree(script->cache.name_map);
+}
+/// Names the profiler's script zones after the NPC running the script.
+static const char* script_profiler_name(uintptr_t key, char *buf, size_t size) {
+	struct npc_data *nd = map->id2nd((int)key);
+
+	if( nd )
+		safestrncpy(buf, nd->exname, size);
+	else
+		snprintf(buf, size, "script (object %d)", (int)key);
+	return buf;
 }
+
 /*==========================================
  * Initialization
  *------------------------------------------*/
@@ -3708,6 +4270,8 @@ void do_init_script(void) {
 	script->parse_builtin();
 	script->read_constdb();
 	mapreg->init();
+
+	profiler->set_namer(PROFILER_SCRIPT, script_profiler_name);
 }
 
 int script_reload(void) {
@@ -3725,6 +4289,7 @@ int script_reload(void) {
 	
 	script->userfunc_db->clear(script->userfunc_db, script->db_free_code_sub);
 	script->label_count = 0;
+	script->cache.env_hash = 0; // constants may change with the reload
 
 	for( i = 0; i < atcommand->binding_count; i++ ) {
 		aFree(atcommand->binding[i]);
@@ -7365,8 +7930,11 @@ BUILDIN(bonus)
 			break;
 		default:
 			ShowDebug("buildin_bonus: unexpected number of arguments (%d)\n", (script_lastdata(st) - 1));
-			break;
+			return true;
 	}
+
+	if( status->item_bonus.recording ) // see status->item_script
+		status->item_bonus_record(script_lastdata(st)-2, type, val1, val2, val3, val4, val5);
 	
 	return true;
 }
@@ -9501,11 +10069,11 @@ BUILDIN(getstatus)
 		case 4:  script_pushint(st, sd->sc.data[id]->val4);	break;
 		case 5:
 		{
-			struct TimerData* td = (struct TimerData*)timer->get(sd->sc.data[id]->timer);
+			int64 sc_tick = status->sc_timer_gettick(&sd->bl, (sc_type)id);
 			
-			if( td ) {
+			if( sc_tick ) {
 				// return the amount of time remaining
-				script_pushint(st, (int)(td->tick - timer->gettick())); // TODO: change this to int64 when we'll support 64 bit script values
+				script_pushint(st, (int)(sc_tick - timer->gettick())); // TODO: change this to int64 when we'll support 64 bit script values
 			}
 		}
 			break;
@@ -18268,6 +18836,7 @@ void script_defaults(void) {
 	
 	memcpy(script->equip, &equip, sizeof(script->equip));
 	
+	memset(&script->cache, 0, sizeof(script->cache));
 	memset(&script->config, 0, sizeof(script->config));
 	
 	script->autobonus_db = NULL;
@@ -18401,9 +18970,18 @@ void script_defaults(void) {
 	script->cleanfloor_sub = script_cleanfloor_sub;
 	script->run_func = run_func;
 	
+	script->cache_begin = script_cache_begin;
+	script->cache_end = script_cache_end;
+	script->cache_load = script_cache_load;
+	script->cache_store = script_cache_store;
+	script->cache_env_hash = script_cache_env_hash;
+	script->cache_report = script_cache_report;
+	script->code_only_calls = script_code_only_calls;
+	
 	/* script_config base */
 	script->config.warn_func_mismatch_argtypes = 1;
 	script->config.warn_func_mismatch_paramnum = 1;
+	script->config.npc_script_cache = 1;
 	script->config.check_cmdcount = 65535;
 	script->config.check_gotocount = 2048;
 	script->config.input_min_value = 0;
@@ -298,6 +298,7 @@ enum {
 struct Script_Config {
 	unsigned warn_func_mismatch_argtypes : 1;
 	unsigned warn_func_mismatch_paramnum : 1;
+	unsigned npc_script_cache : 1;
 	int check_cmdcount;
 	int check_gotocount;
 	int input_min_value;
@@ -421,6 +422,39 @@ struct script_label_entry {
 	int key,pos;
 };
 
+/**
+ * NPC script bytecode cache
+ * Compiled scripts of a source file are stored in cache/npc/ alongside the
+ * names they reference, so unchanged files are relocated instead of parsed.
+ **/
+#define SCRIPT_CACHE_VERSION 1
+
+struct script_cache_data {
+	bool active; // a source file is being cached
+	bool dirty; // new code was compiled, cache file has to be rewritten
+	char name[256]; // cache file name (relative to ./cache/)
+	const char *src; // source buffer, entries are keyed by their offset in it
+	uint32 src_len;
+	int64 src_mtime;
+	unsigned char src_md5[16];
+	/* entries read from the cache file */
+	unsigned char *in;
+	int in_len, in_pos;
+	/* entries to be written to the cache file */
+	unsigned char *out;
+	int out_len, out_size;
+	/* str_data id -> entry name index, used while storing an entry */
+	int *name_map;
+	int name_map_size;
+	uint32 env_hash; // hash of buildins/constants the bytecode depends on (0 = not calculated)
+	int64 tick;
+	unsigned int scripts_loaded_file, scripts_parsed_file; // script counters when the file was opened
+	/* stats, reset by script->cache_report */
+	unsigned int files_loaded, files_parsed;
+	unsigned int scripts_loaded, scripts_parsed;
+	int64 load_time, parse_time;
+};
+
 struct script_syntax_data {
 	struct {
 		enum curly_type type;
@@ -470,6 +504,8 @@ struct script_interface {
 	int label_count;
 	int labels_size;
 	/* */
+	struct script_cache_data cache;
+	/* */
 	struct Script_Config config;
 	/* */
 	/// temporary buffer for passing around compiled bytecode
@@ -630,6 +666,14 @@ struct script_interface {
 	int (*buildin_mobuseskill_sub) (struct block_list *bl, va_list ap);
 	int (*cleanfloor_sub) (struct block_list *bl, va_list ap);
 	int (*run_func) (struct script_state *st);
+	/* npc script cache */
+	void (*cache_begin) (const char *filepath, const char *buffer, size_t len);
+	void (*cache_end) (void);
+	struct script_code* (*cache_load) (const char *src, int options);
+	void (*cache_store) (const char *src, int options, struct script_code *code);
+	uint32 (*cache_env_hash) (void);
+	void (*cache_report) (void);
+	bool (*code_only_calls) (struct script_code *code, const char **funcs, int count, bool *used);
 };
 
 struct script_interface *script;
@@ -144,20 +144,27 @@ void searchstore_query(struct map_session_data* sd, unsigned char type, unsigned
 	s.card_count = card_count;
 	s.min_price  = min_price;
 	s.max_price  = max_price;
-	iter         = db_iterator(vending->db);
 
-	for( pl_sd = dbi_first(iter); dbi_exists(iter);  pl_sd = dbi_next(iter) ) {
-		if( sd == pl_sd ) {// skip own shop, if any
-			continue;
+	if( type == SEARCHTYPE_VENDING ) {// market index, cheapest first
+		if( !vending->index_search(&s) ) {// exceeded result size
+			clif->search_store_info_failed(sd, SSI_FAILED_OVER_MAXCOUNT);
 		}
+	} else {
+		iter = db_iterator(vending->db);
 
-		if( !store_searchall(pl_sd, &s) ) {// exceeded result size
-			clif->search_store_info_failed(sd, SSI_FAILED_OVER_MAXCOUNT);
-			break;
+		for( pl_sd = dbi_first(iter); dbi_exists(iter);  pl_sd = dbi_next(iter) ) {
+			if( sd == pl_sd ) {// skip own shop, if any
+				continue;
+			}
+
+			if( !store_searchall(pl_sd, &s) ) {// exceeded result size
+				clif->search_store_info_failed(sd, SSI_FAILED_OVER_MAXCOUNT);
+				break;
+			}
 		}
-	}
 
-	dbi_destroy(iter);
+		dbi_destroy(iter);
+	}
 
 	if( sd->searchstore.count ) {
 		// reclaim unused memory
@@ -2286,9 +2286,7 @@ int skill_attack(int attack_type, struct block_list* src, struct block_list *dsr
 				if (pc->famerank(sd->status.char_id,MAPID_TAEKWON)) {//Extend combo time.
 					sce->val1 = skill_id; //Update combo-skill
 					sce->val3 = skill_id;
-					if( sce->timer != INVALID_TIMER )
-						timer->delete(sce->timer, status->change_timer);
-					sce->timer = timer->add(tick+sce->val4, status->change_timer, src->id, SC_COMBOATTACK);
+					sce->timer = status->sc_timer_add(src, SC_COMBOATTACK, tick+sce->val4);
 					break;
 				}
 				unit->cancel_combo(src); // Cancel combo wait
@@ -4781,8 +4779,8 @@ int skill_castend_id(int tid, int64 tick, int id, intptr_t data) {
 			case CR_GRANDCROSS:
 			case NPC_GRANDDARKNESS:
 				if( (sc = status->get_sc(src)) && sc->data[SC_NOEQUIPSHIELD] ) {
-					const struct TimerData *td = timer->get(sc->data[SC_NOEQUIPSHIELD]->timer);
-					if( td && td->func == status->change_timer && DIFF_TICK(td->tick,timer->gettick()+skill->get_time(ud->skill_id, ud->skill_lv)) > 0 )
+					int64 sc_tick = status->sc_timer_gettick(src, SC_NOEQUIPSHIELD);
+					if( sc_tick && DIFF_TICK(sc_tick,timer->gettick()+skill->get_time(ud->skill_id, ud->skill_lv)) > 0 )
 						break;
 				}
 				sc_start2(src, SC_NOEQUIPSHIELD, 100, 0, 1, skill->get_time(ud->skill_id, ud->skill_lv));
@@ -6619,6 +6617,7 @@ int skill_castend_nodamage_id(struct block_list *src, struct block_list *bl, uin
 				}
 				if(status->isimmune(bl) || !tsc || !tsc->count)
 					break;
+				status->calc_batch_begin();
 				for(i = 0; i < SC_MAX; i++) {
 					if ( !tsc->data[i] )
 							continue;
@@ -6652,6 +6651,7 @@ int skill_castend_nodamage_id(struct block_list *src, struct block_list *bl, uin
 					}
 					status_change_end(bl, (sc_type)i, INVALID_TIMER);
 				}
+				status->calc_batch_end();
 				break;
 			}
 			//Affect all targets on splash area.
@@ -8025,6 +8025,7 @@ int skill_castend_nodamage_id(struct block_list *src, struct block_list *bl, uin
 				}
 				if(status->isimmune(bl) || !tsc || !tsc->count)
 					break;
+				status->calc_batch_begin();
 				for(i = 0; i < SC_MAX; i++) {
 					if ( !tsc->data[i] )
 						continue;
@@ -8043,6 +8044,7 @@ int skill_castend_nodamage_id(struct block_list *src, struct block_list *bl, uin
 					}
 					status_change_end(bl,(sc_type)i,INVALID_TIMER);
 				}
+				status->calc_batch_end();
 				break;
 			}
 			map->foreachinrange(skill->area_sub, bl, i, BL_CHAR, src, skill_id, skill_lv, tick, flag|1, skill->castend_damage_id);
@@ -10996,9 +10998,9 @@ int skill_unit_onplace(struct skill_unit *src, struct block_list *bl, int64 tick
 			} else if( sc && battle->check_target(&sg->unit->bl,bl,sg->target_flag) > 0 ) {
 				int sec = skill->get_time2(sg->skill_id,sg->skill_lv);
 				if( status->change_start(bl,type,10000,sg->skill_lv,1,sg->group_id,0,sec,8) ) {
-					const struct TimerData* td = sc->data[type]?timer->get(sc->data[type]->timer):NULL;
-					if( td )
-						sec = DIFF_TICK32(td->tick, tick);
+					int64 sc_tick = sc->data[type] ? status->sc_timer_gettick(bl, type) : 0;
+					if( sc_tick )
+						sec = DIFF_TICK32(sc_tick, tick);
 					map->moveblock(bl, src->bl.x, src->bl.y, tick);
 					clif->fixpos(bl);
 					sg->val2 = bl->id;
@@ -11108,8 +11110,7 @@ int skill_unit_onplace(struct skill_unit *src, struct block_list *bl, int64 tick
 			else if (sce->val4 == 1) {
 				//Readjust timers since the effect will not last long.
 				sce->val4 = 0;
-				timer->delete(sce->timer, status->change_timer);
-				sce->timer = timer->add(tick+sg->limit, status->change_timer, bl->id, type);
+				sce->timer = status->sc_timer_add(bl, type, tick+sg->limit);
 			}
 			break;
 
@@ -11365,9 +11366,9 @@ int skill_unit_onplace_timer(struct skill_unit *src, struct block_list *bl, int6
 			if( sg->val2 == 0 && tsc && (sg->unit_id == UNT_ANKLESNARE || bl->id != sg->src_id) ) {
 				int sec = skill->get_time2(sg->skill_id,sg->skill_lv);
 				if( status->change_start(bl,type,10000,sg->skill_lv,sg->group_id,0,0,sec, 8) ) {
-					const struct TimerData* td = tsc->data[type]?timer->get(tsc->data[type]->timer):NULL;
-					if( td )
-						sec = DIFF_TICK32(td->tick, tick);
+					int64 sc_tick = tsc->data[type] ? status->sc_timer_gettick(bl, type) : 0;
+					if( sc_tick )
+						sec = DIFF_TICK32(sc_tick, tick);
 					if( sg->unit_id == UNT_MANHOLE || battle_config.skill_trap_type || !map_flag_gvg2(src->bl.m) ) {
 						unit->movepos(bl, src->bl.x, src->bl.y, 0, 0);
 						clif->fixpos(bl);
@@ -11700,9 +11701,9 @@ int skill_unit_onplace_timer(struct skill_unit *src, struct block_list *bl, int6
 				if( !sg->val2 ) {
 					int sec = skill->get_time2(sg->skill_id, sg->skill_lv);
 					if( sc_start(bl, type, 100, sg->skill_lv, sec) ) {
-						const struct TimerData* td = tsc->data[type]?timer->get(tsc->data[type]->timer):NULL;
-						if( td )
-							sec = DIFF_TICK32(td->tick, tick);
+						int64 sc_tick = tsc->data[type] ? status->sc_timer_gettick(bl, type) : 0;
+						if( sc_tick )
+							sec = DIFF_TICK32(sc_tick, tick);
 						///map->moveblock(bl, src->bl.x, src->bl.y, tick); // in official server it doesn't behave like this. [malufett]
 						clif->fixpos(bl);
 						sg->val2 = bl->id;
@@ -11998,11 +11999,10 @@ int skill_unit_onleft(uint16 skill_id, struct block_list *bl, int64 tick) {
 		case DC_FORTUNEKISS:
 		case DC_SERVICEFORYOU:
 			if (sce) {
-				timer->delete(sce->timer, status->change_timer);
 				//NOTE: It'd be nice if we could get the skill_lv for a more accurate extra time, but alas...
 				//not possible on our current implementation.
 				sce->val4 = 1; //Store the fact that this is a "reduced" duration effect.
-				sce->timer = timer->add(tick+skill->get_time2(skill_id,1), status->change_timer, bl->id, type);
+				sce->timer = status->sc_timer_add(bl, type, tick+skill->get_time2(skill_id,1));
 			}
 			break;
 		case PF_FOGWALL:
@@ -12012,8 +12012,7 @@ int skill_unit_onleft(uint16 skill_id, struct block_list *bl, int64 tick) {
 					if (bl->type == BL_PC) //Players get blind ended inmediately, others have it still for 30 secs. [Skotlex]
 						status_change_end(bl, SC_BLIND, INVALID_TIMER);
 					else {
-						timer->delete(sce->timer, status->change_timer);
-						sce->timer = timer->add(30000+tick, status->change_timer, bl->id, SC_BLIND);
+						sce->timer = status->sc_timer_add(bl, SC_BLIND, 30000+tick);
 					}
 				}
 			}
@@ -15727,10 +15726,13 @@ int skill_unit_timer_sub(DBKey key, DBData *data, va_list ap) {
 	dissonance = skill->dance_switch(su, 0);
 
 	if( su->range >= 0 && group->interval != -1 ) {
-		if( battle_config.skill_wall_check )
-			map->foreachinshootrange(skill->unit_timer_sub_onplace, bl, su->range, group->bl_flag, bl,tick);
-		else
-			map->foreachinrange(skill->unit_timer_sub_onplace, bl, su->range, group->bl_flag, bl,tick);
+		// most units sit in empty areas, only scan when a character is in the blocks around
+		if( (group->bl_flag&~BL_CHAR) || map->chars_inarea(bl->m, bl->x - su->range, bl->y - su->range, bl->x + su->range, bl->y + su->range) ) {
+			if( battle_config.skill_wall_check )
+				map->foreachinshootrange(skill->unit_timer_sub_onplace, bl, su->range, group->bl_flag, bl,tick);
+			else
+				map->foreachinrange(skill->unit_timer_sub_onplace, bl, su->range, group->bl_flag, bl,tick);
+		}
 
 		if(su->range == -1) //Unit disabled, but it should not be deleted yet.
 			group->unit_id = UNT_USED_TRAPS;
@@ -2293,6 +2293,123 @@ unsigned int status_base_pc_maxsp(struct map_session_data* sd, struct status_dat
 	return (unsigned int)cap_value(val,0,UINT_MAX);
 }
 
+/*==========================================
+ * Item bonus cache
+ *------------------------------------------*/
+#define STATUS_BONUS_CHUNK_SIZE (64*1024)
+
+/// Allocates memory from the item bonus arena, released by status->item_bonus_clear.
+void* status_item_bonus_alloc(size_t size) {
+	struct status_bonus_chunk *chunk = status->item_bonus.chunks;
+	void *ptr;
+
+	size = (size + 7) & ~(size_t)7;
+	if( chunk == NULL || chunk->used + size > chunk->size ) {
+		size_t chunk_size = max(size, STATUS_BONUS_CHUNK_SIZE);
+		chunk = (struct status_bonus_chunk *)aMalloc(sizeof(struct status_bonus_chunk) + chunk_size);
+		chunk->used = 0;
+		chunk->size = chunk_size;
+		chunk->next = status->item_bonus.chunks;
+		status->item_bonus.chunks = chunk;
+	}
+	ptr = (char *)(chunk + 1) + chunk->used;
+	chunk->used += size;
+	return ptr;
+}
+
+/// Releases all recorded bonus vectors. Item data referencing them must be gone (item db reload).
+void status_item_bonus_clear(void) {
+	struct status_bonus_chunk *chunk = status->item_bonus.chunks;
+
+	while( chunk != NULL ) {
+		struct status_bonus_chunk *next = chunk->next;
+		aFree(chunk);
+		chunk = next;
+	}
+	status->item_bonus.chunks = NULL;
+}
+
+/// Records a bonus command issued by the item script being run by status->item_script.
+void status_item_bonus_record(int argc, int type, int val1, int val2, int val3, int val4, int val5) {
+	struct status_item_bonus *b;
+
+	if( status->item_bonus.rec_count == status->item_bonus.rec_max ) {
+		status->item_bonus.rec_max += 16;
+		RECREATE(status->item_bonus.rec, struct status_item_bonus, status->item_bonus.rec_max);
+	}
+	b = &status->item_bonus.rec[status->item_bonus.rec_count++];
+	b->argc = argc;
+	b->type = type;
+	b->val[0] = val1;
+	b->val[1] = val2;
+	b->val[2] = val3;
+	b->val[3] = val4;
+	b->val[4] = val5;
+}
+
+/// Applies the bonus script of an equipped item or card during status_calc_pc_.
+/// Scripts made of bonus commands only are run once per refine level with their
+/// bonuses recorded, afterwards the recorded bonuses are applied directly.
+void status_item_script(struct map_session_data *sd, struct item_data *data) {
+	static const char *bonus_funcs[] = { "getrefine", "bonus", "bonus2", "bonus3", "bonus4", "bonus5", "jump_zero", "goto" };
+	struct status_item_bonus_vec *vec;
+	int refine = -1, i;
+
+	if( data->script == NULL )
+		return;
+
+	if( data->bonus_state == ITEM_BONUS_UNKNOWN ) {
+		bool used[ARRAYLENGTH(bonus_funcs)];
+		if( !script->code_only_calls(data->script, bonus_funcs, ARRAYLENGTH(bonus_funcs), used) )
+			data->bonus_state = ITEM_BONUS_NOCACHE;
+		else
+			data->bonus_state = used[0] ? ITEM_BONUS_CACHE_REFINE : ITEM_BONUS_CACHE;
+	}
+
+	if( !battle_config.item_bonus_cache || data->bonus_state == ITEM_BONUS_NOCACHE || status->item_bonus.recording ) {
+		script->run(data->script,0,sd->bl.id,0);
+		return;
+	}
+
+	if( data->bonus_state == ITEM_BONUS_CACHE_REFINE ) {
+		// same as buildin_getrefine
+		int index = status->current_equip_item_index;
+		refine = ( index >= 0 && index < MAX_INVENTORY ) ? sd->status.inventory[index].refine : 0;
+	}
+
+	for( vec = data->bonus_vec; vec != NULL; vec = vec->next ) {
+		if( vec->refine == refine )
+			break;
+	}
+
+	if( vec == NULL ) {// first run at this refine level, record it
+		status->item_bonus.rec_count = 0;
+		status->item_bonus.recording = true;
+		script->run(data->script,0,sd->bl.id,0);
+		status->item_bonus.recording = false;
+
+		vec = (struct status_item_bonus_vec *)status->item_bonus_alloc(sizeof(struct status_item_bonus_vec) + max(status->item_bonus.rec_count-1,0)*sizeof(struct status_item_bonus));
+		vec->refine = refine;
+		vec->count = status->item_bonus.rec_count;
+		if( vec->count )
+			memcpy(vec->bonus, status->item_bonus.rec, vec->count*sizeof(struct status_item_bonus));
+		vec->next = data->bonus_vec;
+		data->bonus_vec = vec;
+		return;
+	}
+
+	for( i = 0; i < vec->count; i++ ) {
+		const struct status_item_bonus *b = &vec->bonus[i];
+		switch( b->argc ) {
+			case 1: pc->bonus(sd, b->type, b->val[0]); break;
+			case 2: pc->bonus2(sd, b->type, b->val[0], b->val[1]); break;
+			case 3: pc->bonus3(sd, b->type, b->val[0], b->val[1], b->val[2]); break;
+			case 4: pc->bonus4(sd, b->type, b->val[0], b->val[1], b->val[2], b->val[3]); break;
+			case 5: pc->bonus5(sd, b->type, b->val[0], b->val[1], b->val[2], b->val[3], b->val[4]); break;
+		}
+	}
+}
+
 //Calculates player data from scratch without counting SC adjustments.
 //Should be invoked whenever players raise stats, learn passive skills or change equipment.
 int status_calc_pc_(struct map_session_data* sd, bool first) {
@@ -2519,10 +2636,10 @@ int status_calc_pc_(struct map_session_data* sd, bool first) {
 			if(sd->inventory_data[index]->script) {
 				if (wd == &sd->left_weapon) {
 					sd->state.lr_flag = 1;
-					script->run(sd->inventory_data[index]->script,0,sd->bl.id,0);
+					status->item_script(sd, sd->inventory_data[index]);
 					sd->state.lr_flag = 0;
 				} else
-					script->run(sd->inventory_data[index]->script,0,sd->bl.id,0);
+					status->item_script(sd, sd->inventory_data[index]);
 				if (!calculating) //Abort, script->run retriggered this. [Skotlex]
 					return 1;
 			}
@@ -2545,7 +2662,7 @@ int status_calc_pc_(struct map_session_data* sd, bool first) {
 			if(sd->inventory_data[index]->script) {
 				if( i == EQI_HAND_L ) //Shield
 					sd->state.lr_flag = 3;
-				script->run(sd->inventory_data[index]->script,0,sd->bl.id,0);
+				status->item_script(sd, sd->inventory_data[index]);
 				if( i == EQI_HAND_L ) //Shield
 					sd->state.lr_flag = 0;
 				if (!calculating) //Abort, script->run retriggered this. [Skotlex]
@@ -2560,7 +2677,7 @@ int status_calc_pc_(struct map_session_data* sd, bool first) {
 			sd->bonus.arrow_atk += sd->inventory_data[index]->atk;
 			sd->state.lr_flag = 2;
 			if( !itemdb_is_GNthrowable(sd->inventory_data[index]->nameid) ) //don't run scripts on throwable items
-				script->run(sd->inventory_data[index]->script,0,sd->bl.id,0);
+				status->item_script(sd, sd->inventory_data[index]);
 			sd->state.lr_flag = 0;
 			if (!calculating) //Abort, script->run retriggered status_calc_pc. [Skotlex]
 				return 1;
@@ -2630,10 +2747,10 @@ int status_calc_pc_(struct map_session_data* sd, bool first) {
 
 				if(i == EQI_HAND_L && sd->status.inventory[index].equip == EQP_HAND_L) { //Left hand status.
 					sd->state.lr_flag = 1;
-					script->run(data->script,0,sd->bl.id,0);
+					status->item_script(sd, data);
 					sd->state.lr_flag = 0;
 				} else
-					script->run(data->script,0,sd->bl.id,0);
+					status->item_script(sd, data);
 				if (!calculating) //Abort, script->run his function. [Skotlex]
 					return 1;
 			}
@@ -3854,6 +3971,64 @@ void status_calc_bl_main(struct block_list *bl, /*enum scb_flag*/int flag) {
 	if(flag&SCB_REGEN && bl->type&BL_REGEN)
 		status->calc_regen_rate(bl, status->get_regen_data(bl), sc);
 }
+
+/// Starts deferring status recalculations, so that the status changes started
+/// or ended until the matching status->calc_batch_end cause a single
+/// recalculation per object. Batches can be nested.
+void status_calc_batch_begin(void) {
+	status->calc.depth++;
+}
+
+/// Ends a batch started by status->calc_batch_begin, running the deferred
+/// recalculations once the outermost batch ends.
+void status_calc_batch_end(void) {
+	int i;
+
+	if( status->calc.depth <= 0 || --status->calc.depth > 0 )
+		return;
+
+	// recalculations can start new batches, the pending list may grow meanwhile
+	for( i = 0; i < status->calc.pending_count; i++ ) {
+		struct block_list *bl = map->id2bl(status->calc.pending[i]);
+		struct status_change *sc;
+		int flag;
+
+		if( bl == NULL || (sc = status->get_sc(bl)) == NULL || !sc->pending_calc )
+			continue;// gone meanwhile
+		flag = sc->pending_calc;
+		sc->pending_calc = 0;
+		status->calc.trigger = sc->pending_trigger; // counted under what queued it
+		status_calc_bl(bl, flag);
+	}
+	status->calc.pending_count = 0;
+}
+
+/// Reports the status recalculations per second (battle_config.status_calc_stats)
+int status_calc_stats_timer(int tid, int64 tick, int id, intptr_t data) {
+	int64 diff = DIFF_TICK(tick, status->calc.report_tick);
+	double secs;
+
+	if( !battle_config.status_calc_stats || diff < (int64)battle_config.status_calc_stats*1000 ) {
+		if( !battle_config.status_calc_stats ) {
+			memset(status->calc.count, 0, sizeof(status->calc.count));
+			status->calc.coalesced = 0;
+			status->calc.report_tick = tick;
+		}
+		return 0;
+	}
+
+	secs = diff / 1000.;
+	ShowInfo("Status recalculations/s: '"CL_WHITE"%.1f"CL_RESET"' base, '"CL_WHITE"%.1f"CL_RESET"' sc start, '"CL_WHITE"%.1f"CL_RESET"' sc end, '"CL_WHITE"%.1f"CL_RESET"' sc timer, '"CL_WHITE"%.1f"CL_RESET"' other ('"CL_WHITE"%.1f"CL_RESET"' coalesced).\n",
+		status->calc.count[STATUS_CALC_BASE]/secs, status->calc.count[STATUS_CALC_SC_START]/secs,
+		status->calc.count[STATUS_CALC_SC_END]/secs, status->calc.count[STATUS_CALC_SC_TIMER]/secs,
+		status->calc.count[STATUS_CALC_OTHER]/secs, status->calc.coalesced/secs);
+
+	memset(status->calc.count, 0, sizeof(status->calc.count));
+	status->calc.coalesced = 0;
+	status->calc.report_tick = tick;
+	return 0;
+}
+
 /// Recalculates parts of an object's base status and battle status according to the specified flags.
 /// Also sends updates to the client wherever applicable.
 /// @param flag bitfield of values from enum scb_flag
@@ -3861,11 +4036,32 @@ void status_calc_bl_main(struct block_list *bl, /*enum scb_flag*/int flag) {
 void status_calc_bl_(struct block_list *bl, enum scb_flag flag, bool first) {
 	struct status_data bst; // previous battle status
 	struct status_data *st; // pointer to current battle status
+	struct status_change *sc;
 
 	if( bl->type == BL_PC && ((TBL_PC*)bl)->delayed_damage != 0 ) {
 		((TBL_PC*)bl)->state.hold_recalc = 1;
+		status->calc.trigger = STATUS_CALC_OTHER;
+		return;
+	}
+
+	if( !first && status->calc.depth > 0 && (sc = status->get_sc(bl)) != NULL ) {
+		// inside a batch, merge with the object's other pending recalculations
+		if( sc->pending_calc == 0 ) {
+			if( status->calc.pending_count == status->calc.pending_max ) {
+				status->calc.pending_max += 32;
+				RECREATE(status->calc.pending, int, status->calc.pending_max);
+			}
+			status->calc.pending[status->calc.pending_count++] = bl->id;
+			sc->pending_trigger = (flag&SCB_BASE) ? STATUS_CALC_BASE : status->calc.trigger;
+		} else
+			status->calc.coalesced++;
+		sc->pending_calc |= flag;
+		status->calc.trigger = STATUS_CALC_OTHER;
 		return;
 	}
+
+	status->calc.count[(flag&SCB_BASE) ? STATUS_CALC_BASE : status->calc.trigger]++;
+	status->calc.trigger = STATUS_CALC_OTHER;
 	
 	// remember previous values
 	st = status->get_status_data(bl);
@@ -6110,6 +6306,7 @@ void status_set_viewdata(struct block_list *bl, int class_)
 		}
 		break;
 	}
+	clif->look_changed(bl);
 }
 
 /// Returns the status_change data of bl or NULL if it doesn't exist.
@@ -6458,6 +6655,18 @@ void status_display_remove(struct map_session_data *sd, enum sc_type type) {
 		}
 	}
 }
+/// Starts a status change, see status_change_start_sub.
+/// The statuses it ends or starts on the way are recalculated along with it,
+/// in a single recalculation.
+int status_change_start(struct block_list* bl,enum sc_type type,int rate,int val1,int val2,int val3,int val4,int tick,int flag) {
+	int ret;
+
+	status->calc_batch_begin();
+	ret = status->change_start_sub(bl, type, rate, val1, val2, val3, val4, tick, flag);
+	status->calc_batch_end();
+	return ret;
+}
+
 /*==========================================
 * Starts a status change.
 * 'type' = type, 'val1~4' depend on the type.
@@ -6469,7 +6678,7 @@ void status_display_remove(struct map_session_data *sd, enum sc_type type) {
 * &4: sc_data loaded, no value has to be altered.
 * &8: rate should not be reduced
 *------------------------------------------*/
-int status_change_start(struct block_list* bl,enum sc_type type,int rate,int val1,int val2,int val3,int val4,int tick,int flag) {
+int status_change_start_sub(struct block_list* bl,enum sc_type type,int rate,int val1,int val2,int val3,int val4,int tick,int flag) {
 	struct map_session_data *sd = NULL;
 	struct status_change* sc;
 	struct status_change_entry* sce;
@@ -7767,8 +7976,7 @@ int status_change_start(struct block_list* bl,enum sc_type type,int rate,int val
 						sc_start4(src,SC_RG_CCONFINE_M,100,val1,1,0,0,tick+1000);
 					else { //Increase count of locked enemies and refresh time.
 						(sce2->val2)++;
-						timer->delete(sce2->timer, status->change_timer);
-						sce2->timer = timer->add(timer->gettick()+tick+1000, status->change_timer, src->id, SC_RG_CCONFINE_M);
+						sce2->timer = status->sc_timer_add(src, SC_RG_CCONFINE_M, timer->gettick()+tick+1000);
 					}
 				} else //Status failed.
 					return 0;
@@ -9081,7 +9289,7 @@ int status_change_start(struct block_list* bl,enum sc_type type,int rate,int val
 	//Don't trust the previous sce assignment, in case the SC ended somewhere between there and here.
 	if((sce=sc->data[type])) {// reuse old sc
 		if( sce->timer != INVALID_TIMER )
-			timer->delete(sce->timer, status->change_timer);
+			status->sc_timer_delete(bl, type);
 	} else {// new sc
 		++(sc->count);
 		sce = sc->data[type] = ers_alloc(status->data_ers, struct status_change_entry);
@@ -9091,12 +9299,22 @@ int status_change_start(struct block_list* bl,enum sc_type type,int rate,int val
 	sce->val3 = val3;
 	sce->val4 = val4;
 	if (tick >= 0)
-		sce->timer = timer->add(timer->gettick() + tick, status->change_timer, bl->id, type);
+		sce->timer = status->sc_timer_add(bl, type, timer->gettick() + tick);
 	else
 		sce->timer = INVALID_TIMER; //Infinite duration
 
-	if (calc_flag)
+	if (sc->pending_calc) { // statuses ended or started above
+		calc_flag |= sc->pending_calc;
+		sc->pending_calc = 0;
+		status->calc.coalesced++;
+	}
+	if (calc_flag) {
+		int depth = status->calc.depth;
+		status->calc.depth = 0; // not deferred, the code below uses the new values
+		status->calc.trigger = STATUS_CALC_SC_START;
 		status_calc_bl(bl,calc_flag);
+		status->calc.depth = depth;
+	}
 
 	if(sd && sd->pd)
 		pet->sc_check(sd, type); //Skotlex: Pet Status Effect Healing
@@ -9203,6 +9421,7 @@ int status_change_clear(struct block_list* bl, int type) {
 	if (!sc || !sc->count)
 		return 0;
 
+	status->calc_batch_begin(); // one recalculation for all the ended statuses
 	for(i = 0; i < SC_MAX; i++) {
 		if(!sc->data[i])
 			continue;
@@ -9236,11 +9455,12 @@ int status_change_clear(struct block_list* bl, int type) {
 			//If for some reason status_change_end decides to still keep the status when quitting. [Skotlex]
 			(sc->count)--;
 			if (sc->data[i]->timer != INVALID_TIMER)
-				timer->delete(sc->data[i]->timer, status->change_timer);
+				status->sc_timer_delete(bl, (sc_type)i);
 			ers_free(status->data_ers, sc->data[i]);
 			sc->data[i] = NULL;
 		}
 	}
+	status->calc_batch_end();
 
 	sc->opt1 = 0;
 	sc->opt2 = 0;
@@ -9285,7 +9505,7 @@ int status_change_end_(struct block_list* bl, enum sc_type type, int tid, const
 			//Do not end infinite endure.
 				return 0;
 		if (sce->timer != INVALID_TIMER) //Could be a SC with infinite duration
-			timer->delete(sce->timer,status->change_timer);
+			status->sc_timer_delete(bl, type);
 		if (sc->opt1)
 			switch (type) {
 				//"Ugly workaround"  [Skotlex]
@@ -9301,7 +9521,7 @@ int status_change_end_(struct block_list* bl, enum sc_type type, int tid, const
 					//since these SC are not affected by it, and it lets us know
 					//if we have already delayed this attack or not.
 					sce->val1 = 0;
-					sce->timer = timer->add(timer->gettick()+10, status->change_timer, bl->id, type);
+					sce->timer = status->sc_timer_add(bl, type, timer->gettick()+10);
 					return 1;
 				}
 		}
@@ -9942,8 +10162,10 @@ int status_change_end_(struct block_list* bl, enum sc_type type, int tid, const
 		}
 	}
 
-	if (calc_flag)
+	if (calc_flag) {
+		status->calc.trigger = STATUS_CALC_SC_END;
 		status_calc_bl(bl,calc_flag);
+	}
 
 	if(opt_flag&4) //Out of hiding, invoke on place.
 		skill->unit_move(bl,timer->gettick(),1);
@@ -9989,6 +10211,118 @@ int kaahi_heal_timer(int tid, int64 tick, int id, intptr_t data) {
 	return 1;
 }
 
+/*==========================================
+* Status change timers
+* Each object owns a single timer for all of its status changes, serviced by
+* status->sc_timer, which keeps the pending status change ticks sorted and
+* runs status->change_timer for the due ones.
+*------------------------------------------*/
+
+/// Points the object's timer at its earliest pending status change tick.
+static void status_sc_timer_rearm(struct block_list *bl, struct status_change *sc) {
+	if( sc->timer_count == 0 ) {
+		if( sc->timer_armed ) {
+			timer->delete(sc->timer, status->sc_timer);
+			sc->timer_armed = false;
+		}
+		if( sc->timers ) {
+			aFree(sc->timers);
+			sc->timers = NULL;
+			sc->timer_max = 0;
+		}
+		return;
+	}
+	if( !sc->timer_armed ) {
+		sc->timer = timer->add(sc->timers[0].tick, status->sc_timer, bl->id, 0);
+		sc->timer_armed = true;
+	} else if( timer->get(sc->timer)->tick != sc->timers[0].tick )
+		timer->settick(sc->timer, sc->timers[0].tick);
+}
+
+/// Removes the pending tick of a status change, returns false if it had none.
+static bool status_sc_timer_remove(struct status_change *sc, enum sc_type type) {
+	int i;
+
+	ARR_FIND(0, sc->timer_count, i, sc->timers[i].type == type);
+	if( i == sc->timer_count )
+		return false;
+	memmove(&sc->timers[i], &sc->timers[i+1], (sc->timer_count-i-1)*sizeof(sc->timers[0]));
+	sc->timer_count--;
+	return true;
+}
+
+/// Schedules status->change_timer for a status change of bl at the given tick,
+/// replacing its previous tick. Returns the value to store in the entry's timer.
+int status_sc_timer_add(struct block_list *bl, enum sc_type type, int64 tick) {
+	struct status_change *sc = status->get_sc(bl);
+	int i;
+
+	nullpo_retr(INVALID_TIMER, sc);
+
+	status_sc_timer_remove(sc, type);
+	if( sc->timer_count == sc->timer_max ) {
+		sc->timer_max += 8;
+		RECREATE(sc->timers, struct status_change_timer, sc->timer_max);
+	}
+	// after the entries with the same tick, like the global timer heap
+	for( i = sc->timer_count; i > 0 && DIFF_TICK(sc->timers[i-1].tick, tick) > 0; i-- )
+		sc->timers[i] = sc->timers[i-1];
+	sc->timers[i].tick = tick;
+	sc->timers[i].type = type;
+	sc->timer_count++;
+
+	status_sc_timer_rearm(bl, sc);
+	return SC_TIMER_SCHEDULED;
+}
+
+/// Cancels the pending tick of a status change of bl.
+void status_sc_timer_delete(struct block_list *bl, enum sc_type type) {
+	struct status_change *sc = status->get_sc(bl);
+
+	if( sc && status_sc_timer_remove(sc, type) )
+		status_sc_timer_rearm(bl, sc);
+}
+
+/// Returns the pending tick of a status change of bl, 0 if there is none.
+int64 status_sc_timer_gettick(struct block_list *bl, enum sc_type type) {
+	struct status_change *sc = status->get_sc(bl);
+	int i;
+
+	if( sc == NULL )
+		return 0;
+	ARR_FIND(0, sc->timer_count, i, sc->timers[i].type == type);
+	return i < sc->timer_count ? sc->timers[i].tick : 0;
+}
+
+/// The object's status change timer, runs all due status change ticks at once.
+int status_sc_timer(int tid, int64 tick, int id, intptr_t data) {
+	struct block_list *bl = map->id2bl(id);
+	struct status_change *sc;
+
+	if( bl == NULL || (sc = status->get_sc(bl)) == NULL )
+		return 0;
+	if( !sc->timer_armed || sc->timer != tid ) {
+		ShowError("status_sc_timer: Mismatch for bl id %d: %d != %d\n", id, tid, sc->timer_armed ? sc->timer : INVALID_TIMER);
+		return 0;
+	}
+	sc->timer_armed = false; // released by the timer system once we return
+
+	while( sc->timer_count > 0 && DIFF_TICK(sc->timers[0].tick, tick) <= 0 ) {
+		enum sc_type type = (sc_type)sc->timers[0].type;
+
+		memmove(&sc->timers[0], &sc->timers[1], (sc->timer_count-1)*sizeof(sc->timers[0]));
+		sc->timer_count--;
+		status->change_timer(SC_TIMER_SCHEDULED, tick, id, type);
+
+		// the status change may have removed its owner
+		if( (bl = map->id2bl(id)) == NULL || (sc = status->get_sc(bl)) == NULL )
+			return 0;
+	}
+
+	status_sc_timer_rearm(bl, sc);
+	return 0;
+}
+
 /*==========================================
 * For recusive status, like for each 5s we drop sp etc.
 * Reseting the end timer.
@@ -10026,7 +10360,7 @@ int status_change_timer(int tid, int64 tick, int id, intptr_t data) {
 	// set the next timer of the sce (don't assume the status still exists)
 #define sc_timer_next(t,f,i,d) do { \
 	if( (sce=sc->data[type]) ) \
-		sce->timer = timer->add(t,f,i,d); \
+		sce->timer = status->sc_timer_add(bl,type,t); \
 	else \
 		ShowError("status_change_timer: Unexpected NULL status change id: %d data: %d\n", id, data); \
 } while(0)
@@ -10100,6 +10434,7 @@ int status_change_timer(int tid, int64 tick, int id, intptr_t data) {
 			sc->opt1 = OPT1_STONE;
 			clif->changeoption(bl);
 			sc_timer_next(1000+tick, status->change_timer, bl->id, data );
+			status->calc.trigger = STATUS_CALC_SC_TIMER;
 			status_calc_bl(bl, status->ChangeFlagTable[type]);
 			return 0;
 		}
@@ -11010,6 +11345,7 @@ int status_change_clear_buffs (struct block_list* bl, int type) {
 	if (!sc || !sc->count)
 		return 0;
 
+	status->calc_batch_begin();
 	if (type&6) //Debuffs
 		for (i = SC_COMMON_MIN; i <= SC_COMMON_MAX; i++)
 			status_change_end(bl, (sc_type)i, INVALID_TIMER);
@@ -11057,6 +11393,7 @@ int status_change_clear_buffs (struct block_list* bl, int type) {
 		}
 		status_change_end(bl, (sc_type)i, INVALID_TIMER);
 	}
+	status->calc_batch_end();
 	return 0;
 }
 
@@ -11102,10 +11439,10 @@ int status_change_spread( struct block_list *src, struct block_list *bl ) {
 		case SC_DEATHHURT:
 		case SC_PARALYSE:
 			if( sc->data[i]->timer != INVALID_TIMER ) {
-				const struct TimerData *td = timer->get(sc->data[i]->timer);
-				if (td == NULL || td->func != status->change_timer || DIFF_TICK(td->tick,tick) < 0)
+				int64 sc_tick = status->sc_timer_gettick(src, (sc_type)i);
+				if (sc_tick == 0 || DIFF_TICK(sc_tick,tick) < 0)
 					continue;
-				data.tick = DIFF_TICK32(td->tick,tick);
+				data.tick = DIFF_TICK32(sc_tick,tick);
 			} else
 				data.tick = INVALID_TIMER;
 			break;
@@ -11536,8 +11873,10 @@ int status_readdb(void)
 *------------------------------------------*/
 int do_init_status(void) {
 	timer->add_func_list(status->change_timer,"status_change_timer");
+	timer->add_func_list(status->sc_timer,"status_sc_timer");
 	timer->add_func_list(status->kaahi_heal_timer,"status_kaahi_heal_timer");
 	timer->add_func_list(status->natural_heal_timer,"status_natural_heal_timer");
+	timer->add_func_list(status->calc_stats_timer,"status_calc_stats_timer");
 	status->initChangeTables();
 	status->initDummyData();
 	status->readdb();
@@ -11545,10 +11884,17 @@ int do_init_status(void) {
 	status->natural_heal_prev_tick = timer->gettick();
 	status->data_ers = ers_new(sizeof(struct status_change_entry),"status.c::data_ers",ERS_OPT_NONE);
 	timer->add_interval(status->natural_heal_prev_tick + NATURAL_HEAL_INTERVAL, status->natural_heal_timer, 0, 0, NATURAL_HEAL_INTERVAL);
+	status->calc.report_tick = status->natural_heal_prev_tick;
+	timer->add_interval(status->calc.report_tick + 1000, status->calc_stats_timer, 0, 0, 1000);
 	return 0;
 }
 void do_final_status(void) {
 	ers_destroy(status->data_ers);
+	status->item_bonus_clear();
+	if( status->item_bonus.rec )
+		aFree(status->item_bonus.rec);
+	if( status->calc.pending )
+		aFree(status->calc.pending);
 }
 
 /*=====================================
@@ -11587,6 +11933,8 @@ void status_defaults(void) {
 	memset(&status->dummy, 0, sizeof(status->dummy));
 	status->natural_heal_prev_tick = 0;
 	status->natural_heal_diff_tick = 0;
+	memset(&status->item_bonus, 0, sizeof(status->item_bonus));
+	memset(&status->calc, 0, sizeof(status->calc));
 	/* funcs */
 	status->get_refine_chance = status_get_refine_chance;
 	// for looking up associated data
@@ -11632,9 +11980,14 @@ void status_defaults(void) {
 	status->get_sc_def = status_get_sc_def;
 
 	status->change_start = status_change_start;
+	status->change_start_sub = status_change_start_sub;
 	status->change_end_ = status_change_end_;
 	status->kaahi_heal_timer = kaahi_heal_timer;
 	status->change_timer = status_change_timer;
+	status->sc_timer = status_sc_timer;
+	status->sc_timer_add = status_sc_timer_add;
+	status->sc_timer_delete = status_sc_timer_delete;
+	status->sc_timer_gettick = status_sc_timer_gettick;
 	status->change_timer_sub = status_change_timer_sub;
 	status->change_clear = status_change_clear;
 	status->change_clear_buffs = status_change_clear_buffs;
@@ -11713,4 +12066,11 @@ void status_defaults(void) {
 	status->readdb_sizefix = status_readdb_sizefix;
 	status->readdb_refine = status_readdb_refine;
 	status->readdb_scconfig = status_readdb_scconfig;
+	status->item_script = status_item_script;
+	status->item_bonus_record = status_item_bonus_record;
+	status->item_bonus_alloc = status_item_bonus_alloc;
+	status->item_bonus_clear = status_item_bonus_clear;
+	status->calc_batch_begin = status_calc_batch_begin;
+	status->calc_batch_end = status_calc_batch_end;
+	status->calc_stats_timer = status_calc_stats_timer;
 }
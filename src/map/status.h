@@ -13,6 +13,7 @@ struct pet_data;
 struct homun_data;
 struct mercenary_data;
 struct status_change;
+struct item_data;
 
 /**
  * Max Refine available to your server
@@ -1735,6 +1736,15 @@ struct status_change_entry {
 	int val1,val2,val3,val4;
 };
 
+// pending tick of a status change, see status->sc_timer_add
+struct status_change_timer {
+	int64 tick;
+	unsigned short type;
+};
+
+// status_change_entry.timer of a status change with a pending tick in its owner's timer
+#define SC_TIMER_SCHEDULED (-2)
+
 struct status_change {
 	unsigned int option;// effect state (bitfield)
 	unsigned int opt3;// skill state (bitfield)
@@ -1752,6 +1762,12 @@ struct status_change {
 	unsigned char sg_counter; //Storm gust counter (previous hits from storm gust)
 #endif
 	unsigned char bs_counter; // Blood Sucker counter
+	unsigned int pending_calc; // enum scb_flag recalculations deferred by status->calc_batch_begin
+	unsigned char pending_trigger; // enum status_calc_trigger of the first deferred recalculation
+	int timer; // timer running status->sc_timer, valid while timer_armed
+	bool timer_armed;
+	unsigned short timer_count, timer_max;
+	struct status_change_timer *timers; // pending status change ticks, sorted by tick
 	struct status_change_entry *data[SC_MAX];
 };
 
@@ -1819,6 +1835,50 @@ struct status_change {
 #define status_calc_elemental(ed, first) status->calc_bl_(&(ed)->bl, SCB_ALL, first)
 #define status_calc_npc(nd, first) status->calc_bl_(&(nd)->bl, SCB_ALL, first)
 
+// what triggered a status recalculation, see battle_config.status_calc_stats
+enum status_calc_trigger {
+	STATUS_CALC_OTHER = 0,
+	STATUS_CALC_BASE,     // base status (equipment, stats, skills, ...)
+	STATUS_CALC_SC_START, // status change started
+	STATUS_CALC_SC_END,   // status change ended
+	STATUS_CALC_SC_TIMER, // status change interval
+	STATUS_CALC_TRIGGER_MAX
+};
+
+/**
+ * Item bonus cache
+ * Item scripts that only issue bonus commands are run once per refine level
+ * with their bonuses recorded; later recalculations apply the recorded bonuses
+ * directly instead of running the script again (see status->item_script).
+ **/
+enum status_item_bonus_state {
+	ITEM_BONUS_UNKNOWN = 0, // script not checked yet
+	ITEM_BONUS_CACHE,        // bonus commands only
+	ITEM_BONUS_CACHE_REFINE, // bonus commands only, reads getrefine()
+	ITEM_BONUS_NOCACHE,      // has to be run every time
+};
+
+// a single bonus command
+struct status_item_bonus {
+	int type;
+	int val[5];
+	int argc; // bonus=1 .. bonus5=5
+};
+
+// bonus commands issued by an item script at a refine level
+struct status_item_bonus_vec {
+	struct status_item_bonus_vec *next;
+	int refine; // -1 for scripts that don't read the refine level
+	int count;
+	struct status_item_bonus bonus[1]; // dynamic array, allocated with extra entries
+};
+
+// arena chunk the bonus vectors are allocated from, released all at once on item db reload
+struct status_bonus_chunk {
+	struct status_bonus_chunk *next;
+	size_t used, size;
+};
+
 // bonus values and upgrade chances for refining equipment
 struct s_refine_info {
 	int chance[MAX_REFINE]; // success chance
@@ -1863,6 +1923,21 @@ struct status_interface {
 	struct status_data dummy;
 	int64 natural_heal_prev_tick;
 	unsigned int natural_heal_diff_tick;
+	struct {
+		struct status_bonus_chunk *chunks;
+		struct status_item_bonus *rec; // bonuses of the script being recorded
+		int rec_count, rec_max;
+		bool recording;
+	} item_bonus;
+	struct {
+		int depth; // status->calc_batch_begin nesting level
+		int *pending; // ids of the objects with deferred recalculations
+		int pending_count, pending_max;
+		enum status_calc_trigger trigger; // trigger of the next status_calc_bl call
+		unsigned int count[STATUS_CALC_TRIGGER_MAX]; // recalculations since the last report
+		unsigned int coalesced; // recalculations merged into a pending one since the last report
+		int64 report_tick;
+	} calc;
 	/* */
 	int (*init) (void);
 	void (*final) (void);
@@ -1905,9 +1980,14 @@ struct status_interface {
 	int (*isimmune) (struct block_list *bl);
 	int (*get_sc_def) (struct block_list *bl, enum sc_type type, int rate, int tick, int flag);
 	int (*change_start) (struct block_list* bl,enum sc_type type,int rate,int val1,int val2,int val3,int val4,int tick,int flag);
+	int (*change_start_sub) (struct block_list* bl,enum sc_type type,int rate,int val1,int val2,int val3,int val4,int tick,int flag);
 	int (*change_end_) (struct block_list* bl, enum sc_type type, int tid, const char* file, int line);
 	int (*kaahi_heal_timer) (int tid, int64 tick, int id, intptr_t data);
 	int (*change_timer) (int tid, int64 tick, int id, intptr_t data);
+	int (*sc_timer) (int tid, int64 tick, int id, intptr_t data);
+	int (*sc_timer_add) (struct block_list *bl, enum sc_type type, int64 tick);
+	void (*sc_timer_delete) (struct block_list *bl, enum sc_type type);
+	int64 (*sc_timer_gettick) (struct block_list *bl, enum sc_type type);
 	int (*change_timer_sub) (struct block_list* bl, va_list ap);
 	int (*change_clear) (struct block_list* bl, int type);
 	int (*change_clear_buffs) (struct block_list* bl, int type);
@@ -1977,6 +2057,13 @@ struct status_interface {
 	bool (*readdb_sizefix) (char *fields[], int columns, int current);
 	bool (*readdb_refine) (char *fields[], int columns, int current);
 	bool (*readdb_scconfig) (char *fields[], int columns, int current);
+	void (*item_script) (struct map_session_data *sd, struct item_data *data);
+	void (*item_bonus_record) (int argc, int type, int val1, int val2, int val3, int val4, int val5);
+	void* (*item_bonus_alloc) (size_t size);
+	void (*item_bonus_clear) (void);
+	void (*calc_batch_begin) (void);
+	void (*calc_batch_end) (void);
+	int (*calc_stats_timer) (int tid, int64 tick, int id, intptr_t data);
 };
 
 struct status_interface *status;
@@ -2389,6 +2389,12 @@ int unit_free(struct block_list *bl, clr_type clrtype) {
 				aFree(sd->queues);
 				sd->queues = NULL;
 			}
+			if( sd->quest_objectives != NULL ) {
+				aFree(sd->quest_objectives);
+				sd->quest_objectives = NULL;
+			}
+			sd->quest_objectives_count = sd->quest_objectives_max = 0;
+			clif->aoi_free(sd);
 			
 			for( k = 0; k < sd->hdatac; k++ ) {
 				if( sd->hdata[k]->flag.free ) {
@@ -2457,6 +2463,7 @@ int unit_free(struct block_list *bl, clr_type clrtype) {
 		case BL_MOB:
 		{
 			struct mob_data *md = (struct mob_data*)bl;
+			mob->ai_sleep(md);
 			if( md->spawn_timer != INVALID_TIMER )
 			{
 				timer->delete(md->spawn_timer,mob->delayspawn);
@@ -2564,6 +2571,11 @@ int unit_free(struct block_list *bl, clr_type clrtype) {
 		}
 	}
 
+	if( ud->idle_packet ) {
+		aFree(ud->idle_packet);
+		ud->idle_packet = NULL;
+	}
+
 	skill->clear_unitgroup(bl);
 	status->change_clear(bl,1);
 	map->deliddb(bl);
@@ -8,6 +8,7 @@
 struct block_list;
 struct unit_data;
 struct map_session_data;
+struct packet_idle_unit;
 
 #include "clif.h"  // clr_type
 #include "map.h" // struct block_list
@@ -37,6 +38,9 @@ struct unit_data {
 	uint8 dir;
 	unsigned char walk_count;
 	unsigned char target_count;
+	struct packet_idle_unit *idle_packet; // cached 'unit standing' packet, see clif_set_unit_idle
+	unsigned int look_version; // bumped by clif->look_changed
+	unsigned int idle_packet_version; // look_version the cached packet was built for
 	struct {
 		unsigned change_walk_target : 1 ;
 		unsigned skillcastcancel : 1 ;
@@ -2,6 +2,7 @@
 // See the LICENSE file
 // Portions Copyright (c) Athena Dev Teams
 
+#include "../common/malloc.h"
 #include "../common/nullpo.h"
 #include "../common/strlib.h"
 #include "../common/utils.h"
@@ -35,6 +36,9 @@ void vending_closevending(struct map_session_data* sd) {
 	nullpo_retv(sd);
 
 	if( sd->state.vending ) {
+		int i;
+		for( i = 0; i < sd->vend_num; i++ )
+			vending->index_remove(sd, i);
 		sd->state.vending = false;
 		clif->closevendingboard(&sd->bl, 0);
 		idb_remove(vending->db, sd->status.char_id);
@@ -172,6 +176,8 @@ void vending_purchasereq(struct map_session_data* sd, int aid, unsigned int uid,
 		// vending item
 		pc->additem(sd, &vsd->status.cart[idx], amount, LOG_TYPE_VENDING);
 		vsd->vending[vend_list[i]].amount -= amount;
+		if( vsd->vending[vend_list[i]].amount == 0 )
+			vending->index_remove(vsd, vend_list[i]); // sold out, drop it before the cart slot is cleared
 		pc->cart_delitem(vsd, idx, amount, 0, LOG_TYPE_VENDING);
 		clif->vendingreport(vsd, idx, amount);
 
@@ -284,6 +290,8 @@ void vending_openvending(struct map_session_data* sd, const char* message, const
 	clif->showvendingboard(&sd->bl,message,0);
 	
 	idb_put(vending->db, sd->status.char_id, sd);
+	for( i = 0; i < sd->vend_num; i++ )
+		vending->index_add(sd, i);
 }
 
 
@@ -356,12 +364,245 @@ bool vending_searchall(struct map_session_data* sd, const struct s_search_store_
 
 	return true;
 }
+
+/*==========================================
+ * Market index
+ * Offers are kept per item id and per card id in lists sorted by price,
+ * so that store searches are range scans instead of a walk over every shop.
+ *------------------------------------------*/
+
+/// Collects the distinct cards of an item, same rules as the card filter of vending_searchall.
+/// @return Number of cards written to cards[]
+static int vending_index_cards(const struct item* it, short cards[MAX_SLOTS]) {
+	int c, n = 0, i, slot;
+
+	if( itemdb_isspecial(it->card[0]) )
+		return 0;
+
+	slot = itemdb_slot(it->nameid);
+	for( c = 0; c < slot && c < MAX_SLOTS && it->card[c]; c++ ) {
+		ARR_FIND( 0, n, i, cards[i] == it->card[c] );
+		if( i == n )
+			cards[n++] = it->card[c];
+	}
+
+	return n;
+}
+
+/// First position in the list whose price is not lower than value.
+static int vending_index_lowerbound(const struct s_vending_offer_list* list, unsigned int value) {
+	int lo = 0, hi = list->count;
+
+	while( lo < hi ) {
+		int mid = (lo + hi) / 2;
+		if( list->offer[mid].value < value )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void vending_index_insert(DBMap* db, int key, const struct s_vending_offer* offer) {
+	struct s_vending_offer_list* list;
+	int pos;
+
+	if( (list = idb_get(db, key)) == NULL ) {
+		CREATE(list, struct s_vending_offer_list, 1);
+		idb_put(db, key, list);
+	}
+
+	if( list->count == list->max ) {
+		list->max += 8;
+		RECREATE(list->offer, struct s_vending_offer, list->max);
+	}
+
+	// after offers of equal price, older shops stay first
+	for( pos = list->count; pos > 0 && list->offer[pos-1].value > offer->value; pos-- )
+		;
+	if( pos < list->count )
+		memmove(&list->offer[pos+1], &list->offer[pos], sizeof(struct s_vending_offer) * (list->count - pos));
+	list->offer[pos] = *offer;
+	list->count++;
+}
+
+static void vending_index_erase(DBMap* db, int key, const struct s_vending_offer* offer) {
+	struct s_vending_offer_list* list;
+	int pos;
+
+	if( (list = idb_get(db, key)) == NULL )
+		return;
+
+	for( pos = vending_index_lowerbound(list, offer->value); pos < list->count && list->offer[pos].value == offer->value; pos++ ) {
+		if( list->offer[pos].char_id == offer->char_id && list->offer[pos].index == offer->index ) {
+			list->count--;
+			if( pos < list->count )
+				memmove(&list->offer[pos], &list->offer[pos+1], sizeof(struct s_vending_offer) * (list->count - pos));
+			break;
+		}
+	}
+
+	if( list->count == 0 ) {
+		idb_remove(db, key);
+		aFree(list->offer);
+		aFree(list);
+	}
+}
+
+/// Adds vending slot n of sd to the market index.
+void vending_index_add(struct map_session_data* sd, int n) {
+	struct s_vending_offer offer;
+	struct item* it;
+	short cards[MAX_SLOTS];
+	int i, count;
+
+	nullpo_retv(sd);
+
+	it = &sd->status.cart[sd->vending[n].index];
+	offer.char_id = sd->status.char_id;
+	offer.value = sd->vending[n].value;
+	offer.index = sd->vending[n].index;
+
+	vending_index_insert(vending->item_index, it->nameid, &offer);
+	count = vending_index_cards(it, cards);
+	for( i = 0; i < count; i++ )
+		vending_index_insert(vending->card_index, cards[i], &offer);
+}
+
+/// Removes vending slot n of sd from the market index, must be called while the cart slot still holds the item.
+void vending_index_remove(struct map_session_data* sd, int n) {
+	struct s_vending_offer offer;
+	struct item* it;
+	short cards[MAX_SLOTS];
+	int i, count;
+
+	nullpo_retv(sd);
+
+	it = &sd->status.cart[sd->vending[n].index];
+	offer.char_id = sd->status.char_id;
+	offer.value = sd->vending[n].value;
+	offer.index = sd->vending[n].index;
+
+	vending_index_erase(vending->item_index, it->nameid, &offer);
+	count = vending_index_cards(it, cards);
+	for( i = 0; i < count; i++ )
+		vending_index_erase(vending->card_index, cards[i], &offer);
+}
+
+/// Searches the market index for all offers matching given ids, price and possible cards, cheapest first.
+/// With cards given the card lists are scanned and filtered by item id, otherwise the item lists.
+/// @return Whether or not the result set did not overflow.
+bool vending_index_search(const struct s_search_store_search* s) {
+	struct s_vending_offer_list** lists;
+	int* pos;
+	const unsigned short* keys;
+	unsigned int k, key_count, i;
+	bool ret = true;
+
+	if( s->card_count ) {
+		keys = s->cardlist;
+		key_count = s->card_count;
+	} else {
+		keys = s->itemlist;
+		key_count = s->item_count;
+	}
+
+	if( !key_count )
+		return true;
+
+	CREATE(lists, struct s_vending_offer_list*, key_count);
+	CREATE(pos, int, key_count);
+
+	for( k = 0; k < key_count; k++ ) {
+		ARR_FIND( 0, k, i, keys[i] == keys[k] );
+		if( i != k ) // duplicate key, already scanned
+			continue;
+		lists[k] = idb_get(s->card_count ? vending->card_index : vending->item_index, keys[k]);
+		if( lists[k] && s->min_price )
+			pos[k] = vending_index_lowerbound(lists[k], s->min_price);
+	}
+
+	for(;;) {
+		const struct s_vending_offer* offer;
+		struct map_session_data* vsd;
+		struct item* it;
+		unsigned int best = key_count;
+		int n;
+
+		// merge the lists by price
+		for( k = 0; k < key_count; k++ ) {
+			if( !lists[k] || pos[k] >= lists[k]->count )
+				continue;
+			if( s->max_price && lists[k]->offer[pos[k]].value > s->max_price )
+				continue; // rest of this list is too expensive
+			if( best == key_count || lists[k]->offer[pos[k]].value < lists[best]->offer[pos[best]].value )
+				best = k;
+		}
+		if( best == key_count )
+			break;
+
+		offer = &lists[best]->offer[pos[best]++];
+
+		if( (vsd = idb_get(vending->db, offer->char_id)) == NULL || vsd == s->search_sd || !vsd->state.vending )
+			continue;
+		ARR_FIND( 0, vsd->vend_num, n, vsd->vending[n].index == offer->index );
+		if( n == vsd->vend_num || vsd->vending[n].value != offer->value )
+			continue; // stale record
+		it = &vsd->status.cart[offer->index];
+		if( !s->card_count && it->nameid != keys[best] )
+			continue; // stale record
+
+		if( s->card_count ) {
+			short cards[MAX_SLOTS];
+			int c, count;
+
+			ARR_FIND( 0, s->item_count, i, s->itemlist[i] == it->nameid );
+			if( i == s->item_count ) // not one of the requested items
+				continue;
+
+			// an item carrying several of the requested cards is listed once, under the first of them
+			count = vending_index_cards(it, cards);
+			for( c = 0; c < count; c++ ) {
+				ARR_FIND( 0, best, i, keys[i] == cards[c] );
+				if( i != best )
+					break;
+			}
+			if( c != count )
+				continue;
+		}
+
+		if( !searchstore->result(s->search_sd, vsd->vender_id, vsd->status.account_id, vsd->message, it->nameid, vsd->vending[n].amount, vsd->vending[n].value, it->card, it->refine) ) {
+			// result set full
+			ret = false;
+			break;
+		}
+	}
+
+	aFree(lists);
+	aFree(pos);
+
+	return ret;
+}
+
+static int vending_index_final_sub(DBKey key, DBData *data, va_list ap) {
+	struct s_vending_offer_list* list = DB->data2ptr(data);
+
+	aFree(list->offer);
+	aFree(list);
+	return 0;
+}
+
 void final(void) {
 	db_destroy(vending->db);
+	vending->item_index->destroy(vending->item_index, vending_index_final_sub);
+	vending->card_index->destroy(vending->card_index, vending_index_final_sub);
 }
 
 void init(void) {
 	vending->db = idb_alloc(DB_OPT_BASE);
+	vending->item_index = idb_alloc(DB_OPT_BASE);
+	vending->card_index = idb_alloc(DB_OPT_BASE);
 	vending->next_id = 0;
 }
 
@@ -377,4 +618,7 @@ void vending_defaults(void) {
 	vending->purchase = vending_purchasereq;
 	vending->search = vending_search;
 	vending->searchall = vending_searchall;
+	vending->index_add = vending_index_add;
+	vending->index_remove = vending_index_remove;
+	vending->index_search = vending_index_search;
 }
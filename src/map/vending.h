@@ -16,9 +16,24 @@ struct s_vending {
 	unsigned int value; //at wich price
 };
 
+/// Market index record, one per vending slot (and per distinct card of it)
+struct s_vending_offer {
+	int char_id; //vender (key of vending->db)
+	unsigned int value; //price, lists are sorted by it
+	short index; //cart index
+};
+
+/// Price-sorted offers for one item or card id
+struct s_vending_offer_list {
+	struct s_vending_offer *offer;
+	int count, max;
+};
+
 struct vending_interface {
 	unsigned int next_id;/* next vender id */
 	DBMap *db;
+	DBMap *item_index;/* nameid -> struct s_vending_offer_list */
+	DBMap *card_index;/* card nameid -> struct s_vending_offer_list */
 	/* */
 	void (*init) (void);
 	void (*final) (void);
@@ -29,6 +44,9 @@ struct vending_interface {
 	void (*purchase) (struct map_session_data* sd, int aid, unsigned int uid, const uint8* data, int count);
 	bool (*search) (struct map_session_data* sd, unsigned short nameid);
 	bool (*searchall) (struct map_session_data* sd, const struct s_search_store_search* s);
+	void (*index_add) (struct map_session_data* sd, int n);
+	void (*index_remove) (struct map_session_data* sd, int n);
+	bool (*index_search) (const struct s_search_store_search* s);
 };
 
 struct vending_interface *vending;
@@ -0,0 +1,503 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+// Battle simulation harness
+//
+// Builds a player and a monster from the loaded databases and runs the
+// battle formulas (battle->calc_attack) on them a configurable number of
+// times, with the random generator seeded first. For every scenario it
+// reports the calculations per second, the damage distribution and a
+// checksum of every result, so formula changes can be shown to be faster
+// and, unless meant otherwise, to give bit-identical damage. It also times
+// status_calc_pc on the scenario's player with the item bonus cache
+// (item_bonus_cache in conf/battle/items.conf) on and off, and checks that
+// both give the same status.
+//
+// Enable "battlesim" in conf/plugins.conf, then run
+//   ./map-server --run-once
+// to simulate conf/battlesim.conf once the server is up and exit, or use
+// the 'server tools battlesim [<file>]' console command on a running server.
+
+#include "../common/cbasetypes.h"
+#include "../common/core.h"
+#include "../common/malloc.h"
+#include "../common/mmo.h"
+#include "../common/strlib.h"
+#include "../common/timer.h"
+#include "../common/HPMi.h"
+#include "../config/core.h"
+#include "../map/battle.h"
+#include "../map/itemdb.h"
+#include "../map/map.h"
+#include "../map/mob.h"
+#include "../map/pc.h"
+#include "../map/script.h"
+#include "../map/skill.h"
+#include "../map/status.h"
+#include "../map/unit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HPExport struct hplugin_info pinfo = {
+	"battlesim",		// Plugin name
+	SERVER_TYPE_MAP,// Which server types this plugin works with?
+	"0.1",			// Plugin version
+	HPM_VERSION,	// HPM Version (don't change, macro is automatically updated)
+};
+
+#define BATTLESIM_CONF "conf/battlesim.conf"
+#define BATTLESIM_ACCOUNT_ID 1 // below START_ACCOUNT_NUM, never used by a real player
+#define BATTLESIM_MAX_EQUIP 16
+#define BATTLESIM_MAX_SKILL 32
+#define BATTLESIM_MAX_SC 16
+#define BATTLESIM_SC_DURATION 600000 // status changes are cleared after each scenario anyway
+
+struct battlesim_equip {
+	int nameid;
+	int refine;
+	int card[MAX_SLOTS];
+};
+
+struct battlesim_sc {
+	int type;
+	int val1;
+};
+
+struct battlesim_scenario {
+	char name[64];
+	int job, sex;
+	int base_level, job_level;
+	int stats[6]; // str, agi, vit, int, dex, luk
+	struct battlesim_equip equip[BATTLESIM_MAX_EQUIP];
+	int equip_count;
+	struct { int id, lv; } skills[BATTLESIM_MAX_SKILL];
+	int skill_count;
+	struct battlesim_sc sc[BATTLESIM_MAX_SC], target_sc[BATTLESIM_MAX_SC];
+	int sc_count, target_sc_count;
+	int skill_id, skill_lv;
+	int target; // mob id
+};
+
+struct battlesim_config {
+	int iterations;
+	int calc_iterations;
+	unsigned int seed;
+	char mapname[MAP_NAME_LENGTH_EXT];
+	int x, y;
+	struct battlesim_scenario *scenarios;
+	int count;
+};
+
+void (*sim_rnd_seed) (uint32 seed);
+int *sim_runflag;
+
+/*==========================================
+ * Configuration
+ *------------------------------------------*/
+/// Resolves a skill or status change name (or plain number) to its id, -1 if unknown.
+static int battlesim_id(const char *str, bool is_skill) {
+	int value;
+
+	if( ISDIGIT(str[0]) )
+		return atoi(str);
+	if( is_skill )
+		return (value = skill->name2id(str)) > 0 ? value : -1;
+	return script->get_constant(str, &value) ? value : -1;
+}
+
+/// Parses "<name> <value> [<name> <value> ...]" pairs, returns the number read.
+static int battlesim_pairs(char *str, bool is_skill, int *ids, int *values, int max, size_t stride, const char *file, int line) {
+	char *name, *value;
+	int count = 0;
+
+	for( name = strtok(str, " \t,"); name != NULL; name = strtok(NULL, " \t,") ) {
+		int id;
+		if( (value = strtok(NULL, " \t,")) == NULL ) {
+			ShowWarning("battlesim: missing level/value after '%s' in %s:%d.\n", name, file, line);
+			break;
+		}
+		if( (id = battlesim_id(name, is_skill)) < 0 ) {
+			ShowWarning("battlesim: unknown %s '%s' in %s:%d, skipping.\n", is_skill ? "skill" : "status change", name, file, line);
+			continue;
+		}
+		if( count == max ) {
+			ShowWarning("battlesim: too many entries in %s:%d, the limit is %d.\n", file, line, max);
+			break;
+		}
+		*(int*)((char*)ids + count * stride) = id;
+		*(int*)((char*)values + count * stride) = atoi(value);
+		count++;
+	}
+	return count;
+}
+
+/// Parses "<item id>[+<refine>][:<card>...]" entries.
+static int battlesim_equips(char *str, struct battlesim_equip *equip, int max) {
+	char *entry;
+	int count = 0;
+
+	for( entry = strtok(str, " \t,"); entry != NULL && count < max; entry = strtok(NULL, " \t,") ) {
+		char *p;
+		int i;
+
+		memset(&equip[count], 0, sizeof(equip[count]));
+		equip[count].nameid = atoi(entry);
+		if( (p = strchr(entry, '+')) != NULL )
+			equip[count].refine = atoi(p+1);
+		for( i = 0, p = strchr(entry, ':'); p != NULL && i < MAX_SLOTS; i++, p = strchr(p+1, ':') )
+			equip[count].card[i] = atoi(p+1);
+		count++;
+	}
+	return count;
+}
+
+static bool battlesim_read_config(const char *file, struct battlesim_config *conf) {
+	struct battlesim_scenario *sc = NULL;
+	char line[1024], key[64], value[1024];
+	int n = 0;
+	FILE *fp;
+
+	if( (fp = fopen(file, "r")) == NULL ) {
+		ShowError("battlesim: can't read '%s'.\n", file);
+		return false;
+	}
+
+	memset(conf, 0, sizeof(*conf));
+	conf->iterations = 100000;
+	conf->calc_iterations = 10000;
+	conf->seed = 1;
+	safestrncpy(conf->mapname, "prontera", sizeof(conf->mapname));
+	conf->x = 150;
+	conf->y = 150;
+
+	while( fgets(line, sizeof(line), fp) ) {
+		n++;
+		if( (line[0] == '/' && line[1] == '/') || sscanf(line, " %63[^:]: %1023[^\r\n]", key, value) != 2 )
+			continue;
+		trim(key);
+		trim(value);
+
+		if( strcmpi(key, "scenario") == 0 ) {
+			RECREATE(conf->scenarios, struct battlesim_scenario, conf->count + 1);
+			sc = &conf->scenarios[conf->count++];
+			memset(sc, 0, sizeof(*sc));
+			safestrncpy(sc->name, value, sizeof(sc->name));
+			sc->job = JOB_NOVICE;
+			sc->base_level = sc->job_level = 1;
+			sc->stats[0] = sc->stats[1] = sc->stats[2] = sc->stats[3] = sc->stats[4] = sc->stats[5] = 1;
+			sc->target = 1002; // Poring
+		} else if( sc == NULL ) { // settings
+			if( strcmpi(key, "iterations") == 0 )
+				conf->iterations = max(atoi(value), 1);
+			else if( strcmpi(key, "calc_iterations") == 0 )
+				conf->calc_iterations = max(atoi(value), 0);
+			else if( strcmpi(key, "seed") == 0 )
+				conf->seed = (unsigned int)strtoul(value, NULL, 10);
+			else if( strcmpi(key, "map") == 0 )
+				sscanf(value, "%15s %d %d", conf->mapname, &conf->x, &conf->y);
+			else
+				ShowWarning("battlesim: unknown setting '%s' in %s:%d.\n", key, file, n);
+		} else if( strcmpi(key, "job") == 0 ) {
+			sc->job = atoi(value);
+		} else if( strcmpi(key, "sex") == 0 ) {
+			sc->sex = (value[0] == 'M' || value[0] == 'm' || value[0] == '1');
+		} else if( strcmpi(key, "level") == 0 ) {
+			sscanf(value, "%d %d", &sc->base_level, &sc->job_level);
+		} else if( strcmpi(key, "stats") == 0 ) {
+			sscanf(value, "%d %d %d %d %d %d", &sc->stats[0], &sc->stats[1], &sc->stats[2], &sc->stats[3], &sc->stats[4], &sc->stats[5]);
+		} else if( strcmpi(key, "equip") == 0 ) {
+			sc->equip_count = battlesim_equips(value, sc->equip, BATTLESIM_MAX_EQUIP);
+		} else if( strcmpi(key, "skills") == 0 ) {
+			sc->skill_count = battlesim_pairs(value, true, &sc->skills[0].id, &sc->skills[0].lv, BATTLESIM_MAX_SKILL, sizeof(sc->skills[0]), file, n);
+		} else if( strcmpi(key, "sc") == 0 ) {
+			sc->sc_count = battlesim_pairs(value, false, &sc->sc[0].type, &sc->sc[0].val1, BATTLESIM_MAX_SC, sizeof(sc->sc[0]), file, n);
+		} else if( strcmpi(key, "target_sc") == 0 ) {
+			sc->target_sc_count = battlesim_pairs(value, false, &sc->target_sc[0].type, &sc->target_sc[0].val1, BATTLESIM_MAX_SC, sizeof(sc->target_sc[0]), file, n);
+		} else if( strcmpi(key, "skill") == 0 ) {
+			char name[64];
+			sc->skill_lv = 1;
+			if( sscanf(value, "%63s %d", name, &sc->skill_lv) >= 1 && (sc->skill_id = battlesim_id(name, true)) < 0 ) {
+				ShowWarning("battlesim: unknown skill '%s' in %s:%d, using a normal attack.\n", name, file, n);
+				sc->skill_id = 0;
+			}
+		} else if( strcmpi(key, "target") == 0 ) {
+			sc->target = atoi(value);
+		} else
+			ShowWarning("battlesim: unknown scenario setting '%s' in %s:%d.\n", key, file, n);
+	}
+	fclose(fp);
+
+	return true;
+}
+
+/*==========================================
+ * Units
+ *------------------------------------------*/
+/// Creates a player that is not connected to any client, with the scenario's gear, skills and status changes.
+static struct map_session_data *battlesim_create_pc(struct battlesim_scenario *scn, int16 m, int16 x, int16 y) {
+	struct map_session_data *sd = pc->get_dummy_sd();
+	int i, j, n = 0;
+
+	pc->setnewpc(sd, BATTLESIM_ACCOUNT_ID, BATTLESIM_ACCOUNT_ID, 0, 0, scn->sex, 0);
+	safestrncpy(sd->status.name, "battlesim", NAME_LENGTH);
+	sd->status.class_ = scn->job;
+	if( (i = pc->jobid2mapid(scn->job)) == -1 ) {
+		ShowWarning("battlesim: invalid job %d in scenario '%s', using novice.\n", scn->job, scn->name);
+		sd->status.class_ = JOB_NOVICE;
+		i = MAPID_NOVICE;
+	}
+	sd->class_ = i;
+	sd->status.base_level = scn->base_level;
+	sd->status.job_level = scn->job_level;
+	sd->status.str = scn->stats[0];
+	sd->status.agi = scn->stats[1];
+	sd->status.vit = scn->stats[2];
+	sd->status.int_ = scn->stats[3];
+	sd->status.dex = scn->stats[4];
+	sd->status.luk = scn->stats[5];
+	sd->status.hp = sd->status.sp = 1;
+
+	// the timers pc_authok resets, so unit->free can release the player
+	sd->followtimer = sd->invincible_timer = sd->npc_timer_id = sd->pvp_timer = sd->fontcolor_tid = sd->rental_timer = INVALID_TIMER;
+#ifdef SECURE_NPCTIMEOUT
+	sd->npc_idle_timer = INVALID_TIMER;
+#endif
+	for( i = 0; i < MAX_SPIRITBALL; i++ )
+		sd->spirit_timer[i] = INVALID_TIMER;
+	for( i = 0; i < MAX_EVENTTIMER; i++ )
+		sd->eventtimer[i] = INVALID_TIMER;
+	for( i = 0; i < ARRAYLENGTH(sd->autobonus); i++ )
+		sd->autobonus[i].active = sd->autobonus2[i].active = sd->autobonus3[i].active = INVALID_TIMER;
+
+	for( i = 0; i < scn->equip_count; i++ ) {
+		if( itemdb->exists(scn->equip[i].nameid) == NULL ) {
+			ShowWarning("battlesim: unknown item %d in scenario '%s', skipping.\n", scn->equip[i].nameid, scn->name);
+			continue;
+		}
+		sd->status.inventory[n].nameid = scn->equip[i].nameid;
+		sd->status.inventory[n].amount = 1;
+		sd->status.inventory[n].identify = 1;
+		sd->status.inventory[n].refine = scn->equip[i].refine;
+		memcpy(sd->status.inventory[n].card, scn->equip[i].card, sizeof(sd->status.inventory[n].card));
+		n++;
+	}
+	pc->setinventorydata(sd);
+	for( i = 0; i < n; i++ ) { // equip in order, an item taking an occupied slot is left in the inventory
+		int pos = pc->equippoint(sd, i), used = 0;
+		for( j = 0; j < i; j++ )
+			used |= sd->status.inventory[j].equip;
+		if( pos & used )
+			pos &= ~used;
+		sd->status.inventory[i].equip = pos;
+	}
+	pc->setequipindex(sd);
+
+	status->change_init(&sd->bl);
+	status->set_viewdata(&sd->bl, sd->status.class_);
+	unit->dataset(&sd->bl);
+
+	pc->calc_skilltree(sd);
+	for( i = 0; i < scn->skill_count; i++ ) {
+		int idx = skill->get_index(scn->skills[i].id);
+		if( idx == 0 ) {
+			ShowWarning("battlesim: unknown skill %d in scenario '%s', skipping.\n", scn->skills[i].id, scn->name);
+			continue;
+		}
+		sd->status.skill[idx].id = scn->skills[i].id;
+		sd->status.skill[idx].lv = max(0, min(scn->skills[i].lv, skill->get_max(scn->skills[i].id)));
+		sd->status.skill[idx].flag = SKILL_FLAG_PERMANENT;
+	}
+
+	sd->bl.m = m;
+	sd->bl.x = x;
+	sd->bl.y = y;
+	map->addiddb(&sd->bl);
+	map->addblock(&sd->bl);
+
+	status_calc_pc(sd, true);
+	sd->battle_status.hp = sd->status.hp = sd->battle_status.max_hp;
+	sd->battle_status.sp = sd->status.sp = sd->battle_status.max_sp;
+
+	for( i = 0; i < scn->sc_count; i++ )
+		status->change_start(&sd->bl, (sc_type)scn->sc[i].type, 10000, scn->sc[i].val1, 0, 0, 0, BATTLESIM_SC_DURATION, 1|2|8);
+
+	return sd;
+}
+
+static struct mob_data *battlesim_create_mob(struct battlesim_scenario *scn, int16 m, int16 x, int16 y) {
+	struct mob_data *md;
+	int i;
+
+	if( mob->db_checkid(scn->target) == 0 ) {
+		ShowError("battlesim: unknown monster %d in scenario '%s'.\n", scn->target, scn->name);
+		return NULL;
+	}
+	if( (md = mob->once_spawn_sub(NULL, m, x, y, "--ja--", scn->target, "", SZ_SMALL, AI_NONE)) == NULL )
+		return NULL;
+	mob->spawn(md);
+
+	for( i = 0; i < scn->target_sc_count; i++ )
+		status->change_start(&md->bl, (sc_type)scn->target_sc[i].type, 10000, scn->target_sc[i].val1, 0, 0, 0, BATTLESIM_SC_DURATION, 1|2|8);
+
+	return md;
+}
+
+/*==========================================
+ * Simulation
+ *------------------------------------------*/
+static int battlesim_cmp_int64(const void *a, const void *b) {
+	int64 x = *(const int64*)a, y = *(const int64*)b;
+	return x < y ? -1 : x > y;
+}
+
+/// FNV-1a over the parts of a result that reach the client.
+static uint32 battlesim_hash(uint32 hash, const struct Damage *d) {
+	int64 values[5];
+	const unsigned char *p = (const unsigned char *)values;
+	size_t i;
+
+	values[0] = d->damage;
+	values[1] = d->damage2;
+	values[2] = d->div_;
+	values[3] = d->type;
+	values[4] = d->dmg_lv;
+	for( i = 0; i < sizeof(values); i++ )
+		hash = (hash ^ p[i]) * 16777619U;
+	return hash;
+}
+
+/// Times status_calc_pc with the item bonus cache on and off, 0 calc_iterations skips it.
+static void battlesim_run_calc(struct battlesim_config *conf, struct map_session_data *sd) {
+	struct status_data base[2], battle_status[2];
+	int64 elapsed[2];
+	int cache = battle->config_get_value("item_bonus_cache"), pass, i;
+
+	if( conf->calc_iterations == 0 )
+		return;
+
+	for( pass = 0; pass < 2; pass++ ) { // cache on, then off
+		int64 start;
+
+		battle->config_set_value("item_bonus_cache", pass == 0 ? "yes" : "no");
+		status_calc_pc(sd, false); // records the bonuses when the cache is on
+		start = timer->microtick();
+		for( i = 0; i < conf->calc_iterations; i++ )
+			status_calc_pc(sd, false);
+		elapsed[pass] = max(timer->microtick() - start, 1);
+		memcpy(&base[pass], &sd->base_status, sizeof(base[pass]));
+		memcpy(&battle_status[pass], &sd->battle_status, sizeof(battle_status[pass]));
+	}
+	battle->config_set_value("item_bonus_cache", cache ? "yes" : "no");
+
+	ShowMessage("    status_calc_pc %d times: cached "CL_WHITE"%.0f/s"CL_RESET" | uncached %.0f/s | %.2fx | status %s\n",
+		conf->calc_iterations, conf->calc_iterations * 1000000. / elapsed[0], conf->calc_iterations * 1000000. / elapsed[1],
+		(double)elapsed[1] / elapsed[0],
+		memcmp(&base[0], &base[1], sizeof(base[0])) == 0 && memcmp(&battle_status[0], &battle_status[1], sizeof(battle_status[0])) == 0
+			? "identical" : CL_RED"DIFFERENT"CL_RESET);
+}
+
+static void battlesim_run_scenario(struct battlesim_config *conf, struct battlesim_scenario *scn, int16 m) {
+	struct map_session_data *sd;
+	struct mob_data *md;
+	int64 *damage, start, elapsed, total = 0;
+	uint32 hash = 2166136261U;
+	int i, attack_type, misses = 0, criticals = 0;
+
+	if( (md = battlesim_create_mob(scn, m, conf->x + 1, conf->y)) == NULL )
+		return;
+	sd = battlesim_create_pc(scn, m, conf->x, conf->y);
+	attack_type = scn->skill_id ? skill->get_type(scn->skill_id) : BF_WEAPON;
+	if( attack_type == 0 )
+		attack_type = BF_WEAPON;
+
+	CREATE(damage, int64, conf->iterations);
+	sim_rnd_seed(conf->seed);
+	start = timer->microtick();
+	for( i = 0; i < conf->iterations; i++ ) {
+		struct Damage d = battle->calc_attack(attack_type, &sd->bl, &md->bl, scn->skill_id, scn->skill_lv, 0);
+		damage[i] = d.damage + d.damage2;
+		hash = battlesim_hash(hash, &d);
+		if( d.dmg_lv == ATK_FLEE || d.dmg_lv == ATK_MISS )
+			misses++;
+		if( d.type == 0x0a ) // critical, see clif_damage
+			criticals++;
+	}
+	elapsed = max(timer->microtick() - start, 1);
+
+	qsort(damage, conf->iterations, sizeof(int64), battlesim_cmp_int64);
+	for( i = 0; i < conf->iterations; i++ )
+		total += damage[i];
+
+	ShowInfo("battlesim: '"CL_WHITE"%s"CL_RESET"' (%s lv %d vs %s, %s): %d calculations in %.3f s, "CL_WHITE"%.0f/s"CL_RESET"\n",
+		scn->name, scn->skill_id ? skill->get_name(scn->skill_id) : "attack", scn->skill_lv, md->db->name,
+		attack_type&BF_MAGIC ? "magic" : attack_type&BF_MISC ? "misc" : "weapon",
+		conf->iterations, elapsed / 1000000., conf->iterations * 1000000. / elapsed);
+	ShowMessage("    damage min %"PRId64" | p10 %"PRId64" | p50 %"PRId64" | p90 %"PRId64" | p99 %"PRId64" | max %"PRId64" | avg %.1f\n",
+		damage[0], damage[conf->iterations*10/100], damage[conf->iterations/2], damage[conf->iterations*90/100],
+		damage[conf->iterations*99/100], damage[conf->iterations-1], (double)total / conf->iterations);
+	ShowMessage("    misses %.2f%% | criticals %.2f%% | checksum "CL_WHITE"%08x"CL_RESET"\n",
+		misses * 100. / conf->iterations, criticals * 100. / conf->iterations, hash);
+	aFree(damage);
+
+	battlesim_run_calc(conf, sd);
+
+	unit->free(&sd->bl, CLR_OUTSIGHT);
+	aFree(sd);
+	unit->free(&md->bl, CLR_OUTSIGHT);
+}
+
+static void battlesim_run(const char *file) {
+	struct battlesim_config conf;
+	int16 m;
+	int i;
+
+	if( !battlesim_read_config(file, &conf) )
+		return;
+
+	if( (m = map->mapname2mapid(conf.mapname)) < 0 ) {
+		ShowError("battlesim: map '%s' is not loaded on this server.\n", conf.mapname);
+	} else if( conf.count == 0 ) {
+		ShowWarning("battlesim: no scenario in '%s'.\n", file);
+	} else {
+		ShowStatus("battlesim: running %d scenario(s) from '%s', %d calculations each, seed %u.\n", conf.count, file, conf.iterations, conf.seed);
+		map->freeblock_lock();
+		for( i = 0; i < conf.count; i++ )
+			battlesim_run_scenario(&conf, &conf.scenarios[i], m);
+		map->freeblock_unlock();
+	}
+
+	if( conf.scenarios )
+		aFree(conf.scenarios);
+}
+
+CPCMD(battlesim) {
+	battlesim_run(line ? line : BATTLESIM_CONF);
+}
+
+HPExport void plugin_init (void) {
+	iMalloc = GET_SYMBOL("iMalloc");
+	strlib = GET_SYMBOL("strlib");
+	timer = GET_SYMBOL("timer");
+	sim_rnd_seed = GET_SYMBOL("rnd_seed");
+	sim_runflag = GET_SYMBOL("runflag");
+	battle = GET_SYMBOL("battle");
+	itemdb = GET_SYMBOL("itemdb");
+	map = GET_SYMBOL("map");
+	mob = GET_SYMBOL("mob");
+	pc = GET_SYMBOL("pc");
+	script = GET_SYMBOL("script");
+	skill = GET_SYMBOL("skill");
+	status = GET_SYMBOL("status");
+	unit = GET_SYMBOL("unit");
+
+	if( HPMi->addCPCommand != NULL )
+		HPMi->addCPCommand("server:tools:battlesim",CPCMD_A(battlesim));
+}
+
+/* with --run-once, simulate once everything is loaded; the server then exits */
+HPExport void server_online (void) {
+	if( *sim_runflag == CORE_ST_STOP )
+		battlesim_run(BATTLESIM_CONF);
+}
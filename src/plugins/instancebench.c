@@ -0,0 +1,183 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+// Instance benchmark
+//
+// Creates a number of instances from the given source maps, then destroys
+// them, and reports how long creating (instance->create, add_map and start,
+// which duplicates the NPCs) and destroying an instance takes, and how much
+// memory an instance uses: the map structures it allocates, its cell pages
+// (instance maps share the source map's cells until they write to them) and,
+// when the memory manager is enabled, the total allocated meanwhile.
+//
+// Enable "instancebench" in conf/plugins.conf, then run
+//   ./map-server --run-once
+// to create 100 instances of prontera once the server is up and exit, or use
+// the 'server tools instancebench [<count> [<map> ...]]' console command on a
+// running server. An instance takes one 'instance_map_pool' slot per map.
+
+#include "../common/cbasetypes.h"
+#include "../common/core.h"
+#include "../common/malloc.h"
+#include "../common/strlib.h"
+#include "../common/timer.h"
+#include "../common/HPMi.h"
+#include "../map/map.h"
+#include "../map/instance.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HPExport struct hplugin_info pinfo = {
+	"instancebench",		// Plugin name
+	SERVER_TYPE_MAP,// Which server types this plugin works with?
+	"0.1",			// Plugin version
+	HPM_VERSION,	// HPM Version (don't change, macro is automatically updated)
+};
+
+#define INSTANCEBENCH_DEFAULT "100 prontera"
+#define INSTANCEBENCH_MAX_MAPS 16
+
+int *ib_runflag;
+
+static int ib_cmp_int64(const void *a, const void *b) {
+	int64 x = *(const int64*)a, y = *(const int64*)b;
+	return x < y ? -1 : x > y;
+}
+
+/// Bytes allocated for an instance map, besides the map_data slot from the pool.
+static size_t ib_map_bytes(struct map_data *m, int *pages_written) {
+	size_t blocks = m->bxs * m->bys, bytes;
+	int p, pages = map_cell_pages(m);
+
+	bytes = 2 * blocks * sizeof(struct block_list*) + blocks * sizeof(unsigned int); // block, block_mob, block_char
+	bytes += m->unit_count * (sizeof(struct mapflag_skill_adjust*) + sizeof(struct mapflag_skill_adjust));
+	bytes += m->skill_count * (sizeof(struct mapflag_skill_adjust*) + sizeof(struct mapflag_skill_adjust));
+	bytes += m->zone_mf_count * (sizeof(char*) + MAP_ZONE_MAPFLAG_LENGTH);
+	bytes += m->qi_count * sizeof(struct questinfo);
+	if( m->cell_page ) {
+		bytes += pages * sizeof(struct mapcell*);
+		for( p = 0; p < pages; p++ ) {
+			if( m->cell_page[p] ) {
+				bytes += (MAP_CELL_PAGE_MASK + 1) * sizeof(struct mapcell);
+				(*pages_written)++;
+			}
+		}
+	}
+	return bytes;
+}
+
+static void ib_report(const char *what, int64 *us, int count) {
+	int64 total = 0;
+	int i;
+
+	qsort(us, count, sizeof(int64), ib_cmp_int64);
+	for( i = 0; i < count; i++ )
+		total += us[i];
+	ShowMessage("    %s: min %"PRId64" | p50 %"PRId64" | p99 %"PRId64" | max %"PRId64" | avg "CL_WHITE"%.1f"CL_RESET" us\n",
+		what, us[0], us[count/2], us[count*99/100], us[count-1], (double)total / count);
+}
+
+static void ib_run(const char *args) {
+	char buf[256], *names[INSTANCEBENCH_MAX_MAPS], *p;
+	int64 *create_us, *destroy_us, start;
+	int *ids, count, num_maps = 0, created = 0, pages_written = 0, cell_pages = 0, i, j;
+	size_t usage, map_bytes = 0, full_copy = 0;
+
+	safestrncpy(buf, args, sizeof(buf));
+	if( (p = strtok(buf, " \t")) == NULL || (count = atoi(p)) <= 0 ) {
+		ShowError("instancebench: usage: instancebench [<count> [<map> ...]]\n");
+		return;
+	}
+	while( num_maps < INSTANCEBENCH_MAX_MAPS && (p = strtok(NULL, " \t")) != NULL ) {
+		int16 m = map->mapname2mapid(p);
+		if( m < 0 || map->list[m].instance_id >= 0 ) {
+			ShowError("instancebench: '%s' is not a source map loaded on this server.\n", p);
+			return;
+		}
+		names[num_maps++] = p;
+	}
+	if( num_maps == 0 ) {
+		ShowError("instancebench: no source map given.\n");
+		return;
+	}
+
+	CREATE(ids, int, count);
+	CREATE(create_us, int64, count);
+	CREATE(destroy_us, int64, count);
+
+	usage = iMalloc->usage();
+	for( i = 0; i < count; i++ ) {
+		start = timer->microtick();
+		if( (ids[i] = instance->create(0, "instancebench", IOT_NONE)) < 0 )
+			break;
+		for( j = 0; j < num_maps; j++ ) {
+			if( instance->add_map(names[j], ids[i], false, NULL) < 0 )
+				break;
+		}
+		if( j < num_maps ) { // pool used up
+			instance->destroy(ids[i]);
+			break;
+		}
+		instance->start(ids[i]);
+		create_us[i] = timer->microtick() - start;
+		created++;
+	}
+	usage = iMalloc->usage() > usage ? iMalloc->usage() - usage : 0;
+
+	if( created < count )
+		ShowWarning("instancebench: only %d of %d instances could be created ('instance_map_pool' is %d).\n", created, count, map->instance_pool);
+	for( i = 0; i < created; i++ ) {
+		for( j = 0; j < instance->list[ids[i]].num_map; j++ ) {
+			struct map_data *m = &map->list[instance->list[ids[i]].map[j]];
+			map_bytes += ib_map_bytes(m, &pages_written);
+			cell_pages += map_cell_pages(m);
+			full_copy += m->xs * m->ys * sizeof(struct mapcell);
+		}
+	}
+
+	for( i = 0; i < created; i++ ) {
+		start = timer->microtick();
+		instance->destroy(ids[i]);
+		destroy_us[i] = timer->microtick() - start;
+	}
+
+	if( created > 0 ) {
+		ShowInfo("instancebench: %d instance(s) of %d map(s) each:\n", created, num_maps);
+		ib_report("create ", create_us, created);
+		ib_report("destroy", destroy_us, created);
+		ShowMessage("    memory per instance: "CL_WHITE"%lu"CL_RESET" bytes of map structures, %d of %d cell pages written"
+			" (a full cell copy would be %lu bytes), %lu bytes of map_data slots\n",
+			(unsigned long)(map_bytes / created), pages_written / created, cell_pages / created,
+			(unsigned long)(full_copy / created), (unsigned long)(num_maps * sizeof(struct map_data)));
+		if( usage > 0 )
+			ShowMessage("    memory manager: %lu KB allocated per instance, NPC duplicates included\n", (unsigned long)(usage / created));
+	}
+
+	aFree(ids);
+	aFree(create_us);
+	aFree(destroy_us);
+}
+
+CPCMD(instancebench) {
+	ib_run(line ? line : INSTANCEBENCH_DEFAULT);
+}
+
+HPExport void plugin_init (void) {
+	iMalloc = GET_SYMBOL("iMalloc");
+	strlib = GET_SYMBOL("strlib");
+	timer = GET_SYMBOL("timer");
+	ib_runflag = GET_SYMBOL("runflag");
+	instance = GET_SYMBOL("instance");
+	map = GET_SYMBOL("map");
+
+	if( HPMi->addCPCommand != NULL )
+		HPMi->addCPCommand("server:tools:instancebench",CPCMD_A(instancebench));
+}
+
+/* with --run-once, benchmark once everything is loaded; the server then exits */
+HPExport void server_online (void) {
+	if( *ib_runflag == CORE_ST_STOP )
+		ib_run(INSTANCEBENCH_DEFAULT);
+}
@@ -0,0 +1,118 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+// Script cache test
+//
+// Checks that the NPC script cache (npc_script_cache in conf/script.conf)
+// written at boot is used again when the scripts are reloaded, both by
+// @reloadscript and by the per file reload of @reloadnpcfile, and that the
+// environment hash the cache files are keyed by is the same at boot and
+// after a reload, so what a reload writes is used by the next boot.
+//
+// Enable "scriptcachetest" in conf/plugins.conf, then run
+//   ./map-server --run-once
+// The server exits with a failure status if any check fails.
+
+#include "../common/cbasetypes.h"
+#include "../common/core.h"
+#include "../common/HPMi.h"
+#include "../map/map.h"
+#include "../map/npc.h"
+#include "../map/script.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+HPExport struct hplugin_info pinfo = {
+	"scriptcachetest",		// Plugin name
+	SERVER_TYPE_MAP,// Which server types this plugin works with?
+	"0.1",			// Plugin version
+	HPM_VERSION,	// HPM Version (don't change, macro is automatically updated)
+};
+
+int *sct_runflag;
+
+void (*sct_cache_report) (void);
+unsigned int sct_files_loaded, sct_files_parsed;
+
+/// Keeps the counters script->cache_report is about to reset.
+static void sct_cache_report_capture(void) {
+	sct_files_loaded = script->cache.files_loaded;
+	sct_files_parsed = script->cache.files_parsed;
+	sct_cache_report();
+}
+
+static bool sct_check_hits(const char *what) {
+	if( sct_files_parsed != 0 || sct_files_loaded == 0 ) {
+		ShowError("scriptcachetest: %s: %u files loaded from the cache, %u parsed (expected all loaded).\n", what, sct_files_loaded, sct_files_parsed);
+		return false;
+	}
+	ShowInfo("scriptcachetest: %s: all %u files loaded from the cache.\n", what, sct_files_loaded);
+	return true;
+}
+
+static bool sct_check_hash(const char *what, uint32 boot_hash) {
+	uint32 hash;
+
+	script->cache.env_hash = 0;
+	if( (hash = script->cache_env_hash()) != boot_hash ) {
+		ShowError("scriptcachetest: %s: environment hash %08x, %08x at boot.\n", what, hash, boot_hash);
+		return false;
+	}
+	return true;
+}
+
+static void sct_run(void) {
+	struct npc_src_list *file;
+	uint32 boot_hash = script->cache.env_hash;
+	bool ok = true;
+
+	if( !script->config.npc_script_cache || boot_hash == 0 ) {
+		ShowFatalError("scriptcachetest: the script cache wasn't used at boot, enable npc_script_cache.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// item name constants are in str_data now, they weren't during the boot parse
+	ok = sct_check_hash("after boot", boot_hash) && ok;
+
+	// @reloadscript
+	sct_files_loaded = sct_files_parsed = 0;
+	sct_cache_report = script->cache_report;
+	script->cache_report = sct_cache_report_capture;
+	map->reloadnpc(true);
+	script->reload();
+	npc->reload();
+	script->cache_report = sct_cache_report;
+	ok = sct_check_hits("@reloadscript") && ok;
+	ok = sct_check_hash("after @reloadscript", boot_hash) && ok;
+
+	// @reloadnpcfile, every file
+	script->cache.files_loaded = script->cache.files_parsed = 0;
+	for( file = npc->src_files; file != NULL; file = file->next )
+		file->reload = true;
+	npc->reload_files();
+	sct_files_loaded = script->cache.files_loaded;
+	sct_files_parsed = script->cache.files_parsed;
+	script->cache_report();
+	ok = sct_check_hits("@reloadnpcfile") && ok;
+	ok = sct_check_hash("after @reloadnpcfile", boot_hash) && ok;
+
+	if( !ok ) {
+		ShowFatalError("scriptcachetest: failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	ShowStatus("scriptcachetest: passed.\n");
+}
+
+HPExport void plugin_init (void) {
+	sct_runflag = GET_SYMBOL("runflag");
+	map = GET_SYMBOL("map");
+	npc = GET_SYMBOL("npc");
+	script = GET_SYMBOL("script");
+}
+
+/* with --run-once, test once everything is loaded; the server then exits */
+HPExport void server_online (void) {
+	if( *sct_runflag == CORE_ST_STOP )
+		sct_run();
+}
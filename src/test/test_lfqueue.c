@@ -0,0 +1,371 @@
+#include "../common/core.h"
+#include "../common/atomic.h"
+#include "../common/thread.h"
+#include "../common/spinlock.h"
+#include "../common/lfqueue.h"
+#include "../common/timer.h"
+#include "../common/showmsg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef WIN32
+#include <sys/select.h>
+#endif
+
+//
+// Stress test and benchmark for the lock-free queues (lfqueue.c)
+//
+// Every item carries its producer and sequence number, the consumer checks
+// that nothing is lost, duplicated or reordered within a producer.
+//
+
+
+#define ITEMS 4000000 // per run, split between the producers
+#define PRODUCERS 8 // MPSC producer threads
+#define CAPACITY 1024 // small, so the queues wrap and fill up a lot
+#define RUNS 3
+#define WAKEUP_ITEMS 200000
+
+#define ITEM(producer, seq) ((void*)(intptr_t)((producer) * ITEMS + (seq) + 1))
+#define ITEM_PRODUCER(item) ((int)(((intptr_t)(item) - 1) / ITEMS))
+#define ITEM_SEQ(item) ((int)(((intptr_t)(item) - 1) % ITEMS))
+
+
+static spsc_queue spsc;
+static mpsc_queue mpsc;
+static lfq_wakeup wakeup;
+static volatile int32 start_flag = 0;
+static volatile int32 full_count = 0;
+
+// spinlock protected ring, the baseline for the benchmark
+static SPIN_LOCK ring_lock;
+static void *ring[CAPACITY];
+static int ring_head = 0, ring_count = 0;
+
+
+static void wait_start(void){
+	while( InterlockedLoadAcquire(&start_flag) == 0 )
+		rathread_yield();
+}//end: wait_start()
+
+
+static void *spsc_producer(void *p){
+	int i;
+
+	wait_start();
+	for(i = 0; i < ITEMS; i++){
+		while( !spsc_queue_push(spsc, ITEM(0, i)) ){
+			InterlockedIncrement(&full_count);
+			rathread_yield();
+		}
+	}
+
+	return NULL;
+}//end: spsc_producer()
+
+
+static void *mpsc_producer(void *p){
+	int id = (int)(intptr_t)p;
+	int i;
+
+	wait_start();
+	for(i = 0; i < ITEMS/PRODUCERS; i++){
+		while( !mpsc_queue_push(mpsc, ITEM(id, i)) ){
+			InterlockedIncrement(&full_count);
+			rathread_yield();
+		}
+	}
+
+	return NULL;
+}//end: mpsc_producer()
+
+
+static void *ring_producer(void *p){
+	int id = (int)(intptr_t)p;
+	int i;
+
+	wait_start();
+	for(i = 0; i < ITEMS/PRODUCERS; i++){
+		for(;;){
+			bool ok = false;
+			EnterSpinLock(&ring_lock);
+			if( ring_count < CAPACITY ){
+				ring[(ring_head + ring_count) % CAPACITY] = ITEM(id, i);
+				ring_count++;
+				ok = true;
+			}
+			LeaveSpinLock(&ring_lock);
+			if( ok )
+				break;
+			rathread_yield();
+		}
+	}
+
+	return NULL;
+}//end: ring_producer()
+
+
+static void *ring_pop(void){
+	void *item = NULL;
+
+	EnterSpinLock(&ring_lock);
+	if( ring_count ){
+		item = ring[ring_head];
+		ring_head = (ring_head + 1) % CAPACITY;
+		ring_count--;
+	}
+	LeaveSpinLock(&ring_lock);
+
+	return item;
+}//end: ring_pop()
+
+
+/// Starts the producers and consumes ITEMS items, checking their order.
+/// Returns the elapsed microseconds, or -1 on failure.
+static int64 consume(const char *name, rAthreadProc producer, int producers, void *(*pop)(void)){
+	rAthread t[PRODUCERS];
+	int next[PRODUCERS] = { 0 };
+	int64 start;
+	int i, count = 0, total = producers == 1 ? ITEMS : ITEMS/PRODUCERS*PRODUCERS;
+	bool ok = true;
+
+	start_flag = 0;
+	full_count = 0;
+	for(i = 0; i < producers; i++)
+		t[i] = rathread_createEx(producer, (void*)(intptr_t)i, 1024*512, RAT_PRIO_NORMAL);
+
+	start = timer->microtick();
+	InterlockedExchange(&start_flag, 1);
+
+	while( count < total ){
+		void *item = pop();
+		int id, seq;
+
+		if( item == NULL ){
+			rathread_yield();
+			continue;
+		}
+
+		id = ITEM_PRODUCER(item);
+		seq = ITEM_SEQ(item);
+		if( id < 0 || id >= producers || seq != next[id] ){
+			if( ok )
+				ShowError("%s: got item %d of producer %d, expected %d.\n", name, seq, id, id >= 0 && id < producers ? next[id] : -1);
+			ok = false;
+		}
+		if( id >= 0 && id < producers )
+			next[id] = seq + 1;
+		count++;
+	}
+
+	for(i = 0; i < producers; i++)
+		rathread_wait(t[i], NULL);
+
+	if( pop() != NULL ){
+		ShowError("%s: queue not empty after %d items.\n", name, total);
+		ok = false;
+	}
+
+	return ok ? timer->microtick() - start : -1;
+}//end: consume()
+
+
+static void *spsc_pop(void){ return spsc_queue_pop(spsc); }
+static void *mpsc_pop(void){ return mpsc_queue_pop(mpsc); }
+
+
+static bool run_benchmark(const char *name, rAthreadProc producer, int producers, void *(*pop)(void)){
+	int run;
+
+	for(run = 0; run < RUNS; run++){
+		int64 elapsed = consume(name, producer, producers, pop);
+
+		if( elapsed < 0 ){
+			ShowError("%s: run %d FAILED.\n", name, run + 1);
+			return false;
+		}
+		ShowInfo("%s: run %d OK, %d producer(s), %.1f M items/s, producers found the queue full %d times.\n",
+			name, run + 1, producers, ITEMS / (double)max(elapsed, 1), full_count);
+	}
+
+	return true;
+}//end: run_benchmark()
+
+
+#ifndef WIN32
+static void *wakeup_producer(void *p){
+	int i;
+
+	wait_start();
+	for(i = 0; i < WAKEUP_ITEMS; i++){
+		while( !mpsc_queue_push(mpsc, ITEM(0, i)) )
+			rathread_yield();
+		lfq_wakeup_signal(wakeup);
+		if( i % 1000 == 0 )
+			rathread_yield(); // let the consumer fall asleep now and then
+	}
+
+	return NULL;
+}//end: wakeup_producer()
+
+
+/// The consumer only sleeps in select(), like the main loop does.
+static bool run_wakeup(void){
+	rAthread t;
+	int fd, count = 0, wakeups = 0;
+	bool ok = true;
+
+	if( (wakeup = lfq_wakeup_create()) == NULL ){
+		ShowError("wakeup: lfq_wakeup_create failed.\n");
+		return false;
+	}
+	fd = lfq_wakeup_fd(wakeup);
+
+	start_flag = 0;
+	t = rathread_createEx(wakeup_producer, NULL, 1024*512, RAT_PRIO_NORMAL);
+	InterlockedExchange(&start_flag, 1);
+
+	while( count < WAKEUP_ITEMS ){
+		struct timeval timeout = { 2, 0 };
+		fd_set rfd;
+		void *item;
+
+		FD_ZERO(&rfd);
+		FD_SET(fd, &rfd);
+		if( select(fd + 1, &rfd, NULL, NULL, &timeout) <= 0 ){
+			ShowError("wakeup: not woken up within 2 seconds (%d/%d items received).\n", count, WAKEUP_ITEMS);
+			ok = false;
+			break;
+		}
+
+		wakeups++;
+		lfq_wakeup_clear(wakeup);
+		while( (item = mpsc_queue_pop(mpsc)) != NULL ){
+			if( ITEM_SEQ(item) != count ){
+				ShowError("wakeup: got item %d, expected %d.\n", ITEM_SEQ(item), count);
+				ok = false;
+			}
+			count++;
+		}
+	}
+
+	rathread_wait(t, NULL);
+	while( mpsc_queue_pop(mpsc) != NULL )
+		;
+	lfq_wakeup_destroy(wakeup);
+
+	if( ok )
+		ShowInfo("wakeup: OK, %d items in %d wakeups.\n", count, wakeups);
+	return ok;
+}//end: run_wakeup()
+
+
+/// A producer pushing and signalling while the consumer is inside lfq_wakeup_clear.
+static void wakeup_race_hook(lfq_wakeup w){
+	lfq_wakeup_clear_hook = NULL;
+	mpsc_queue_push(mpsc, ITEM(0, 1));
+	lfq_wakeup_signal(w);
+}//end: wakeup_race_hook()
+
+
+static bool wakeup_readable(int fd){
+	struct timeval timeout = { 0, 0 };
+	fd_set rfd;
+
+	FD_ZERO(&rfd);
+	FD_SET(fd, &rfd);
+	return select(fd + 1, &rfd, NULL, NULL, &timeout) > 0;
+}//end: wakeup_readable()
+
+
+/// Forces a signal in the middle of lfq_wakeup_clear: its item has to be drained
+/// right after the clear, and the next signal has to wake the consumer again.
+static bool run_wakeup_race(void){
+	bool ok = true;
+	void *item;
+	int fd;
+
+	if( (wakeup = lfq_wakeup_create()) == NULL ){
+		ShowError("wakeup race: lfq_wakeup_create failed.\n");
+		return false;
+	}
+	fd = lfq_wakeup_fd(wakeup);
+
+	mpsc_queue_push(mpsc, ITEM(0, 0));
+	lfq_wakeup_signal(wakeup);
+
+	lfq_wakeup_clear_hook = wakeup_race_hook;
+	lfq_wakeup_clear(wakeup);
+	lfq_wakeup_clear_hook = NULL;
+	if( (item = mpsc_queue_pop(mpsc)) == NULL || ITEM_SEQ(item) != 0
+	 || (item = mpsc_queue_pop(mpsc)) == NULL || ITEM_SEQ(item) != 1 ){
+		ShowError("wakeup race: the items pushed before and during the clear were not drained.\n");
+		ok = false;
+	}
+
+	mpsc_queue_push(mpsc, ITEM(0, 2));
+	lfq_wakeup_signal(wakeup);
+	if( !wakeup_readable(fd) ){
+		ShowError("wakeup race: a signal after the clear did not wake the consumer (lost wakeup).\n");
+		ok = false;
+	}
+
+	while( mpsc_queue_pop(mpsc) != NULL )
+		;
+	lfq_wakeup_destroy(wakeup);
+
+	if( ok )
+		ShowInfo("wakeup race: OK.\n");
+	return ok;
+}//end: run_wakeup_race()
+#endif
+
+
+int do_init(int argc, char **argv){
+	bool ok = true;
+
+	ShowStatus("==========\n");
+	ShowStatus("TEST: lock-free queues, %d items per run, %d runs\n", ITEMS, RUNS);
+	ShowStatus("This can take a while\n");
+	ShowStatus("\n\n");
+
+	spsc = spsc_queue_create(CAPACITY);
+	mpsc = mpsc_queue_create(CAPACITY);
+	InitializeSpinLock(&ring_lock);
+
+	ok = run_benchmark("spsc", spsc_producer, 1, spsc_pop) && ok;
+	ok = run_benchmark("mpsc", mpsc_producer, PRODUCERS, mpsc_pop) && ok;
+	ok = run_benchmark("spinlock ring (baseline)", ring_producer, PRODUCERS, ring_pop) && ok;
+#ifndef WIN32
+	ok = run_wakeup() && ok;
+	ok = run_wakeup_race() && ok;
+#endif
+
+	FinalizeSpinLock(&ring_lock);
+	spsc_queue_destroy(spsc);
+	mpsc_queue_destroy(mpsc);
+
+	if( !ok ){
+		ShowFatalError("Test failed.\n");
+		exit(1);
+	}else{
+		ShowStatus("Test passed.\n");
+		exit(0);
+	}
+
+
+return 0;
+}//end: do_init()
+
+
+void do_abort(void){
+}//end: do_abort()
+
+
+void set_server_type(void){
+	SERVER_TYPE = SERVER_TYPE_UNKNOWN;
+}//end: set_server_type()
+
+
+void do_final(void){
+}//end: do_final()
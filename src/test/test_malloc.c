@@ -0,0 +1,176 @@
+#include "../common/core.h"
+#include "../common/malloc.h"
+#include "../common/timer.h"
+#include "../common/showmsg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+//
+// Benchmark for the memory manager (malloc.c)
+//
+// Replays an allocation pattern shaped like the server's (mostly small
+// units, some block sized ones, a few large ones) through aMalloc/aFree and
+// through the system allocator, and reports the allocation rate and the
+// resident memory each of them ends up using. Every unit is tagged at both
+// ends and checked before it is freed, so overlapping units fail the test.
+//
+
+
+#define SLOTS 8192 // live units
+#define OPS 4000000 // allocations per run, each one replaces a random live unit
+#define RUNS 3
+#define HUGE_SIZE (3*1024*1024)
+
+struct slot {
+	unsigned char *p;
+	size_t size;
+};
+
+static struct slot slots[SLOTS];
+static uint32 seed;
+
+
+static uint32 next_rand(void){
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}//end: next_rand()
+
+
+/// 75% up to 256 bytes, 22% up to 4KB, 3% up to 40KB.
+static size_t next_size(void){
+	uint32 r = next_rand() % 100;
+
+	if( r < 75 )
+		return 8 + next_rand() % 249;
+	if( r < 97 )
+		return 257 + next_rand() % 3840;
+	return 4097 + next_rand() % 36864;
+}//end: next_size()
+
+
+static void *sys_alloc(size_t size){ return malloc(size); }
+static void sys_free(void *p){ free(p); }
+static void *mm_alloc(size_t size){ return aMalloc(size); }
+static void mm_free(void *p){ aFree(p); }
+
+
+/// @return elapsed microseconds, -1 on corruption
+static int64 run(void *(*alloc)(size_t), void (*release)(void *), size_t *rss_growth){
+	size_t rss = iMalloc->rss();
+	int64 start, elapsed;
+	bool ok = true;
+	int i;
+
+	seed = 1;
+	memset(slots, 0, sizeof(slots));
+	start = timer->microtick();
+	for(i = 0; i < OPS; i++){
+		struct slot *s = &slots[next_rand() % SLOTS];
+		unsigned char tag = (unsigned char)(s - slots);
+
+		if( s->p != NULL ){
+			if( s->p[0] != tag || s->p[s->size - 1] != tag )
+				ok = false;
+			release(s->p);
+		}
+		s->size = next_size();
+		s->p = (unsigned char *)alloc(s->size);
+		s->p[0] = s->p[s->size - 1] = tag;
+	}
+	elapsed = timer->microtick() - start;
+
+	*rss_growth = iMalloc->rss() > rss ? iMalloc->rss() - rss : 0;
+	for(i = 0; i < SLOTS; i++){
+		if( slots[i].p != NULL ){
+			if( slots[i].p[0] != (unsigned char)i || slots[i].p[slots[i].size - 1] != (unsigned char)i )
+				ok = false;
+			release(slots[i].p);
+		}
+	}
+
+	return ok ? max(elapsed, 1) : -1;
+}//end: run()
+
+
+static bool run_benchmark(const char *name, void *(*alloc)(size_t), void (*release)(void *)){
+	int r;
+
+	for(r = 0; r < RUNS; r++){
+		size_t rss_growth;
+		int64 elapsed = run(alloc, release, &rss_growth);
+
+		if( elapsed < 0 ){
+			ShowError("%s: run %d FAILED, a unit was overwritten.\n", name, r + 1);
+			return false;
+		}
+		ShowInfo("%s: run %d OK, %.2f M allocations/s, resident memory grew by %.2f MB.\n",
+			name, r + 1, OPS / (double)elapsed, rss_growth / 1024. / 1024.);
+	}
+
+	return true;
+}//end: run_benchmark()
+
+
+/// Large units get their own mapping, aligned so it can be backed by huge pages.
+static bool run_huge(void){
+	unsigned char *p = (unsigned char *)aMalloc(HUGE_SIZE);
+	bool ok = true;
+
+	memset(p, 0x5a, HUGE_SIZE);
+	if( p[0] != 0x5a || p[HUGE_SIZE - 1] != 0x5a )
+		ok = false;
+#if defined(USE_MEMMGR) && defined(__linux__) && defined(MADV_HUGEPAGE)
+	if( ((uintptr_t)p & (2*1024*1024 - 1)) > 256 ){ // the unit header comes first
+		ShowError("huge: a %d byte unit at %p is not at the start of a 2MB aligned area.\n", HUGE_SIZE, p);
+		ok = false;
+	}
+#endif
+	aFree(p);
+
+	if( ok )
+		ShowInfo("huge: OK.\n");
+	return ok;
+}//end: run_huge()
+
+
+int do_init(int argc, char **argv){
+	bool ok = true;
+
+	ShowStatus("==========\n");
+	ShowStatus("TEST: memory manager, %d allocations per run with %d live units, %d runs\n", OPS, SLOTS, RUNS);
+	ShowStatus("This can take a while\n");
+	ShowStatus("\n\n");
+
+	ok = run_benchmark("system malloc (baseline)", sys_alloc, sys_free) && ok;
+	ok = run_benchmark("aMalloc", mm_alloc, mm_free) && ok;
+	ok = run_huge() && ok;
+
+	if( !ok ){
+		ShowFatalError("Test failed.\n");
+		exit(1);
+	}else{
+		ShowStatus("Test passed.\n");
+		exit(0);
+	}
+
+
+return 0;
+}//end: do_init()
+
+
+void do_abort(void){
+}//end: do_abort()
+
+
+void set_server_type(void){
+	SERVER_TYPE = SERVER_TYPE_UNKNOWN;
+}//end: set_server_type()
+
+
+void do_final(void){
+}//end: do_final()
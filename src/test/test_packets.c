@@ -0,0 +1,154 @@
+#include "../common/core.h"
+#include "../common/showmsg.h"
+#include "../map/packets_struct.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// Checks the packet structs of packets_struct.h against packets.h
+//
+// Both are selected by PACKETVER, so this checks the PACKETVER the test
+// was built for: every struct must be as long as packets.h says its
+// packet is, variable length packets must start with their length.
+//
+
+
+#define MAX_PACKET 0x0F00 // same as MAX_PACKET_DB in clif.h
+
+static short packet_len_table[MAX_PACKET + 1];
+
+#define PACKET_STRUCT(type, name) { #name, (type), sizeof(struct name) }
+
+static const struct {
+	const char *name;
+	int type;
+	size_t size;
+} packet_structs[] = {
+	PACKET_STRUCT(authokType, packet_authok),
+	PACKET_STRUCT(monsterhpType, packet_monster_hp),
+	PACKET_STRUCT(sc_notickType, packet_sc_notick),
+	PACKET_STRUCT(additemType, packet_additem),
+	PACKET_STRUCT(dropflooritemType, packet_dropflooritem),
+#if PACKETVER < 20080827
+	PACKET_STRUCT(spawn_unit2Type, packet_spawn_unit2),
+#endif
+#if PACKETVER < 20091103
+	PACKET_STRUCT(idle_unit2Type, packet_idle_unit2),
+#endif
+	PACKET_STRUCT(spawn_unitType, packet_spawn_unit),
+	PACKET_STRUCT(unit_walkingType, packet_unit_walking),
+	PACKET_STRUCT(idle_unitType, packet_idle_unit),
+	PACKET_STRUCT(status_changeType, packet_status_change),
+	PACKET_STRUCT(status_change_endType, packet_status_change_end),
+#if PACKETVER >= 20090121
+	PACKET_STRUCT(status_change2Type, packet_status_change2),
+#endif
+	PACKET_STRUCT(maptypeproperty2Type, packet_maptypeproperty2),
+	PACKET_STRUCT(bgqueue_ackType, packet_bgqueue_ack),
+	PACKET_STRUCT(bgqueue_notice_deleteType, packet_bgqueue_notice_delete),
+	PACKET_STRUCT(bgqueue_registerType, packet_bgqueue_register),
+	PACKET_STRUCT(bgqueue_updateinfoType, packet_bgqueue_update_info),
+	PACKET_STRUCT(bgqueue_checkstateType, packet_bgqueue_checkstate),
+	PACKET_STRUCT(bgqueue_revokereqType, packet_bgqueue_revoke_req),
+	PACKET_STRUCT(bgqueue_battlebeginackType, packet_bgqueue_battlebegin_ack),
+	PACKET_STRUCT(bgqueue_notify_entryType, packet_bgqueue_notify_entry),
+	PACKET_STRUCT(bgqueue_battlebegins, packet_bgqueue_battlebegins),
+	PACKET_STRUCT(script_clearType, packet_script_clear),
+	PACKET_STRUCT(package_item_announceType, packet_package_item_announce),
+	PACKET_STRUCT(cart_additem_ackType, packet_cart_additem_ack),
+	PACKET_STRUCT(banking_checkType, packet_banking_check),
+	PACKET_STRUCT(banking_deposit_ackType, packet_banking_deposit_ack),
+	PACKET_STRUCT(banking_withdraw_ackType, packet_banking_withdraw_ack),
+	PACKET_STRUCT(inventorylistnormalType, packet_itemlist_normal),
+	PACKET_STRUCT(inventorylistequipType, packet_itemlist_equip),
+	PACKET_STRUCT(storagelistnormalType, packet_storelist_normal),
+	PACKET_STRUCT(storagelistequipType, packet_storelist_equip),
+	PACKET_STRUCT(cartlistnormalType, packet_itemlist_normal),
+	PACKET_STRUCT(cartlistequipType, packet_itemlist_equip),
+	PACKET_STRUCT(equipitemType, packet_equip_item),
+	PACKET_STRUCT(equipitemackType, packet_equipitem_ack),
+	PACKET_STRUCT(unequipitemackType, packet_unequipitem_ack),
+	PACKET_STRUCT(viewequipackType, packet_viewequip_ack),
+	PACKET_STRUCT(damageType, packet_damage),
+	PACKET_STRUCT(skill_damageType, packet_skill_damage),
+	PACKET_STRUCT(notify_moveType, packet_notify_move),
+	PACKET_STRUCT(notify_playermoveType, packet_notify_playermove),
+	PACKET_STRUCT(stopmoveType, packet_stopmove),
+};
+
+
+static void test_addpacket(int id, int len) {
+	if( id < 0 || id > MAX_PACKET ) {
+		ShowError("packets.h: packet 0x%04x out of range.\n", id);
+		return;
+	}
+	packet_len_table[id] = (short)len; // the last definition is the one of our PACKETVER
+}//end: test_addpacket()
+
+
+static void test_packetdb(void) {
+	#define packet(id, size, ...) test_addpacket((id), (size))
+	#define packetKeys(a,b,c)
+	#include "../map/packets.h"
+	#undef packet
+	#undef packetKeys
+}//end: test_packetdb()
+
+
+int do_init(int argc, char **argv){
+	int i, checked = 0, failed = 0;
+
+	ShowStatus("==========\n");
+	ShowStatus("TEST: packet structs against packets.h, PACKETVER %d\n", PACKETVER);
+	ShowStatus("\n\n");
+
+	test_packetdb();
+
+	for( i = 0; i < ARRAYLENGTH(packet_structs); i++ ){
+		int len = packet_len_table[packet_structs[i].type];
+
+		if( len == 0 ){
+			ShowInfo("%s: packet 0x%04x not used with this PACKETVER, skipped.\n", packet_structs[i].name, packet_structs[i].type);
+			continue;
+		}
+		checked++;
+		if( len == -1 ){// variable length, the struct is the maximum
+			if( packet_structs[i].size < 4 ){
+				ShowError("%s: packet 0x%04x has a variable length, but the struct has no room for it (%d bytes).\n",
+					packet_structs[i].name, packet_structs[i].type, (int)packet_structs[i].size);
+				failed++;
+			}
+			continue;
+		}
+		if( (size_t)len != packet_structs[i].size ){
+			ShowError("%s: packet 0x%04x is %d bytes in packets.h, the struct has %d.\n",
+				packet_structs[i].name, packet_structs[i].type, len, (int)packet_structs[i].size);
+			failed++;
+		}
+	}
+
+	if( failed ){
+		ShowFatalError("Test failed: %d of %d structs don't match.\n", failed, checked);
+		exit(1);
+	}else{
+		ShowStatus("Test passed: %d structs checked.\n", checked);
+		exit(0);
+	}
+
+
+return 0;
+}//end: do_init()
+
+
+void do_abort(void){
+}//end: do_abort()
+
+
+void set_server_type(void){
+	SERVER_TYPE = SERVER_TYPE_UNKNOWN;
+}//end: set_server_type()
+
+
+void do_final(void){
+}//end: do_final()
@@ -0,0 +1,909 @@
+// Copyright (c) Hercules Dev Team, licensed under GNU GPL.
+// See the LICENSE file
+
+/**
+ * Headless load generator.
+ * Logs bot accounts in through the login, char and map servers and has them
+ * walk, attack, chat and cast skills following the profiles in loadgen.conf.
+ * Reports the tick synchronization round trip (how long the map server takes
+ * to get to a client's packet) as percentiles, and packets/bytes per second.
+ *
+ * Packet ids and field offsets come from src/map/packets.h, so the tool speaks
+ * the PACKETVER it was built with. Bot accounts and characters are created with
+ * `loadgen --sql <count>`, whose output is imported into the server database.
+ * Linux only (epoll).
+ **/
+
+#include "../common/cbasetypes.h"
+#include "../common/core.h"
+#include "../common/malloc.h"
+#include "../common/mmo.h"
+#include "../common/showmsg.h"
+#include "../common/socket.h"
+#include "../common/strlib.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define LOADGEN_MAX_PACKET 0x0F00
+#define LOADGEN_MAX_PROFILES 16
+#define LOADGEN_RBUF 65536
+
+enum bot_state {
+	BOT_OFFLINE,
+	BOT_LOGIN,    // waiting for the account to be accepted
+	BOT_CHAR,     // waiting for the character list / zone server
+	BOT_MAP_AUTH, // waiting for the map server to accept the character
+	BOT_MAP,      // in game
+};
+
+/// Client packets the bots send, located in packets.h by their clif handler
+enum bot_cpacket {
+	CP_WANTTOCONNECTION,
+	CP_LOADENDACK,
+	CP_TICKSEND,
+	CP_WALKTOXY,
+	CP_ACTIONREQUEST,
+	CP_GLOBALMESSAGE,
+	CP_USESKILLTOID,
+	CP_RESTART,
+	CP_GUILDMESSAGE,
+	CP_MAX
+};
+
+struct bot_cpacket_info {
+	const char *func;
+	int id;
+	int len;
+	int pos[8];
+};
+
+struct bot_profile {
+	char name[32];
+	int weight;
+	int interval; // ms between actions
+	int walk, attack, chat, skill; // action weights
+	int skill_id, skill_lv;
+	int radius; // max. walk distance
+};
+
+struct bot {
+	int fd;
+	enum bot_state state;
+	struct bot_profile *profile;
+	char userid[NAME_LENGTH];
+	uint8 *rbuf;
+	size_t rlen;
+	uint8 *wbuf;
+	size_t wlen, wmax;
+	bool connected;
+	bool char_aid; // char server's leading account id was received
+	bool char_selected;
+	int account_id, char_id, login_id1, login_id2;
+	uint8 sex;
+	uint16 port;
+	short x, y;
+	uint32 crypt_key;
+	int64 next_action;
+	int64 next_tick;
+	int64 tick_sent;
+	int64 retry_tick;
+};
+
+static struct bot_cpacket_info cpacket[CP_MAX] = {
+	{ "clif->pWantToConnection" },
+	{ "clif->pLoadEndAck" },
+	{ "clif->pTickSend" },
+	{ "clif->pWalkToXY" },
+	{ "clif->pActionRequest" },
+	{ "clif->pGlobalMessage" },
+	{ "clif->pUseSkillToId" },
+	{ "clif->pRestart" },
+	{ "clif->pGuildMessage" },
+};
+static short packet_len_table[LOADGEN_MAX_PACKET + 1];
+static uint32 packet_keys[3];
+
+// configuration
+static char conf_file[256] = "conf/loadgen.conf";
+static char login_ip[64] = "127.0.0.1";
+static uint16 login_port = 6900;
+static char server_ip[64] = "127.0.0.1"; // char and map servers, the addresses they announce are ignored
+static char account_prefix[NAME_LENGTH] = "lgbot";
+static char password[NAME_LENGTH] = "lgbot";
+static int bot_count = 100;
+static int connect_rate = 50; // logins started per second
+static int client_version = 20;
+static int report_interval = 10;
+static int duration = 0; // seconds, 0 = until interrupted
+static bool obfuscation = false;
+static int guild_chat = 0; // % of the chat actions that go to the guild
+static struct bot_profile profiles[LOADGEN_MAX_PROFILES];
+static int profile_count = 0, profile_weight = 0;
+// --sql output
+static int sql_count = 0;
+static int sql_account_id = 2100000;
+static char sql_map[8][MAP_NAME_LENGTH_EXT] = { "prontera" }; // characters are spread over these in turn
+static int sql_map_count = 1;
+static int sql_x = 156, sql_y = 180, sql_class = 4;
+static int sql_guild_size = 0, sql_guild_id = 21000;
+
+static struct bot *bots;
+static int epoll_fd = -1;
+static volatile sig_atomic_t loadgen_stop = 0;
+
+// statistics, reset on every report
+static struct {
+	uint64 sent_packets, sent_bytes;
+	uint64 recv_packets, recv_bytes;
+	unsigned int logins, failures;
+	int64 *rtt;
+	int rtt_count, rtt_max;
+} stats;
+
+static int64 loadgen_tick(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*==========================================
+ * Packet database, loaded from packets.h
+ *------------------------------------------*/
+static void loadgen_addpacket(int id, int len, const char *args) {
+	int i;
+	const char *p;
+
+	if( id < 0 || id > LOADGEN_MAX_PACKET )
+		return;
+	// the table is used for what the server sends, entries without a handler take precedence
+	if( !*args || !packet_len_table[id] )
+		packet_len_table[id] = (short)len;
+
+	for( i = 0; i < CP_MAX; i++ ) {
+		size_t n = strlen(cpacket[i].func);
+		int k;
+
+		if( strncmp(args, cpacket[i].func, n) != 0 || (args[n] != ',' && args[n] != '\0') )
+			continue;
+
+		// the last definition is the one of our PACKETVER
+		cpacket[i].id = id;
+		cpacket[i].len = len;
+		memset(cpacket[i].pos, 0, sizeof(cpacket[i].pos));
+		for( k = 0, p = args + n; *p == ',' && k < ARRAYLENGTH(cpacket[i].pos); k++ ) {
+			cpacket[i].pos[k] = (int)strtol(p + 1, (char**)&p, 0);
+			while( *p == ' ' )
+				p++;
+		}
+		break;
+	}
+}
+
+static void loadgen_packetdb(void) {
+	int i;
+
+	#define packet(id, size, ...) loadgen_addpacket((id), (size), #__VA_ARGS__)
+	#define packetKeys(a,b,c) { packet_keys[0] = (a); packet_keys[1] = (b); packet_keys[2] = (c); }
+	#include "../map/packets.h"
+	#undef packet
+	#undef packetKeys
+
+	// char server packets, not part of packets.h
+	packet_len_table[0x081] = 3;
+	packet_len_table[0x06b] = -1;
+	packet_len_table[0x06c] = 3;
+	packet_len_table[0x071] = 28;
+	packet_len_table[0x20d] = -1;
+	packet_len_table[0x82d] = -1;
+	packet_len_table[0x8d5] = -1;
+	packet_len_table[0x8b9] = 12;
+	packet_len_table[0x99d] = -1;
+
+	for( i = 0; i < CP_MAX; i++ ) {
+		if( !cpacket[i].id ) {
+			ShowFatalError("loadgen: '%s' not found in packets.h for PACKETVER %d.\n", cpacket[i].func, PACKETVER);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*==========================================
+ * Configuration
+ *------------------------------------------*/
+static void loadgen_profile(const char *value) {
+	struct bot_profile *p;
+
+	if( profile_count == LOADGEN_MAX_PROFILES ) {
+		ShowWarning("loadgen: too many profiles, '%s' ignored.\n", value);
+		return;
+	}
+
+	p = &profiles[profile_count];
+	memset(p, 0, sizeof(*p));
+	if( sscanf(value, "%31[^,], %d, %d, %d, %d, %d, %d, %d, %d, %d", p->name, &p->weight, &p->interval, &p->walk, &p->attack, &p->chat, &p->skill, &p->skill_id, &p->skill_lv, &p->radius) < 7 ) {
+		ShowWarning("loadgen: invalid profile '%s'.\n", value);
+		return;
+	}
+	p->interval = max(p->interval, 100);
+	p->radius = p->radius > 0 ? p->radius : 10;
+	if( p->weight <= 0 || p->walk + p->attack + p->chat + p->skill <= 0 )
+		return;
+	profile_weight += p->weight;
+	profile_count++;
+}
+
+static int loadgen_config_read(const char *cfgName) {
+	char line[1024], w1[1024], w2[1024];
+	FILE *fp;
+
+	if( (fp = fopen(cfgName, "r")) == NULL ) {
+		ShowError("loadgen: configuration file not found at '%s'.\n", cfgName);
+		return 1;
+	}
+
+	while( fgets(line, sizeof(line), fp) ) {
+		if( line[0] == '/' && line[1] == '/' )
+			continue;
+		if( sscanf(line, "%[^:]: %[^\r\n]", w1, w2) != 2 )
+			continue;
+
+		if( !strcmpi(w1, "login_ip") )
+			safestrncpy(login_ip, w2, sizeof(login_ip));
+		else if( !strcmpi(w1, "login_port") )
+			login_port = (uint16)atoi(w2);
+		else if( !strcmpi(w1, "server_ip") )
+			safestrncpy(server_ip, w2, sizeof(server_ip));
+		else if( !strcmpi(w1, "account_prefix") )
+			safestrncpy(account_prefix, w2, sizeof(account_prefix));
+		else if( !strcmpi(w1, "password") )
+			safestrncpy(password, w2, sizeof(password));
+		else if( !strcmpi(w1, "bots") )
+			bot_count = max(atoi(w2), 1);
+		else if( !strcmpi(w1, "connect_rate") )
+			connect_rate = max(atoi(w2), 1);
+		else if( !strcmpi(w1, "client_version") )
+			client_version = atoi(w2);
+		else if( !strcmpi(w1, "report_interval") )
+			report_interval = max(atoi(w2), 1);
+		else if( !strcmpi(w1, "duration") )
+			duration = max(atoi(w2), 0);
+		else if( !strcmpi(w1, "packet_obfuscation") )
+			obfuscation = config_switch(w2) ? true : false;
+		else if( !strcmpi(w1, "guild_chat") )
+			guild_chat = max(0, min(atoi(w2), 100));
+		else if( !strcmpi(w1, "profile") )
+			loadgen_profile(w2);
+		else if( !strcmpi(w1, "sql_account_id") )
+			sql_account_id = atoi(w2);
+		else if( !strcmpi(w1, "sql_map") ) {
+			char *map_name = strtok(w2, ", ");
+			for( sql_map_count = 0; map_name && sql_map_count < ARRAYLENGTH(sql_map); map_name = strtok(NULL, ", ") )
+				safestrncpy(sql_map[sql_map_count++], map_name, sizeof(sql_map[0]));
+			if( sql_map_count == 0 )
+				sql_map_count = 1; // keep the first one
+		}
+		else if( !strcmpi(w1, "sql_x") )
+			sql_x = atoi(w2);
+		else if( !strcmpi(w1, "sql_y") )
+			sql_y = atoi(w2);
+		else if( !strcmpi(w1, "sql_class") )
+			sql_class = atoi(w2);
+		else if( !strcmpi(w1, "sql_guild_size") )
+			sql_guild_size = max(0, min(atoi(w2), 16));
+		else if( !strcmpi(w1, "sql_guild_id") )
+			sql_guild_id = atoi(w2);
+		else if( !strcmpi(w1, "import") )
+			loadgen_config_read(w2);
+		else
+			ShowWarning("Unknown setting '%s' in file %s\n", w1, cfgName);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/*==========================================
+ * Connections
+ *------------------------------------------*/
+static void bot_close(struct bot *b, bool failed) {
+	if( b->fd >= 0 ) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, b->fd, NULL);
+		close(b->fd);
+		b->fd = -1;
+	}
+	if( failed ) {
+		stats.failures++;
+		b->retry_tick = loadgen_tick() + 5000;
+		b->state = BOT_OFFLINE;
+	}
+	b->rlen = b->wlen = 0;
+	b->connected = false;
+}
+
+static bool bot_connect(struct bot *b, const char *ip, uint16 port) {
+	struct sockaddr_in addr;
+	struct epoll_event ev;
+	int yes = 1;
+
+	bot_close(b, false);
+
+	if( (b->fd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ) {
+		ShowError("loadgen: socket failed (%s).\n", strerror(errno));
+		return false;
+	}
+	fcntl(b->fd, F_SETFL, fcntl(b->fd, F_GETFL) | O_NONBLOCK);
+	setsockopt(b->fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr(ip);
+	if( connect(b->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS ) {
+		bot_close(b, true);
+		return false;
+	}
+
+	ev.events = EPOLLIN|EPOLLOUT;
+	ev.data.ptr = b;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, b->fd, &ev);
+	return true;
+}
+
+static void bot_flush(struct bot *b) {
+	struct epoll_event ev;
+	ssize_t len;
+
+	if( b->fd < 0 || !b->connected || !b->wlen )
+		return;
+
+	len = send(b->fd, b->wbuf, b->wlen, MSG_NOSIGNAL);
+	if( len < 0 ) {
+		if( errno != EAGAIN && errno != EWOULDBLOCK )
+			bot_close(b, true);
+		return;
+	}
+
+	stats.sent_bytes += len;
+	if( (size_t)len < b->wlen )
+		memmove(b->wbuf, b->wbuf + len, b->wlen - len);
+	b->wlen -= len;
+
+	ev.events = EPOLLIN | (b->wlen ? EPOLLOUT : 0);
+	ev.data.ptr = b;
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, b->fd, &ev);
+}
+
+/// Reserves len bytes at the end of the bot's send buffer.
+static uint8* bot_packet(struct bot *b, size_t len) {
+	uint8 *p;
+
+	if( b->wlen + len > b->wmax ) {
+		b->wmax = b->wlen + len + 1024;
+		RECREATE(b->wbuf, uint8, b->wmax);
+	}
+	p = b->wbuf + b->wlen;
+	memset(p, 0, len);
+	b->wlen += len;
+	stats.sent_packets++;
+	return p;
+}
+
+/// Reserves a map server packet, with the packet id obfuscated when enabled.
+static uint8* bot_cpacket(struct bot *b, enum bot_cpacket type, size_t len) {
+	uint8 *p = bot_packet(b, len);
+	uint16 cmd = (uint16)cpacket[type].id;
+
+	if( obfuscation ) {
+		cmd ^= (b->crypt_key >> 16) & 0x7FFF;
+		b->crypt_key = b->crypt_key * packet_keys[1] + packet_keys[2];
+	}
+	WBUFW(p,0) = cmd;
+	return p;
+}
+
+/*==========================================
+ * Requests
+ *------------------------------------------*/
+static void bot_login(struct bot *b) {
+	uint8 *p;
+
+	if( !bot_connect(b, login_ip, login_port) )
+		return;
+
+	b->state = BOT_LOGIN;
+	p = bot_packet(b, 55);
+	WBUFW(p,0) = 0x64;
+	WBUFL(p,2) = client_version;
+	safestrncpy((char*)WBUFP(p,6), b->userid, NAME_LENGTH);
+	safestrncpy((char*)WBUFP(p,30), password, NAME_LENGTH);
+	WBUFB(p,54) = 0;
+}
+
+static void bot_char(struct bot *b) {
+	uint8 *p;
+
+	if( !bot_connect(b, server_ip, b->port) )
+		return;
+
+	b->state = BOT_CHAR;
+	b->char_aid = b->char_selected = false;
+	p = bot_packet(b, 17);
+	WBUFW(p,0) = 0x65;
+	WBUFL(p,2) = b->account_id;
+	WBUFL(p,6) = b->login_id1;
+	WBUFL(p,10) = b->login_id2;
+	WBUFB(p,16) = b->sex;
+}
+
+static void bot_map(struct bot *b) {
+	const struct bot_cpacket_info *c = &cpacket[CP_WANTTOCONNECTION];
+	uint8 *p;
+
+	if( !bot_connect(b, server_ip, b->port) )
+		return;
+
+	b->state = BOT_MAP_AUTH;
+	b->crypt_key = packet_keys[0] * packet_keys[1] + packet_keys[2];
+	p = bot_cpacket(b, CP_WANTTOCONNECTION, c->len);
+	WBUFL(p,c->pos[0]) = b->account_id;
+	WBUFL(p,c->pos[1]) = b->char_id;
+	WBUFL(p,c->pos[2]) = b->login_id1;
+	WBUFL(p,c->pos[3]) = (uint32)loadgen_tick();
+	WBUFB(p,c->pos[4]) = b->sex;
+}
+
+static void bot_loadendack(struct bot *b) {
+	bot_cpacket(b, CP_LOADENDACK, cpacket[CP_LOADENDACK].len);
+}
+
+static void bot_ticksend(struct bot *b, int64 tick) {
+	uint8 *p = bot_cpacket(b, CP_TICKSEND, cpacket[CP_TICKSEND].len);
+	WBUFL(p,cpacket[CP_TICKSEND].pos[0]) = (uint32)tick;
+	b->tick_sent = tick;
+}
+
+/// Any other bot that is in game, or the bot itself.
+static struct bot* bot_target(struct bot *b) {
+	int i;
+
+	for( i = 0; i < 8; i++ ) {
+		struct bot *t = &bots[rand() % bot_count];
+		if( t != b && t->state == BOT_MAP )
+			return t;
+	}
+	return b;
+}
+
+static void bot_act(struct bot *b, int64 tick) {
+	struct bot_profile *pr = b->profile;
+	int r = rand() % (pr->walk + pr->attack + pr->chat + pr->skill);
+	uint8 *p;
+
+	if( (r -= pr->walk) < 0 ) {
+		const struct bot_cpacket_info *c = &cpacket[CP_WALKTOXY];
+		short x = (short)max(1, min(b->x + (int)(rand() % (2*pr->radius+1)) - pr->radius, 1023));
+		short y = (short)max(1, min(b->y + (int)(rand() % (2*pr->radius+1)) - pr->radius, 1023));
+		p = bot_cpacket(b, CP_WALKTOXY, c->len);
+		WBUFB(p,c->pos[0]+0) = (uint8)(x>>2);
+		WBUFB(p,c->pos[0]+1) = (uint8)((x<<6) | ((y>>4)&0x3f));
+		WBUFB(p,c->pos[0]+2) = (uint8)(y<<4);
+	} else if( (r -= pr->attack) < 0 ) {
+		const struct bot_cpacket_info *c = &cpacket[CP_ACTIONREQUEST];
+		p = bot_cpacket(b, CP_ACTIONREQUEST, c->len);
+		WBUFL(p,c->pos[0]) = bot_target(b)->account_id;
+		WBUFB(p,c->pos[1]) = 7; // continuous attack
+	} else if( (r -= pr->chat) < 0 ) {
+		enum bot_cpacket type = rand() % 100 < guild_chat ? CP_GUILDMESSAGE : CP_GLOBALMESSAGE;
+		const struct bot_cpacket_info *c = &cpacket[type];
+		char message[128];
+		int len = snprintf(message, sizeof(message), "%s : load test %u", b->userid, (unsigned int)(tick & 0xffff)) + 1;
+		p = bot_cpacket(b, type, c->pos[1] + len);
+		WBUFW(p,c->pos[0]) = c->pos[1] + len;
+		memcpy(WBUFP(p,c->pos[1]), message, len);
+	} else if( pr->skill_id ) {
+		const struct bot_cpacket_info *c = &cpacket[CP_USESKILLTOID];
+		p = bot_cpacket(b, CP_USESKILLTOID, c->len);
+		WBUFW(p,c->pos[0]) = pr->skill_lv;
+		WBUFW(p,c->pos[1]) = pr->skill_id;
+		WBUFL(p,c->pos[2]) = bot_target(b)->account_id;
+	}
+}
+
+/*==========================================
+ * Responses
+ *------------------------------------------*/
+static void bot_parse_login(struct bot *b, const uint8 *p) {
+	switch( RBUFW(p,0) ) {
+		case 0x69:
+			if( RBUFW(p,2) < 47 + 32 ) { // no char server
+				bot_close(b, true);
+				return;
+			}
+			b->login_id1 = RBUFL(p,4);
+			b->account_id = RBUFL(p,8);
+			b->login_id2 = RBUFL(p,12);
+			b->sex = RBUFB(p,46);
+			b->port = RBUFW(p,47+4);
+			bot_char(b);
+			break;
+		default: // refused
+			bot_close(b, true);
+			break;
+	}
+}
+
+static void bot_parse_char(struct bot *b, const uint8 *p) {
+	switch( RBUFW(p,0) ) {
+		case 0x6b:
+		case 0x82d:
+		case 0x99d:
+		case 0x8b9:
+			if( RBUFW(p,0) == 0x8b9 && RBUFW(p,10) != 0 ) { // pincode required
+				bot_close(b, true);
+				break;
+			}
+			if( !b->char_selected ) {
+				uint8 *w = bot_packet(b, 3);
+				WBUFW(w,0) = 0x66;
+				WBUFB(w,2) = 0; // first slot
+				b->char_selected = true;
+			}
+			break;
+		case 0x71:
+			b->char_id = RBUFL(p,2);
+			b->port = RBUFW(p,26);
+			bot_map(b);
+			break;
+		case 0x6c:
+		case 0x81:
+			bot_close(b, true);
+			break;
+	}
+}
+
+static void bot_parse_map(struct bot *b, const uint8 *p, int64 tick) {
+	switch( RBUFW(p,0) ) {
+		case 0x73: // ZC_ACCEPT_ENTER
+		case 0x2eb: // ZC_ACCEPT_ENTER2
+			b->x = (short)((RBUFB(p,6)<<2) | (RBUFB(p,7)>>6));
+			b->y = (short)(((RBUFB(p,7)&0x3f)<<4) | (RBUFB(p,8)>>4));
+			bot_loadendack(b);
+			b->state = BOT_MAP;
+			b->next_action = tick + rand() % b->profile->interval;
+			b->next_tick = tick;
+			stats.logins++;
+			break;
+		case 0x74: // ZC_REFUSE_ENTER
+			bot_close(b, true);
+			break;
+		case 0x7f: // ZC_NOTIFY_TIME
+			if( b->tick_sent ) {
+				if( stats.rtt_count == stats.rtt_max ) {
+					stats.rtt_max += 1024;
+					RECREATE(stats.rtt, int64, stats.rtt_max);
+				}
+				stats.rtt[stats.rtt_count++] = tick - b->tick_sent;
+				b->tick_sent = 0;
+			}
+			break;
+		case 0x87: // ZC_NOTIFY_PLAYERMOVE, destination
+			b->x = (short)(((RBUFB(p,8)&0x0f)<<6) | (RBUFB(p,9)>>2));
+			b->y = (short)(((RBUFB(p,9)&0x03)<<8) | RBUFB(p,10));
+			break;
+		case 0x80: // ZC_NOTIFY_VANISH
+			if( (int)RBUFL(p,2) == b->account_id && RBUFB(p,6) == 1 ) { // died, respawn
+				uint8 *w = bot_cpacket(b, CP_RESTART, cpacket[CP_RESTART].len);
+				WBUFB(w,cpacket[CP_RESTART].pos[0]) = 0;
+			}
+			break;
+		case 0x91: // ZC_NPCACK_MAPMOVE
+			b->x = RBUFW(p,18);
+			b->y = RBUFW(p,20);
+			bot_loadendack(b);
+			break;
+		case 0x92: // ZC_NPCACK_SERVERMOVE
+			bot_close(b, false);
+			b->state = BOT_OFFLINE;
+			b->retry_tick = tick;
+			break;
+	}
+}
+
+static void bot_recv(struct bot *b, int64 tick) {
+	ssize_t len;
+	size_t pos = 0;
+
+	len = recv(b->fd, b->rbuf + b->rlen, LOADGEN_RBUF - b->rlen, 0);
+	if( len <= 0 ) {
+		if( len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) )
+			bot_close(b, b->state != BOT_OFFLINE);
+		return;
+	}
+	b->rlen += len;
+	stats.recv_bytes += len;
+
+	if( b->state == BOT_CHAR && !b->char_aid ) { // the char server leads with the raw account id
+		if( b->rlen < 4 )
+			return;
+		b->char_aid = true;
+		pos = 4;
+	}
+
+	while( b->fd >= 0 && b->rlen - pos >= 2 ) {
+		const uint8 *p = b->rbuf + pos;
+		int cmd = RBUFW(p,0);
+		int plen = cmd <= LOADGEN_MAX_PACKET ? packet_len_table[cmd] : 0;
+
+		if( plen == 0 ) {
+			ShowWarning("loadgen: %s received unknown packet 0x%04x, disconnecting.\n", b->userid, cmd);
+			bot_close(b, true);
+			return;
+		}
+		if( plen == -1 ) {
+			if( b->rlen - pos < 4 )
+				break;
+			plen = RBUFW(p,2);
+			if( plen < 4 ) {
+				bot_close(b, true);
+				return;
+			}
+		}
+		if( b->rlen - pos < (size_t)plen )
+			break;
+
+		stats.recv_packets++;
+		switch( b->state ) {
+			case BOT_LOGIN: bot_parse_login(b, p); break;
+			case BOT_CHAR: bot_parse_char(b, p); break;
+			case BOT_MAP_AUTH:
+			case BOT_MAP: bot_parse_map(b, p, tick); break;
+			default: break;
+		}
+		if( b->state == BOT_OFFLINE || b->rlen == 0 ) // closed, or moved on to the next server
+			return;
+		pos += plen;
+	}
+
+	if( b->fd >= 0 && pos ) {
+		memmove(b->rbuf, b->rbuf + pos, b->rlen - pos);
+		b->rlen -= pos;
+	}
+	if( b->rlen == LOADGEN_RBUF ) { // packet larger than the buffer
+		bot_close(b, true);
+	}
+}
+
+/*==========================================
+ * Reports
+ *------------------------------------------*/
+static int loadgen_rtt_cmp(const void *a, const void *b) {
+	int64 x = *(const int64*)a, y = *(const int64*)b;
+	return x < y ? -1 : x > y;
+}
+
+static void loadgen_report(int64 elapsed) {
+	double secs = elapsed / 1000.;
+	int i, online = 0;
+
+	for( i = 0; i < bot_count; i++ ) {
+		if( bots[i].state == BOT_MAP )
+			online++;
+	}
+
+	qsort(stats.rtt, stats.rtt_count, sizeof(int64), loadgen_rtt_cmp);
+	ShowInfo("Bots: %d/%d in game (%u logins, %u failures) | out: %.0f packets/s %.1f kB/s | in: %.0f packets/s %.1f kB/s\n",
+		online, bot_count, stats.logins, stats.failures,
+		stats.sent_packets/secs, stats.sent_bytes/1024./secs, stats.recv_packets/secs, stats.recv_bytes/1024./secs);
+	if( stats.rtt_count )
+		ShowInfo("Tick latency (%d samples): p50 %"PRId64" ms | p90 %"PRId64" ms | p99 %"PRId64" ms | max %"PRId64" ms\n",
+			stats.rtt_count, stats.rtt[stats.rtt_count*50/100], stats.rtt[stats.rtt_count*90/100],
+			stats.rtt[stats.rtt_count*99/100], stats.rtt[stats.rtt_count-1]);
+
+	stats.sent_packets = stats.sent_bytes = stats.recv_packets = stats.recv_bytes = 0;
+	stats.logins = stats.failures = 0;
+	stats.rtt_count = 0;
+}
+
+/*==========================================
+ * Account setup
+ *------------------------------------------*/
+/// Prints the SQL creating the bot accounts and their characters,
+/// and with sql_guild_size the guilds they are put in, sql_guild_size bots each.
+static void loadgen_sql(void) {
+	int i;
+
+	for( i = 0; i < sql_count; i++ ) {
+		int account_id = sql_account_id + i;
+		const char *map_name = sql_map[i % sql_map_count];
+		printf("REPLACE INTO `login` (`account_id`, `userid`, `user_pass`, `sex`, `email`) VALUES (%d, '%s%d', '%s', 'M', 'a@a.com');\n",
+			account_id, account_prefix, i, password);
+		printf("REPLACE INTO `char` (`account_id`, `char_num`, `name`, `class`, `str`, `agi`, `vit`, `int`, `dex`, `luk`, `max_hp`, `hp`, `max_sp`, `sp`, `last_map`, `last_x`, `last_y`, `save_map`, `save_x`, `save_y`) "
+			"VALUES (%d, 0, '%s%d', %d, 5, 5, 5, 5, 5, 5, 100, 100, 100, 100, '%s', %d, %d, '%s', %d, %d);\n",
+			account_id, account_prefix, i, sql_class, map_name, sql_x, sql_y, map_name, sql_x, sql_y);
+
+		if( sql_guild_size ) {
+			int guild_id = sql_guild_id + i / sql_guild_size;
+			if( i % sql_guild_size == 0 ) { // the first bot of each guild is its master
+				printf("REPLACE INTO `guild` (`guild_id`, `name`, `char_id`, `master`, `guild_lv`, `max_member`, `average_lv`) "
+					"SELECT %d, '%sguild%d', `char_id`, `name`, 1, 16, 1 FROM `char` WHERE `name` = '%s%d';\n",
+					guild_id, account_prefix, i / sql_guild_size, account_prefix, i);
+				printf("REPLACE INTO `guild_position` (`guild_id`, `position`, `name`, `mode`) VALUES (%d, 0, 'Master', 17), (%d, 1, 'Member', 0);\n",
+					guild_id, guild_id);
+			}
+			printf("REPLACE INTO `guild_member` (`guild_id`, `account_id`, `char_id`, `class`, `lv`, `position`, `name`) "
+				"SELECT %d, `account_id`, `char_id`, `class`, `base_level`, %d, `name` FROM `char` WHERE `name` = '%s%d';\n",
+				guild_id, i % sql_guild_size ? 1 : 0, account_prefix, i);
+			printf("UPDATE `char` SET `guild_id` = %d WHERE `name` = '%s%d';\n", guild_id, account_prefix, i);
+		}
+	}
+}
+
+/*==========================================
+ * Main loop
+ *------------------------------------------*/
+static void loadgen_sig(int sn) {
+	loadgen_stop = 1;
+}
+
+static void loadgen_run(void) {
+	struct epoll_event events[256];
+	int64 start, last_report, last_connect;
+	int i, next_bot = 0;
+
+	srand((unsigned int)time(NULL));
+	epoll_fd = epoll_create(1024);
+	CREATE(bots, struct bot, bot_count);
+	for( i = 0; i < bot_count; i++ ) {
+		struct bot *b = &bots[i];
+		int w = profile_weight ? (int)(rand() % profile_weight) : 0;
+		int k;
+
+		for( k = 0; k < profile_count - 1 && (w -= profiles[k].weight) >= 0; k++ )
+			;
+		b->profile = &profiles[k];
+		b->fd = -1;
+		snprintf(b->userid, sizeof(b->userid), "%s%d", account_prefix, i);
+		CREATE(b->rbuf, uint8, LOADGEN_RBUF);
+	}
+
+	signal(SIGINT, loadgen_sig);
+	signal(SIGTERM, loadgen_sig);
+
+	ShowStatus("loadgen: %d bots against %s:%d (PACKETVER %d, %d profiles).\n", bot_count, login_ip, login_port, PACKETVER, profile_count);
+	start = last_report = last_connect = loadgen_tick();
+
+	while( !loadgen_stop ) {
+		int64 tick;
+		int n = epoll_wait(epoll_fd, events, ARRAYLENGTH(events), 10);
+
+		tick = loadgen_tick();
+		for( i = 0; i < n; i++ ) {
+			struct bot *b = events[i].data.ptr;
+
+			if( b->fd < 0 )
+				continue;
+			if( !b->connected && (events[i].events & (EPOLLOUT|EPOLLERR|EPOLLHUP)) ) {
+				int err = 0;
+				socklen_t errlen = sizeof(err);
+				getsockopt(b->fd, SOL_SOCKET, SO_ERROR, &err, &errlen);
+				if( err ) {
+					bot_close(b, true);
+					continue;
+				}
+				b->connected = true;
+			}
+			if( events[i].events & EPOLLIN )
+				bot_recv(b, tick);
+			if( b->fd >= 0 && (events[i].events & EPOLLOUT) )
+				bot_flush(b);
+		}
+
+		// start new logins at connect_rate
+		for( n = (int)((tick - last_connect) * connect_rate / 1000); n > 0; n-- ) {
+			struct bot *b;
+			for( i = 0; i < bot_count; i++, next_bot = (next_bot + 1) % bot_count ) {
+				b = &bots[next_bot];
+				if( b->state == BOT_OFFLINE && b->fd < 0 && b->retry_tick <= tick )
+					break;
+			}
+			if( i == bot_count )
+				break;
+			bot_login(b);
+			next_bot = (next_bot + 1) % bot_count;
+			last_connect = tick;
+		}
+		if( n == 0 && tick - last_connect >= 1000 )
+			last_connect = tick;
+
+		for( i = 0; i < bot_count; i++ ) {
+			struct bot *b = &bots[i];
+
+			if( b->state == BOT_MAP ) {
+				if( tick >= b->next_tick && !b->tick_sent ) {
+					bot_ticksend(b, tick);
+					b->next_tick = tick + 1000;
+				}
+				if( tick >= b->next_action ) {
+					bot_act(b, tick);
+					b->next_action = tick + b->profile->interval;
+				}
+			}
+			bot_flush(b);
+		}
+
+		if( tick - last_report >= report_interval * 1000 ) {
+			loadgen_report(tick - last_report);
+			last_report = tick;
+		}
+		if( duration && tick - start >= (int64)duration * 1000 )
+			break;
+	}
+
+	for( i = 0; i < bot_count; i++ ) {
+		bot_close(&bots[i], false);
+		aFree(bots[i].rbuf);
+		if( bots[i].wbuf )
+			aFree(bots[i].wbuf);
+	}
+	aFree(bots);
+	if( stats.rtt )
+		aFree(stats.rtt);
+	close(epoll_fd);
+}
+
+static void loadgen_usage(void) {
+	ShowInfo("Usage: loadgen [--conf <file>] [--bots <count>] [--duration <seconds>]\n");
+	ShowInfo("       loadgen [--conf <file>] --sql <count>   prints the SQL creating <count> bot accounts\n");
+}
+
+int do_init(int argc, char** argv) {
+	int i;
+
+	for( i = 1; i < argc; i++ ) {
+		if( !strcmp(argv[i], "--conf") && i+1 < argc )
+			safestrncpy(conf_file, argv[++i], sizeof(conf_file));
+	}
+	loadgen_config_read(conf_file);
+
+	for( i = 1; i < argc; i++ ) {
+		if( !strcmp(argv[i], "--conf") && i+1 < argc )
+			i++;
+		else if( !strcmp(argv[i], "--bots") && i+1 < argc )
+			bot_count = max(atoi(argv[++i]), 1);
+		else if( !strcmp(argv[i], "--duration") && i+1 < argc )
+			duration = max(atoi(argv[++i]), 0);
+		else if( !strcmp(argv[i], "--sql") && i+1 < argc )
+			sql_count = max(atoi(argv[++i]), 0);
+		else {
+			loadgen_usage();
+			return 1;
+		}
+	}
+
+	if( sql_count ) {
+		loadgen_sql();
+		return 0;
+	}
+
+	if( !profile_count )
+		loadgen_profile("wander, 1, 1000, 1, 0, 0, 0");
+
+	loadgen_packetdb();
+	loadgen_run();
+	return 0;
+}
+
+void do_final(void) {
+}